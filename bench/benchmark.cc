@@ -0,0 +1,245 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file
+ * Minimal microbenchmark framework for host-side code: implementation
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+
+#include "benchmark.h"
+
+using namespace std;
+
+void BenchmarkResult::compute_stats()
+{
+	if (samples.empty())
+		throw runtime_error("no samples for benchmark " + name);
+
+	vector<double> sorted(samples);
+	sort(sorted.begin(), sorted.end());
+
+	const size_t n = sorted.size();
+	min_ms = sorted.front();
+	max_ms = sorted.back();
+	median_ms = (n & 1) ? sorted[n/2] : (sorted[n/2 - 1] + sorted[n/2])/2;
+	mean_ms = accumulate(sorted.begin(), sorted.end(), 0.0)/n;
+}
+
+BenchmarkSuite::BenchmarkSuite(unsigned int reps) :
+	m_reps(reps ? reps : 1),
+	m_only(),
+	m_results()
+{}
+
+void BenchmarkSuite::set_filter(string const& only)
+{
+	m_only.clear();
+	istringstream in(only);
+	string token;
+	while (getline(in, token, ','))
+		if (!token.empty())
+			m_only.push_back(token);
+}
+
+bool BenchmarkSuite::enabled(string const& name) const
+{
+	if (m_only.empty())
+		return true;
+	for (auto const& token : m_only)
+		if (name.find(token) != string::npos)
+			return true;
+	return false;
+}
+
+void BenchmarkSuite::run(string const& name, size_t items, body_fn body, setup_fn setup)
+{
+	if (!enabled(name))
+		return;
+
+	using clock = chrono::steady_clock;
+
+	cout << "Running " << name << " (" << items << " items, " << m_reps << " repetitions) ..." << endl;
+
+	BenchmarkResult result;
+	result.name = name;
+	result.items = items;
+	result.samples.reserve(m_reps);
+
+	// warm-up
+	if (setup) setup();
+	body();
+
+	for (unsigned int r = 0; r < m_reps; ++r) {
+		if (setup) setup();
+		const clock::time_point start = clock::now();
+		body();
+		const chrono::duration<double, milli> elapsed = clock::now() - start;
+		result.samples.push_back(elapsed.count());
+	}
+
+	result.compute_stats();
+	m_results.push_back(result);
+}
+
+void BenchmarkSuite::print(ostream& out) const
+{
+	out << left << setw(32) << "benchmark" << right
+		<< setw(12) << "items"
+		<< setw(12) << "min ms"
+		<< setw(12) << "median ms"
+		<< setw(12) << "mean ms"
+		<< setw(12) << "max ms"
+		<< setw(14) << "Mitems/s" << "\n";
+	for (auto const& res : m_results) {
+		out << left << setw(32) << res.name << right
+			<< setw(12) << res.items
+			<< fixed << setprecision(3)
+			<< setw(12) << res.min_ms
+			<< setw(12) << res.median_ms
+			<< setw(12) << res.mean_ms
+			<< setw(12) << res.max_ms
+			<< setw(14) << (res.median_ms > 0 ? res.items/(res.median_ms*1000) : 0)
+			<< defaultfloat << "\n";
+	}
+}
+
+// JSON string escaping, only for the characters we may actually encounter
+static string json_escape(string const& str)
+{
+	string ret;
+	ret.reserve(str.size());
+	for (char c : str) {
+		switch (c) {
+		case '"': ret += "\\\""; break;
+		case '\\': ret += "\\\\"; break;
+		case '\n': ret += "\\n"; break;
+		case '\t': ret += "\\t"; break;
+		default: ret += c;
+		}
+	}
+	return ret;
+}
+
+void BenchmarkSuite::write_json(ostream& out, metadata const& meta) const
+{
+	out << "{\n";
+	for (auto const& m : meta)
+		out << "\t\"" << json_escape(m.first) << "\": \"" << json_escape(m.second) << "\",\n";
+	out << "\t\"reps\": " << m_reps << ",\n";
+	out << "\t\"results\": [\n";
+	out << setprecision(6);
+	for (size_t i = 0; i < m_results.size(); ++i) {
+		BenchmarkResult const& res = m_results[i];
+		out << "\t\t{ \"name\": \"" << json_escape(res.name) << "\""
+			<< ", \"items\": " << res.items
+			<< ", \"min_ms\": " << res.min_ms
+			<< ", \"median_ms\": " << res.median_ms
+			<< ", \"mean_ms\": " << res.mean_ms
+			<< ", \"max_ms\": " << res.max_ms
+			<< " }" << (i + 1 < m_results.size() ? "," : "") << "\n";
+	}
+	out << "\t]\n}\n";
+}
+
+// extract the string value associated with key in a single-line JSON object
+static bool json_line_string(string const& line, const char *key, string &value)
+{
+	const string pattern = string("\"") + key + "\": \"";
+	size_t start = line.find(pattern);
+	if (start == string::npos)
+		return false;
+	start += pattern.size();
+	const size_t end = line.find('"', start);
+	if (end == string::npos)
+		return false;
+	value = line.substr(start, end - start);
+	return true;
+}
+
+// extract the numeric value associated with key in a single-line JSON object
+static bool json_line_number(string const& line, const char *key, double &value)
+{
+	const string pattern = string("\"") + key + "\": ";
+	size_t start = line.find(pattern);
+	if (start == string::npos)
+		return false;
+	istringstream in(line.substr(start + pattern.size()));
+	return bool(in >> value);
+}
+
+int BenchmarkSuite::compare(istream& baseline, double threshold, ostream& out) const
+{
+	// we only need to parse the output of write_json, which
+	// has exactly one result per line
+	map<string, double> base_median;
+	string line;
+	while (getline(baseline, line)) {
+		string name;
+		double median;
+		if (json_line_string(line, "name", name) && json_line_number(line, "median_ms", median))
+			base_median[name] = median;
+	}
+
+	if (base_median.empty())
+		throw runtime_error("no benchmark results found in baseline");
+
+	int regressions = 0;
+	const double limit = 1 + threshold/100;
+
+	out << left << setw(32) << "benchmark" << right
+		<< setw(14) << "baseline ms"
+		<< setw(14) << "current ms"
+		<< setw(10) << "ratio" << "\n";
+	for (auto const& res : m_results) {
+		auto found = base_median.find(res.name);
+		out << left << setw(32) << res.name << right << fixed << setprecision(3);
+		if (found == base_median.end()) {
+			out << setw(14) << "-" << setw(14) << res.median_ms << setw(10) << "-"
+				<< "  (not in baseline)\n" << defaultfloat;
+			continue;
+		}
+		const double ratio = found->second > 0 ? res.median_ms/found->second : 1;
+		const bool regressed = ratio > limit;
+		const bool improved = ratio*limit < 1;
+		out << setw(14) << found->second
+			<< setw(14) << res.median_ms
+			<< setw(10) << ratio
+			<< (regressed ? "  REGRESSION" : improved ? "  improvement" : "")
+			<< "\n" << defaultfloat;
+		if (regressed)
+			++regressions;
+	}
+
+	return regressions;
+}
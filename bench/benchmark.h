@@ -0,0 +1,115 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file
+ * Minimal microbenchmark framework for host-side code
+ *
+ * A BenchmarkSuite runs each registered case a fixed number of times,
+ * collecting the wall-clock time of each repetition, and can dump the
+ * resulting statistics as JSON (one result per line, so that the files
+ * can also be processed with line-oriented tools) or compare them against
+ * a previously stored JSON baseline.
+ */
+
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+//! Statistics for a single benchmark case
+struct BenchmarkResult
+{
+	std::string name;
+	//! Number of items (particles, barriers, ...) processed per repetition
+	size_t items;
+	//! Wall-clock time of each repetition, in milliseconds
+	std::vector<double> samples;
+
+	double min_ms;
+	double median_ms;
+	double mean_ms;
+	double max_ms;
+
+	//! Compute min/median/mean/max from the samples
+	void compute_stats();
+};
+
+//! A collection of benchmark cases sharing the same configuration
+class BenchmarkSuite
+{
+public:
+	//! Operation executed (untimed) before each repetition
+	using setup_fn = std::function<void(void)>;
+	//! Operation being timed
+	using body_fn = std::function<void(void)>;
+
+	//! Metadata written to the JSON header, such as problem name and size
+	using metadata = std::map<std::string, std::string>;
+
+private:
+	unsigned int m_reps;
+	std::vector<std::string> m_only;
+	std::vector<BenchmarkResult> m_results;
+
+public:
+	BenchmarkSuite(unsigned int reps);
+
+	//! Only run the cases whose name contains one of the given (comma-separated) substrings
+	void set_filter(std::string const& only);
+
+	//! Check if the given case is enabled by the filter
+	bool enabled(std::string const& name) const;
+
+	//! Run a benchmark case (if enabled) and record its result
+	/*! The body is run once untimed to warm up caches and lazy allocations,
+	 * and then m_reps times, each one preceded by an untimed call to setup
+	 * (if given) to restore the initial conditions.
+	 */
+	void run(std::string const& name, size_t items, body_fn body, setup_fn setup = setup_fn());
+
+	std::vector<BenchmarkResult> const& results() const
+	{ return m_results; }
+
+	//! Print a human-readable table of the results
+	void print(std::ostream& out) const;
+
+	//! Write the results as JSON, with the given metadata
+	void write_json(std::ostream& out, metadata const& meta) const;
+
+	//! Compare the results against a baseline in the format produced by write_json
+	/*! Each case present in both sets is compared by median time; a ratio
+	 * higher than (1 + threshold/100) is reported as a regression.
+	 * \return the number of regressions
+	 */
+	int compare(std::istream& baseline, double threshold, std::ostream& out) const;
+};
+
+#endif
@@ -0,0 +1,842 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file
+ * Host-side microbenchmarks for the core GPUSPH data structures
+ *
+ * The benchmarks run on a synthetic lattice of particles placed inside the
+ * domain of the problem GPUSPH was last built for, without starting any
+ * worker or touching the devices, so that host-path performance can be
+ * tracked independently of the GPU code.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "GPUSPH.h"
+#include "GlobalData.h"
+#include "Options.h"
+#include "Synchronizer.h"
+#include "VTUReader.h"
+#include "VTKWriter.h"
+#include "OutputFilter.h"
+#include "HotFile.h"
+#include "host_forces.h"
+#include "host_dtreduce.h"
+#include "host_filters.h"
+#include "host_post_process.h"
+#include "hostbuffer.h"
+#include "Cube.h"
+#include "Sphere.h"
+#include "utils.h"
+
+#include "problem_spec.h"
+#include "gpusph_version.opt"
+
+#include "benchmark.h"
+
+using namespace std;
+
+//! Benchmark harness
+/*! This is a friend of GPUSPH, so that the private host-side methods
+ * (buffer allocation, particle sorting and swapping) can be benchmarked
+ * directly, without going through GPUSPH::initialize().
+ */
+struct HostBenchmarks
+{
+	GlobalData *gdata;
+	GPUSPH *sim;
+	ProblemCore *problem;
+
+	//! Number of particles per side of the lattice
+	uint side;
+	//! Seed for the random permutations
+	unsigned long seed;
+
+	//! Lattice particle positions
+	PointVect lattice;
+	//! Lattice spacing
+	double dx;
+
+	HostBenchmarks(GlobalData *_gdata, uint _side) :
+		gdata(_gdata),
+		sim(GPUSPH::getInstance()),
+		problem(NULL),
+		side(_side),
+		seed(5489),
+		lattice(),
+		dx(0)
+	{}
+
+	//! Prepare the problem, the domain and the host buffers
+	void setup();
+	//! Release the host buffers
+	void teardown();
+
+	//! Place the lattice particles in the host buffers
+	void fill_buffers();
+	//! Randomly permute the particles in the host buffers
+	void shuffle();
+
+	//! Write a Crixus-style VTU file with the lattice particles, for the reader benchmark
+	void write_vtu(string const& fname) const;
+
+	//! Register and run all benchmarks
+	void run(BenchmarkSuite &suite, uint threads, uint barriers);
+};
+
+void HostBenchmarks::setup()
+{
+	problem = gdata->problem;
+
+	sim->gdata = gdata;
+	sim->clOptions = gdata->clOptions;
+	sim->problem = problem;
+
+	if (!problem->initialize())
+		throw runtime_error("problem initialization failed");
+
+	// domain setup, as in GPUSPH::initialize()
+	gdata->worldOrigin = make_float3(problem->get_worldorigin());
+	gdata->worldSize = make_float3(problem->get_worldsize());
+	gdata->gridSize = problem->get_gridsize();
+	ulong longNGridCells = (ulong) gdata->gridSize.x * gdata->gridSize.y * gdata->gridSize.z;
+	if (longNGridCells > MAX_CELLS)
+		throw runtime_error("too many cells in the problem domain");
+	gdata->nGridCells = (uint)longNGridCells;
+	gdata->cellSize = make_float3(problem->get_cellsize());
+
+	// pretend to have two devices on a single node, so that the device map
+	// and the per-device sorting are set up as in a multi-GPU run
+	gdata->devices = 2;
+	gdata->mpi_nodes = 1;
+	gdata->mpi_rank = 0;
+	gdata->totDevices = gdata->devices*gdata->mpi_nodes;
+
+	gdata->totParticles = side*side*side;
+	gdata->allocatedParticles = round_up(gdata->totParticles, 4U);
+
+	// lattice covering the whole domain, with the particles at the center
+	// of each lattice cell
+	const double3 origin = problem->get_worldorigin();
+	const double3 size = problem->get_worldsize();
+	const double3 step = make_double3(size.x/side, size.y/side, size.z/side);
+	dx = min(step.x, min(step.y, step.z));
+
+	lattice.clear();
+	lattice.reserve(gdata->totParticles);
+	for (uint k = 0; k < side; ++k)
+		for (uint j = 0; j < side; ++j)
+			for (uint i = 0; i < side; ++i)
+				lattice.push_back(Point(
+						origin.x + (i + 0.5)*step.x,
+						origin.y + (j + 0.5)*step.y,
+						origin.z + (k + 0.5)*step.z));
+
+	size_t totCPUbytes = sim->allocateGlobalHostBuffers();
+	cout << "Allocated " << gdata->memString(totCPUbytes) << " on host for "
+		<< gdata->addSeparators(gdata->totParticles) << " particles" << endl;
+
+	problem->fillDeviceMap();
+
+	fill_buffers();
+}
+
+void HostBenchmarks::teardown()
+{
+	sim->deallocateGlobalHostBuffers();
+}
+
+void HostBenchmarks::fill_buffers()
+{
+	float4 *pos = gdata->s_hBuffers.getData<BUFFER_POS>();
+	double4 *globalPos = gdata->s_hBuffers.getData<BUFFER_POS_GLOBAL>();
+	hashKey *hash = gdata->s_hBuffers.getData<BUFFER_HASH>();
+	float4 *vel = gdata->s_hBuffers.getData<BUFFER_VEL>();
+	particleinfo *info = gdata->s_hBuffers.getData<BUFFER_INFO>();
+
+	const float rho = problem->physparams()->rho0[0];
+	const float mass = rho*dx*dx*dx;
+
+	for (uint p = 0; p < gdata->totParticles; ++p) {
+		info[p] = make_particleinfo(PT_FLUID, 0, p);
+		problem->calc_localpos_and_hash(lattice[p], info[p], pos[p], hash[p]);
+		pos[p].w = mass;
+		globalPos[p] = lattice[p].toDouble4();
+		globalPos[p].w = mass;
+		vel[p] = make_float4(0, 0, 0, rho);
+	}
+}
+
+void HostBenchmarks::shuffle()
+{
+	// Fisher-Yates shuffle on all host buffers
+	mt19937 rng(seed);
+	for (uint p = gdata->totParticles - 1; p > 0; --p) {
+		uniform_int_distribution<uint> pick(0, p);
+		sim->particleSwap(p, pick(rng));
+	}
+}
+
+//! Largest acceptable relative error of the kernel tables
+#define KERNEL_TABLE_MAX_ERROR 1e-4
+
+//! Print the largest error of the tabulated kernel against the analytic one
+/*! Errors are relative to the kernel at the origin for W, and to the largest
+ * kernel gradient for the gradient F*r, sampled across the influence radius
+ * (including its last representable value).
+ * Throws if either exceeds KERNEL_TABLE_MAX_ERROR.
+ */
+template<KernelType kerneltype>
+static void check_kernel_table_error(double slength, double kernelradius)
+{
+	const double radius = slength*kernelradius;
+	const KernelTable<kerneltype> table(slength, radius, kernelradius);
+	const AnalyticKernel<kerneltype> &analytic = table.analytic();
+	const uint samples = 100000;
+
+	double max_grad = 0;
+	for (uint i = 1; i < samples; ++i) {
+		const float r = radius*i/samples;
+		max_grad = max(max_grad, fabs(double(analytic.F(r*r))*r));
+	}
+
+	double w_err = 0, grad_err = 0;
+	const double w0 = analytic.W(0);
+	for (uint i = 1; i < samples; ++i) {
+		const float r = radius*i/samples;
+		const float r2 = r*r;
+		w_err = max(w_err, fabs(double(table.W(r2)) - analytic.W(r2))/w0);
+		grad_err = max(grad_err, fabs(double(table.F(r2)) - analytic.F(r2))*r/max_grad);
+	}
+
+	// the last interval is the one most prone to rounding
+	const float r2last = nextafterf(float(radius*radius), 0.0f);
+	w_err = max(w_err, fabs(double(table.W(r2last)) - analytic.W(r2last))/w0);
+	grad_err = max(grad_err, fabs(double(table.F(r2last)) - analytic.F(r2last))*sqrt(r2last)/max_grad);
+
+	cout << "Kernel table " << KernelName[kerneltype] << " (" << table.memory()
+		<< " bytes): max relative error " << w_err << " (W), "
+		<< grad_err << " (gradient)" << endl;
+
+	if (!(w_err <= KERNEL_TABLE_MAX_ERROR && grad_err <= KERNEL_TABLE_MAX_ERROR))
+		throw runtime_error(string("kernel table error too large for ") + KernelName[kerneltype]);
+}
+
+//! Largest acceptable relative error of the MLS filter on a uniform density
+#define MLS_MAX_ERROR 1e-5
+
+//! Print the largest error of the MLS filter on a uniform density
+/*! MLS reproduces a uniform density exactly, up to the residual of the
+ * solution of the MLS system of each particle, so the error of the filtered
+ * density measures the accuracy of the solver on the given particle
+ * distribution. Throws if it exceeds MLS_MAX_ERROR.
+ */
+static void check_mls_error(const ProblemCore *problem, BufferList &buffers, uint numParts)
+{
+	const SimParams *sp = problem->simparams();
+	const PhysParams *pp = problem->physparams();
+	const double4 *gpos = buffers.getConstData<BUFFER_POS_GLOBAL>();
+	const particleinfo *info = buffers.getConstData<BUFFER_INFO>();
+
+	// share the positions and info, with a separate uniform density
+	FilteredBufferList uniform;
+	BufferList filtered;
+	uniform.add(BUFFER_POS_GLOBAL, buffers[BUFFER_POS_GLOBAL]);
+	uniform.add(BUFFER_INFO, buffers[BUFFER_INFO]);
+	uniform.addBuffer<HostBuffer, BUFFER_VEL>();
+	filtered.addBuffer<HostBuffer, BUFFER_VEL>();
+	uniform[BUFFER_VEL]->alloc(numParts);
+	filtered[BUFFER_VEL]->alloc(numParts);
+
+	float4 *vel = uniform.getData<BUFFER_VEL>();
+	for (uint i = 0; i < numParts; ++i) {
+		const int fluid = fluid_num(info[i]);
+		vel[i] = make_float4(0, 0, 0, problem->numerical_density(pp->rho0[fluid], fluid));
+	}
+
+	HostFilterEngine mls(MLS_FILTER, 1, problem);
+	mls.process(uniform, filtered, numParts, numParts, sp->slength, sp->influenceRadius);
+
+	const float4 *newVel = filtered.getConstData<BUFFER_VEL>();
+	double err = 0;
+	for (uint i = 0; i < numParts; ++i) {
+		if (INACTIVE(gpos[i]))
+			continue;
+		const int fluid = fluid_num(info[i]);
+		const double rho0 = pp->rho0[fluid];
+		err = max(err, fabs(problem->physical_density(newVel[i].w, fluid) - rho0)/rho0);
+	}
+
+	cout << "MLS filter: max relative error on a uniform density " << err << endl;
+
+	if (!(err <= MLS_MAX_ERROR))
+		throw runtime_error("MLS filter error too large");
+}
+
+// append a raw VTK data array (header with the byte count, followed by the data)
+template<typename T>
+static void append_raw(string &data, vector<T> const& values)
+{
+	const uint32_t bytes = values.size()*sizeof(T);
+	data.append((const char*)&bytes, sizeof(bytes));
+	data.append((const char*)values.data(), bytes);
+}
+
+void HostBenchmarks::write_vtu(string const& fname) const
+{
+	const size_t numParts = lattice.size();
+
+	vector<double> volume(numParts, dx*dx*dx);
+	vector<double> surface(numParts, 0);
+	vector<int32_t> ptype(numParts, CRIXUS_FLUID);
+	vector<int32_t> ftype(numParts, 0);
+	vector<int32_t> kent(numParts, 0);
+	vector<int32_t> moving(numParts, 0);
+	vector<int32_t> absidx(numParts);
+	vector<double> normal(3*numParts, 0);
+	vector<int32_t> vertices(3*numParts, 0);
+	vector<double> coords(3*numParts);
+
+	for (size_t p = 0; p < numParts; ++p) {
+		absidx[p] = p;
+		coords[3*p] = lattice[p](0);
+		coords[3*p + 1] = lattice[p](1);
+		coords[3*p + 2] = lattice[p](2);
+	}
+
+	struct array_desc {
+		const char *name;
+		const char *type;
+		int components;
+	};
+
+	const array_desc arrays[] = {
+		{ "Volume", "Float64", 1 },
+		{ "Surface", "Float64", 1 },
+		{ "ParticleType", "Int32", 1 },
+		{ "FluidType", "Int32", 1 },
+		{ "KENT", "Int32", 1 },
+		{ "MovingBoundary", "Int32", 1 },
+		{ "AbsoluteIndex", "Int32", 1 },
+		{ "Normal", "Float64", 3 },
+		{ "VertexParticle", "Int32", 3 },
+	};
+
+	string data;
+	vector<size_t> offsets;
+	offsets.push_back(data.size()); append_raw(data, volume);
+	offsets.push_back(data.size()); append_raw(data, surface);
+	offsets.push_back(data.size()); append_raw(data, ptype);
+	offsets.push_back(data.size()); append_raw(data, ftype);
+	offsets.push_back(data.size()); append_raw(data, kent);
+	offsets.push_back(data.size()); append_raw(data, moving);
+	offsets.push_back(data.size()); append_raw(data, absidx);
+	offsets.push_back(data.size()); append_raw(data, normal);
+	offsets.push_back(data.size()); append_raw(data, vertices);
+	const size_t coords_offset = data.size();
+	append_raw(data, coords);
+
+	ofstream out(fname.c_str(), ios::binary);
+	if (!out)
+		throw runtime_error("cannot open " + fname);
+
+	out << "<?xml version='1.0'?>\n";
+	out << "<VTKFile type='UnstructuredGrid' version='0.1' byte_order='LittleEndian'>\n";
+	out << " <UnstructuredGrid>\n";
+	out << "  <Piece NumberOfPoints='" << numParts << "' NumberOfCells='0'>\n";
+	out << "   <PointData>\n";
+	for (size_t a = 0; a < sizeof(arrays)/sizeof(*arrays); ++a) {
+		out << "    <DataArray type='" << arrays[a].type << "' Name='" << arrays[a].name << "'";
+		if (arrays[a].components > 1)
+			out << " NumberOfComponents='" << arrays[a].components << "'";
+		out << " format='appended' offset='" << offsets[a] << "'/>\n";
+	}
+	out << "   </PointData>\n";
+	out << "   <Points>\n";
+	out << "    <DataArray type='Float64' NumberOfComponents='3' format='appended' offset='"
+		<< coords_offset << "'/>\n";
+	out << "   </Points>\n";
+	out << "  </Piece>\n";
+	out << " </UnstructuredGrid>\n";
+	out << " <AppendedData encoding='raw'>\n_";
+	out.write(data.data(), data.size());
+	out << "\n </AppendedData>\n";
+	out << "</VTKFile>\n";
+}
+
+void HostBenchmarks::run(BenchmarkSuite &suite, uint threads, uint barriers)
+{
+	const uint numParts = gdata->totParticles;
+	const string dirname = problem->get_dirname();
+
+	// particle position and hash computation
+	{
+		float4 *pos = gdata->s_hBuffers.getData<BUFFER_POS>();
+		hashKey *hash = gdata->s_hBuffers.getData<BUFFER_HASH>();
+		const particleinfo *info = gdata->s_hBuffers.getConstData<BUFFER_INFO>();
+		suite.run("calc_localpos_and_hash", numParts, [&]() {
+			for (uint p = 0; p < numParts; ++p)
+				problem->calc_localpos_and_hash(lattice[p], info[p], pos[p], hash[p]);
+		});
+		fill_buffers();
+	}
+
+	// random permutation of all host buffers, via particleSwap
+	suite.run("BufferList::swap_elements", numParts,
+		[&]() { shuffle(); },
+		[&]() { ++seed; });
+
+	// per-device sorting, from a shuffled state
+	suite.run("sortParticlesByHash", numParts,
+		[&]() { sim->sortParticlesByHash(); },
+		[&]() { ++seed; shuffle(); });
+
+	// host analog of the device particle sort (see sort() in buildneibs.cu):
+	// a single sort of all the particles, against sorting only the moving ones
+	// and merging them with the static ones, which are still in order
+	if (suite.enabled("CUDANeibsEngine::sort")) {
+		struct sort_item {
+			hashKey hash;
+			particleinfo info;
+			uint index;
+		};
+		auto comp = [](sort_item const& a, sort_item const& b) {
+			if (a.hash == b.hash) {
+				const ParticleType pta = PART_TYPE(a.info), ptb = PART_TYPE(b.info);
+				if (pta == ptb)
+					return id(a.info) < id(b.info);
+				return pta < ptb;
+			}
+			return a.hash < b.hash;
+		};
+		auto is_static = [](sort_item const& item) {
+			return !(FLUID(item.info) || MOVING(item.info) || (SURFACE(item.info) && !FLUID(item.info)));
+		};
+
+		// the bottom half of the lattice is fixed boundary, as in a container
+		vector<sort_item> sorted(numParts);
+		for (uint p = 0; p < numParts; ++p) {
+			float4 pos;
+			sorted[p].info = make_particleinfo(p < numParts/2 ? PT_BOUNDARY : PT_FLUID, 0, p);
+			sorted[p].index = p;
+			problem->calc_localpos_and_hash(lattice[p], sorted[p].info, pos, sorted[p].hash);
+		}
+		sort(sorted.begin(), sorted.end(), comp);
+
+		vector<uint> moving;
+		for (uint p = 0; p < numParts; ++p)
+			if (!is_static(sorted[p]))
+				moving.push_back(p);
+
+		// the moving particles are out of order after they move
+		vector<sort_item> items, merged(numParts);
+		auto move_particles = [&]() {
+			++seed;
+			items = sorted;
+			mt19937 rng(seed);
+			for (size_t m = moving.size(); m > 1; --m) {
+				uniform_int_distribution<size_t> pick(0, m - 1);
+				swap(items[moving[m - 1]], items[moving[pick(rng)]]);
+			}
+		};
+
+		suite.run("CUDANeibsEngine::sort (host, single sort)", numParts, [&]() {
+			sort(items.begin(), items.end(), comp);
+		}, move_particles);
+		suite.run("CUDANeibsEngine::sort (host, partition and merge)", numParts, [&]() {
+			const auto mid = stable_partition(items.begin(), items.end(), is_static);
+			sort(mid, items.end(), comp);
+			if (!is_sorted(items.begin(), mid, comp))
+				sort(items.begin(), mid, comp);
+			merge(items.begin(), mid, mid, items.end(), merged.begin(), comp);
+			copy(merged.begin(), merged.end(), items.begin());
+		}, move_particles);
+	}
+
+	// geometry filling on the lattice spacing
+	{
+		const double3 origin = problem->get_worldorigin();
+		const double3 size = problem->get_worldsize();
+		Cube cube(Point(origin.x, origin.y, origin.z), size.x, size.y, size.z);
+		Sphere sphere(Point(origin.x + size.x/2, origin.y + size.y/2, origin.z + size.z/2),
+			min(size.x, min(size.y, size.z))/4);
+
+		PointVect parts;
+		parts.reserve(numParts);
+
+		suite.run("Object::Fill", numParts,
+			[&]() { cube.Fill(parts, dx, true); },
+			[&]() { parts.clear(); });
+
+		suite.run("Object::Unfill", numParts,
+			[&]() { sphere.Unfill(parts, dx); },
+			[&]() { parts.clear(); cube.Fill(parts, dx, true); });
+	}
+
+	// host neighbors search and forces, with full and half neighbors lists,
+	// in plain and packed storage
+	{
+		const double4 *gpos = gdata->s_hBuffers.getConstData<BUFFER_POS_GLOBAL>();
+		const float4 *vel = gdata->s_hBuffers.getConstData<BUFFER_VEL>();
+		const particleinfo *info = gdata->s_hBuffers.getConstData<BUFFER_INFO>();
+		const double radius = problem->simparams()->influenceRadius;
+
+		HostNeibsList full(HostNeibsList::FULL_LIST);
+		HostNeibsList half(HostNeibsList::HALF_LIST);
+		HostNeibsList packed(HostNeibsList::HALF_LIST, HostNeibsList::PACKED_STORAGE);
+
+		suite.run("HostNeibsList::build (full)", numParts,
+			[&]() { full.build(gpos, info, numParts, radius); });
+		suite.run("HostNeibsList::build (half)", numParts,
+			[&]() { half.build(gpos, info, numParts, radius); });
+		suite.run("HostNeibsList::build (half, packed)", numParts,
+			[&]() { packed.build(gpos, info, numParts, radius); });
+
+		if (suite.enabled("HostForces::compute")) {
+			full.build(gpos, info, numParts, radius);
+			half.build(gpos, info, numParts, radius);
+			packed.build(gpos, info, numParts, radius);
+
+			// compare against the device neighbors list for the same particles
+			const size_t device_list = size_t(problem->simparams()->neiblistsize)*
+				gdata->allocatedParticles*sizeof(neibdata);
+			cout << "Neighbors list memory: device " << gdata->memString(device_list)
+				<< " (" << problem->simparams()->neiblistsize << " slots per particle), host "
+				<< gdata->memString(full.memory()) << " (full), "
+				<< gdata->memString(half.memory()) << " (half), "
+				<< gdata->memString(packed.memory()) << " (half, packed), for "
+				<< gdata->addSeparators(full.num_entries()) << " interactions" << endl;
+
+			// accuracy of the kernel tables
+			const double slength = problem->simparams()->slength;
+			check_kernel_table_error<CUBICSPLINE>(slength, 2);
+			check_kernel_table_error<QUADRATIC>(slength, 2);
+			check_kernel_table_error<WENDLAND>(slength, 2);
+			check_kernel_table_error<GAUSSIAN>(slength, 3);
+
+			HostForces host_forces(problem);
+			HostForces analytic_forces(problem, false);
+			vector<float4> forces(numParts), xsph(numParts);
+			suite.run("HostForces::compute (half, analytic kernel)", numParts, [&]() {
+				analytic_forces.compute(half, gpos, vel, info, forces.data(), xsph.data());
+			});
+			suite.run("HostForces::compute (full)", numParts, [&]() {
+				host_forces.compute(full, gpos, vel, info, forces.data(), xsph.data());
+			});
+			suite.run("HostForces::compute (half)", numParts, [&]() {
+				host_forces.compute(half, gpos, vel, info, forces.data(), xsph.data());
+			});
+			suite.run("HostForces::compute (half, packed)", numParts, [&]() {
+				host_forces.compute(packed, gpos, vel, info, forces.data(), xsph.data());
+			});
+
+			// time-step reduction over the per-particle CFL values,
+			// against a serial baseline
+			vector<float> cfl(numParts);
+			host_forces.compute(half, gpos, vel, info, forces.data(), xsph.data(), cfl.data());
+			volatile float maxcfl = 0;
+			suite.run("HostDtReduce::cflmax (serial)", numParts, [&]() {
+				float m = 0;
+				for (uint i = 0; i < numParts; ++i)
+					m = fmaxf(m, cfl[i]);
+				maxcfl = m;
+			});
+			suite.run("HostDtReduce::cflmax", numParts, [&]() {
+				maxcfl = HostDtReduce::cflmax(cfl.data(), numParts);
+			});
+		}
+
+		// density filters, filtering into a separate velocity buffer
+		if (suite.enabled("HostFilterEngine::process")) {
+			BufferList filtered;
+			filtered.addBuffer<HostBuffer, BUFFER_VEL>();
+			filtered[BUFFER_VEL]->alloc(numParts);
+
+			check_mls_error(problem, gdata->s_hBuffers, numParts);
+
+			const SimParams *sp = problem->simparams();
+			HostFilterEngine shepard(SHEPARD_FILTER, 1, problem);
+			HostFilterEngine mls(MLS_FILTER, 1, problem);
+			suite.run("HostFilterEngine::process (Shepard)", numParts, [&]() {
+				shepard.process(gdata->s_hBuffers, filtered, numParts, numParts,
+					sp->slength, sp->influenceRadius);
+			});
+			suite.run("HostFilterEngine::process (MLS)", numParts, [&]() {
+				mls.process(gdata->s_hBuffers, filtered, numParts, numParts,
+					sp->slength, sp->influenceRadius);
+			});
+		}
+
+		// post-processing of the downloaded buffers, into separate buffers
+		if (suite.enabled("HostPostProcessEngine::process")) {
+			BufferList processed;
+			processed.addBuffer<HostBuffer, BUFFER_VORTICITY>();
+			processed.addBuffer<HostBuffer, BUFFER_NORMALS>();
+			processed.addBuffer<HostBuffer, BUFFER_INFO>();
+			processed[BUFFER_VORTICITY]->alloc(numParts);
+			processed[BUFFER_NORMALS]->alloc(numParts);
+			processed[BUFFER_INFO]->alloc(numParts);
+
+			HostPostProcessEngine vorticity(VORTICITY, NO_FLAGS, problem);
+			suite.run("HostPostProcessEngine::process (vorticity)", numParts, [&]() {
+				vorticity.process(gdata->s_hBuffers, processed, numParts, numParts, 0, gdata);
+			});
+
+			const SimParams *sp = problem->simparams();
+			if (sp->boundarytype == SA_BOUNDARY || (sp->simflags & ENABLE_PLANES)) {
+				cout << "Skipping host surface detection: not supported with SA_BOUNDARY or planes" << endl;
+			} else {
+				HostPostProcessEngine surface(SURFACE_DETECTION, BUFFER_NORMALS, problem);
+				suite.run("HostPostProcessEngine::process (surface detection)", numParts, [&]() {
+					surface.process(gdata->s_hBuffers, processed, numParts, numParts, 0, gdata);
+				});
+			}
+		}
+	}
+
+	// VTK output of the whole particle system
+	if (suite.enabled("VTKWriter::write")) {
+		VTKWriter writer(gdata);
+		double t = 0;
+		const WriteFlags flags(true);
+		suite.run("VTKWriter::write", numParts, [&]() {
+			writer.start_writing(t, flags);
+			writer.write(numParts, gdata->s_hBuffers, 0, t, false);
+			writer.mark_written(t);
+			t += 1;
+		});
+	}
+
+	// hot file save and load; bodies would require the full
+	// rigid body setup, so skip the problems that have them
+	if (problem->simparams()->numbodies > 0) {
+		cout << "Skipping HotFile benchmarks: problem has moving or floating bodies" << endl;
+	} else {
+		const string hot_fname = dirname + "/bench.hot";
+
+		suite.run("HotFile::save", numParts, [&]() {
+			ofstream out(hot_fname.c_str(), ios::binary);
+			HotFile hf(out, gdata, numParts, 0, gdata->t, false);
+			hf.save();
+		});
+
+		if (suite.enabled("HotFile::load")) {
+			// make sure the file exists even if the save benchmark was filtered out
+			{
+				ofstream out(hot_fname.c_str(), ios::binary);
+				HotFile hf(out, gdata, numParts, 0, gdata->t, false);
+				hf.save();
+			}
+			suite.run("HotFile::load", numParts, [&]() {
+				ifstream in(hot_fname.c_str(), ios::binary);
+				in.exceptions(ifstream::failbit | ifstream::badbit);
+				HotFile hf(in, gdata, hot_fname);
+				uint part_count = 0;
+				uint numOpenBoundaries = 0;
+				hf.readHeader(part_count, numOpenBoundaries);
+				hf.load();
+			});
+		}
+		unlink(hot_fname.c_str());
+	}
+
+	// VTU input, as written by Crixus
+	if (suite.enabled("VTUReader::read")) {
+		const string vtu_fname = dirname + "/bench.vtu";
+		write_vtu(vtu_fname);
+		VTUReader reader;
+		reader.setFilename(vtu_fname);
+		suite.run("VTUReader::read", numParts, [&]() { reader.read(); });
+		reader.empty();
+		unlink(vtu_fname.c_str());
+	}
+
+	// thread synchronization
+	suite.run("Synchronizer::barrier", size_t(barriers)*threads, [&]() {
+		Synchronizer sync(threads);
+		vector<thread> workers;
+		workers.reserve(threads - 1);
+		for (uint t = 1; t < threads; ++t)
+			workers.push_back(thread([&]() {
+				for (uint b = 0; b < barriers; ++b)
+					sync.barrier();
+			}));
+		for (uint b = 0; b < barriers; ++b)
+			sync.barrier();
+		for (auto &w : workers)
+			w.join();
+	});
+}
+
+static void print_usage()
+{
+	cout << "GPUSPH host benchmarks, version " << GPUSPH_VERSION << "\n";
+	cout << "Compiled for problem \"" << selected_problem.name << "\"\n";
+	cout << "Syntax:\n";
+	cout << "\tGPUSPH-bench [--size N] [--reps R] [--only NAME[,NAME...]]\n";
+	cout << "\t             [--threads T] [--barriers B] [--dir directory]\n";
+	cout << "\t             [--out file.json] [--baseline file.json [--threshold PCT]]\n";
+	cout << " --size : number of particles per side of the synthetic lattice (default 64)\n";
+	cout << " --reps : number of timed repetitions for each benchmark (default 5)\n";
+	cout << " --only : only run the benchmarks whose name contains one of the given strings\n";
+	cout << " --threads : number of threads for the Synchronizer benchmark (default 4)\n";
+	cout << " --barriers : number of barriers per repetition in the Synchronizer benchmark (default 10000)\n";
+	cout << " --dir : directory for the temporary output (default bench_output)\n";
+	cout << " --out : write the results as JSON to the given file\n";
+	cout << " --baseline : compare the results against the given JSON file,\n";
+	cout << "              and exit with an error if any benchmark regressed\n";
+	cout << " --threshold : percent slowdown to be considered a regression (default 10)\n";
+	cout << " --help : show this help and exit\n";
+}
+
+// get the value of the option at argv[i], or throw if missing
+static const char *option_value(int argc, char **argv, int &i)
+{
+	if (i + 1 >= argc)
+		throw invalid_argument(string("missing value for option ") + argv[i]);
+	return argv[++i];
+}
+
+int main(int argc, char **argv)
+{
+	uint side = 64;
+	uint reps = 5;
+	uint threads = 4;
+	uint barriers = 10000;
+	double threshold = 10;
+	string only, out_fname, baseline_fname;
+	string dir = "bench_output";
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const char *arg = argv[i];
+			if (!strcmp(arg, "--size"))
+				side = stoul(option_value(argc, argv, i));
+			else if (!strcmp(arg, "--reps"))
+				reps = stoul(option_value(argc, argv, i));
+			else if (!strcmp(arg, "--only"))
+				only = option_value(argc, argv, i);
+			else if (!strcmp(arg, "--threads"))
+				threads = stoul(option_value(argc, argv, i));
+			else if (!strcmp(arg, "--barriers"))
+				barriers = stoul(option_value(argc, argv, i));
+			else if (!strcmp(arg, "--dir"))
+				dir = option_value(argc, argv, i);
+			else if (!strcmp(arg, "--out"))
+				out_fname = option_value(argc, argv, i);
+			else if (!strcmp(arg, "--baseline"))
+				baseline_fname = option_value(argc, argv, i);
+			else if (!strcmp(arg, "--threshold"))
+				threshold = stod(option_value(argc, argv, i));
+			else if (!strcmp(arg, "--help")) {
+				print_usage();
+				return 0;
+			} else
+				throw invalid_argument(string("unknown option ") + arg);
+		}
+		if (side < 2)
+			throw invalid_argument("lattice size must be at least 2");
+		if (threads < 1)
+			throw invalid_argument("at least one thread is needed");
+	} catch (exception const& e) {
+		cerr << "FATAL: " << e.what() << endl;
+		print_usage();
+		return 1;
+	}
+
+	// static, so that it outlives the GPUSPH singleton, whose destructor
+	// accesses it
+	static GlobalData gdata;
+	gdata.clOptions = new Options();
+	gdata.clOptions->dir = dir;
+	gdata.clOptions->problem = selected_problem.name;
+	gdata.run_mode = SIMULATE;
+
+	int regressions = 0;
+
+	try {
+		gdata.problem = selected_problem.create(&gdata);
+		if (!gdata.problem->simframework())
+			throw invalid_argument("no simulation framework defined in the problem!");
+		gdata.simframework = gdata.problem->simframework();
+		gdata.allocPolicy = gdata.simframework->getAllocPolicy();
+
+		HostBenchmarks bench(&gdata, side);
+		bench.setup();
+
+		BenchmarkSuite suite(reps);
+		suite.set_filter(only);
+		bench.run(suite, threads, barriers);
+
+		bench.teardown();
+
+		cout << "\n";
+		suite.print(cout);
+
+		if (!out_fname.empty()) {
+			ofstream out(out_fname.c_str());
+			if (!out)
+				throw runtime_error("cannot open " + out_fname);
+
+			BenchmarkSuite::metadata meta;
+			meta["version"] = GPUSPH_VERSION;
+			meta["problem"] = selected_problem.name;
+			meta["size"] = to_string(side);
+			meta["particles"] = to_string(gdata.totParticles);
+			meta["threads"] = to_string(threads);
+			suite.write_json(out, meta);
+			cout << "Results written to " << out_fname << endl;
+		}
+
+		if (!baseline_fname.empty()) {
+			ifstream baseline(baseline_fname.c_str());
+			if (!baseline)
+				throw runtime_error("cannot open " + baseline_fname);
+			cout << "\nComparison against " << baseline_fname
+				<< " (threshold " << threshold << "%)\n";
+			regressions = suite.compare(baseline, threshold, cout);
+			if (regressions)
+				cout << regressions << " benchmark(s) regressed" << endl;
+		}
+	} catch (exception const& e) {
+		cerr << "FATAL: " << e.what() << endl;
+		return 1;
+	}
+
+	return regressions ? 2 : 0;
+}
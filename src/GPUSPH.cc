@@ -55,6 +55,15 @@
 // HotFile
 #include "HotFile.h"
 
+// print_memory_usage
+#include "memory_accounting.h"
+
+// cudaDeviceNumaNode
+#include "cudautil.h"
+
+// HostPostProcessEngine
+#include "host_post_process.h"
+
 using namespace std;
 
 // an empty set of PostProcessEngines, to be used when we want to save
@@ -88,6 +97,12 @@ GPUSPH::GPUSPH() :
 	m_peakParticleSpeed(0.0),
 	m_peakParticleSpeedTime(0.0),
 
+	m_hostPostProcess(),
+	m_pendingPostProcess(),
+	m_pendingWriters(),
+	m_pendingWriteParticles(0),
+	m_pendingWriteTime(0.0),
+
 	initialized(false),
 	repacked(false)
 {
@@ -96,7 +111,7 @@ GPUSPH::GPUSPH() :
 }
 
 GPUSPH::~GPUSPH() {
-	if (gdata->debug.benchmark_command_runtimes)
+	if (gdata->debug.benchmark_command_runtimes || gdata->debug.benchmark_host_counters)
 		showCommandTimes();
 
 	closeInfoStream();
@@ -112,12 +127,19 @@ void GPUSPH::resetCommandTimes()
 		max_cmd_time[cmd] = cmd_time_duration(0);
 		tot_cmd_time[cmd] = cmd_time_duration(0);
 		cmd_calls[cmd] = 0;
+		cmd_counters[cmd].reset();
 	}
+	reset_perf_named_regions();
 }
 
 void GPUSPH::showCommandTimes()
 {
-	cout << "CMDTIMES:COMMAND\tCMD_NUM\tCALLS\tMAX(ms)\tTOT(ms)\n";
+	const bool counters = perf_counters_enabled();
+
+	cout << "CMDTIMES:COMMAND\tCMD_NUM\tCALLS\tMAX(ms)\tTOT(ms)";
+	if (counters)
+		print_perf_counters_header(cout);
+	cout << "\n";
 	for (CommandName cmd = IDLE; cmd < NUM_COMMANDS; cmd = CommandName(cmd+1))
 	{
 		if (!cmd_calls[cmd])
@@ -126,7 +148,29 @@ void GPUSPH::showCommandTimes()
 		std::chrono::duration<double, std::milli> tot_ms = tot_cmd_time[cmd];
 		cout << "CMDTIMES:" << command_name[cmd] << "\t" << cmd << "\t"
 			<< cmd_calls[cmd] << "\t"
-			<< max_ms.count() << "\t" << tot_ms.count() << "\n";
+			<< max_ms.count() << "\t" << tot_ms.count();
+		// hardware counters are only collected for commands run by the host thread:
+		// for worker commands they would only measure the time spent in the barriers
+		if (counters) {
+			if (cmd > NUM_WORKER_COMMANDS)
+				print_perf_counters(cout, cmd_counters[cmd]);
+			else for (int e = 0; e <= NUM_PERF_EVENTS; ++e)
+				cout << "\t-";
+		}
+		cout << "\n";
+	}
+
+	// named host regions are listed after the commands, with a CMD_NUM of -1
+	for (auto const& region : perf_named_regions())
+	{
+		PerfRegionStats const& stats = region.second;
+		std::chrono::duration<double, std::milli> max_ms = stats.max_time;
+		std::chrono::duration<double, std::milli> tot_ms = stats.tot_time;
+		cout << "CMDTIMES:" << region.first << "\t" << -1 << "\t"
+			<< stats.calls << "\t"
+			<< max_ms.count() << "\t" << tot_ms.count();
+		print_perf_counters(cout, stats.counters);
+		cout << "\n";
 	}
 }
 
@@ -169,6 +213,9 @@ bool GPUSPH::initialize(GlobalData *_gdata) {
 	clOptions = gdata->clOptions;
 	problem = gdata->problem;
 
+	// enable hardware counters before filling, so that the setup regions are counted too
+	enable_perf_counters(gdata->debug.benchmark_host_counters);
+
 	// For the new problem interface (compute worldorigin, init ODE, etc.)
 	// In all cases, also runs the checks for dt, neib list size, etc
 	// and creates the problem dir
@@ -248,6 +295,7 @@ bool GPUSPH::initialize(GlobalData *_gdata) {
 	uint hot_nrank = 1;
 
 	if (clOptions->resume_fname.empty()) {
+		PerfRegion region("fill_parts");
 		// get number of particles from problem file
 		gdata->totParticles = problem->fill_parts();
 	} else {
@@ -309,7 +357,7 @@ bool GPUSPH::initialize(GlobalData *_gdata) {
 			/* enable automatic exception handling on failure */
 			hot_in[i].exceptions(ifstream::failbit | ifstream::badbit);
 			hot_in[i].open(fname.str().c_str());
-			hf[i] = new HotFile(hot_in[i], gdata);
+			hf[i] = new HotFile(hot_in[i], gdata, fname.str());
 			hf[i]->readHeader(gdata->totParticles, gdata->problem->simparams()->numOpenBoundaries);
 		}
 	}
@@ -369,6 +417,17 @@ bool GPUSPH::initialize(GlobalData *_gdata) {
 		exit(1);
 	}
 
+	memory_account_set("host/GPUSPH/roll call",
+		(2*sizeof(bool) + sizeof(uint))*gdata->allocatedParticles);
+
+
+	if (gdata->numaPolicy != NUMA_NONE) {
+		printf("NUMA placement policy: %s\n", NumaPolicyName[gdata->numaPolicy]);
+		for (uint d = 0; d < gdata->devices; d++) {
+			gdata->deviceNumaNode[d] = cudaDeviceNumaNode(gdata->device[d]);
+			printf(" - device at index %u is on NUMA node %d\n", d, gdata->deviceNumaNode[d]);
+		}
+	}
 
 	printf("Allocating shared host buffers...\n");
 	// allocate cpu buffers, 1 per process
@@ -394,7 +453,10 @@ bool GPUSPH::initialize(GlobalData *_gdata) {
 		gdata->s_hBuffers.set_state_on_write("problem init");
 		printf("Copying the particles to shared arrays...\n");
 		printf("---\n");
-		problem->copy_to_array(gdata->s_hBuffers);
+		{
+			PerfRegion region("copy_to_array");
+			problem->copy_to_array(gdata->s_hBuffers);
+		}
 		if (gdata->run_mode != REPACK) {
 			if (problem->simparams()->turbmodel == KEPSILON)
 				problem->init_keps(gdata->s_hBuffers, gdata->totParticles);
@@ -408,7 +470,10 @@ bool GPUSPH::initialize(GlobalData *_gdata) {
 			gdata->iterations = hf[0]->get_iterations();
 			gdata->dt = hf[0]->get_dt();
 			for (uint i = 0; i < hot_nrank; i++) {
-				hf[i]->load();
+				{
+					PerfRegion region("HotFile::load");
+					hf[i]->load();
+				}
 #if 0
 				// for debugging, enable this and inspect contents
 				const float4 *pos = gdata->s_hBuffers.getConstData<BUFFER_POS>();
@@ -525,6 +590,9 @@ bool GPUSPH::initialize(GlobalData *_gdata) {
 		printf(" - device at index %u has %s particles assigned and offset %s\n",
 			d, gdata->addSeparators(gdata->s_hPartsPerDevice[d]).c_str(), gdata->addSeparators(gdata->s_hStartPerDevice[d]).c_str());
 
+	if (gdata->numaPolicy != NUMA_NONE)
+		placeGlobalHostBuffers();
+
 	// TODO this is where we would instance the Integrator class
 	// for the time being, we will instead call a function that initializes
 	// our own CommandSequences
@@ -563,12 +631,16 @@ bool GPUSPH::finalize() {
 	// TODO here, when there will be the Integrator
 	// delete Integrator
 
+	// dump the memory usage, including the high-water marks, before releasing anything
+	print_memory_usage(cout);
+
 	printf("Deallocating...\n");
 
 	// stuff for rollCallParticles()
 	free(m_rcBitmap);
 	free(m_rcNotified);
 	free(m_rcAddrs);
+	memory_account_set("host/GPUSPH/roll call", 0);
 
 	// workers
 	gdata->GPUWORKERS.clear();
@@ -643,8 +715,20 @@ void GPUSPH::runCommand<TIME_STEP_EPILOGUE>(CommandStruct const& cmd)
 		m_multiNodePerformanceCounter->incItersTimesParts( gdata->totParticles );
 	// to check, later, that the simulation is actually progressing
 	double previous_t = gdata->t;
+
+	// adaptive neighbors list construction: bound the particle displacement
+	// over this step with the maximum particle speed at its ends
+	if (problem->simparams()->buildneibsfreq == 0) {
+		float maxSpeed = gdata->maxSpeeds[0];
+		for (uint d = 1; d < gdata->devices; d++)
+			maxSpeed = max(maxSpeed, gdata->maxSpeeds[d]);
+		if (MULTI_NODE)
+			gdata->networkManager->networkFloatReduction(&maxSpeed, 1, MAX_REDUCTION);
+		gdata->nlMaxDisplacement += gdata->dt*max(maxSpeed, gdata->lastMaxSpeed);
+		gdata->lastMaxSpeed = maxSpeed;
+	}
+
 	gdata->t += gdata->dt;
-	// buildneibs_freq?
 
 	// choose minimum dt among the devices
 	if (gdata->dtadapt) {
@@ -758,6 +842,15 @@ bool GPUSPH::runSimulation() {
 		gdata->threadSynchronizer->forceUnlock();
 	}
 
+	// the last write is always forced, but an exception may have left
+	// a write waiting for the host post-processing
+	try {
+		completePendingWrite();
+	} catch (exception const& e) {
+		cerr << e.what() << endl;
+		all_ok = false;
+	}
+
 	const char* run_desc = gdata->run_mode_desc();
 	const char* run_desc_title = gdata->run_mode_Desc();
 
@@ -775,6 +868,12 @@ bool GPUSPH::runSimulation() {
 	printf("Peak particle speed was ~%g m/s at %g s -> can set maximum vel %.2g for this problem\n",
 		m_peakParticleSpeed, m_peakParticleSpeedTime, (m_peakParticleSpeed*1.1));
 
+	// achieved neighbors list construction interval
+	if (gdata->neibsBuilds > 0)
+		printf("Neighbors list built %lu times, every %.3g iterations on average%s\n",
+			gdata->neibsBuilds, double(gdata->iterations)/gdata->neibsBuilds,
+			problem->simparams()->buildneibsfreq == 0 ? " (adaptive)" : "");
+
 	// NO dispatchCommand() nor other barriers than the standard ones after the
 
 	printf("%s end, cleaning up...\n", run_desc_title);
@@ -949,17 +1048,50 @@ size_t GPUSPH::allocateGlobalHostBuffers()
 
 	size_t totCPUbytes = 0;
 
+	gdata->s_hBuffers.set_memory_tag_prefix("host/s_hBuffers");
+
+	// number of elements of each buffer
+	map<flag_t, size_t> buffer_sizes;
+	// space needed for all of them in the host arena
+	size_t arena_bytes = 0;
+
 	BufferList::iterator iter = gdata->s_hBuffers.begin();
 	while (iter != gdata->s_hBuffers.end()) {
+		size_t nels = numparts;
 		if (iter->first == BUFFER_NEIBSLIST)
-			totCPUbytes += iter->second->alloc(numparts*gdata->problem->simparams()->neiblistsize);
+			nels *= gdata->problem->simparams()->neiblistsize;
 		else if (iter->first & BUFFERS_CELL)
-			totCPUbytes += iter->second->alloc(gdata->nGridCells);
-		else
-			totCPUbytes += iter->second->alloc(numparts);
+			nels = gdata->nGridCells;
+		buffer_sizes[iter->first] = nels;
+		arena_bytes += iter->second->get_array_count()*
+			BufferArena::slice_size(iter->second->get_element_size()*nels);
+		++iter;
+	}
+
+	// with first-touch NUMA placement, each device is assumed to get an even
+	// share of each buffer; the pages are moved to the actual per-device ranges
+	// once they are known (see placeGlobalHostBuffers())
+	NumaPartition numa_partition;
+	if (gdata->numaPolicy == NUMA_FIRST_TOUCH)
+		for (uint d = 0; d < gdata->devices; d++)
+			numa_partition.push_back(NumaPart{1.0, gdata->deviceNumaNode[d]});
+
+	// all the global host buffers are carved out of a single arena,
+	// which is released when the last of them is destroyed
+	shared_ptr<BufferArena> arena = make_shared<HostBufferArena>(gdata->numaPolicy, numa_partition);
+	arena->reserve(arena_bytes);
+
+	iter = gdata->s_hBuffers.begin();
+	while (iter != gdata->s_hBuffers.end()) {
+		iter->second->set_arena(arena);
+		totCPUbytes += iter->second->alloc(buffer_sizes[iter->first]);
 		++iter;
 	}
 
+	// the buffers are accounted for by themselves, we account for
+	// everything else allocated here as a whole
+	const size_t bufferCPUbytes = totCPUbytes;
+
 	const size_t numbodies = gdata->problem->simparams()->numbodies;
 	cout << "Numbodies : " << numbodies << "\n";
 	if (numbodies > 0) {
@@ -1026,6 +1158,9 @@ size_t GPUSPH::allocateGlobalHostBuffers()
 		flt->second->hostAllocate(gdata);
 	}
 
+	if (clOptions->host_postprocess)
+		createHostPostProcess();
+
 	if (MULTI_DEVICE) {
 		// deviceMap
 		gdata->s_hDeviceMap = new devcount_t[numcells];
@@ -1057,6 +1192,9 @@ size_t GPUSPH::allocateGlobalHostBuffers()
 		totCPUbytes += gdata->devices * sizeof(uint*) * 3;
 		totCPUbytes += gdata->devices * sizeof(uint) * 4;
 	}
+
+	memory_account_set("host/GPUSPH/shared arrays", totCPUbytes - bufferCPUbytes);
+
 	return totCPUbytes;
 }
 
@@ -1064,6 +1202,10 @@ size_t GPUSPH::allocateGlobalHostBuffers()
 void GPUSPH::deallocateGlobalHostBuffers() {
 	gdata->s_hBuffers.clear();
 
+	for (auto flt : m_hostPostProcess)
+		delete flt.second;
+	m_hostPostProcess.clear();
+
 	// Deallocating waterdepth-related arrays
 	if (problem->simparams()->simflags & ENABLE_WATER_DEPTH) {
 		delete[] gdata->h_maxIOwaterdepth;
@@ -1106,6 +1248,7 @@ void GPUSPH::deallocateGlobalHostBuffers() {
 		free(gdata->s_dSegmentsStart);
 	}
 
+	memory_account_set("host/GPUSPH/shared arrays", 0);
 }
 
 /// Check consistency of buffers across multiple GPUs
@@ -1301,11 +1444,60 @@ uint GPUSPH::initializeNextIDs(bool resumed)
 	return numOpenVertices;
 }
 
+void GPUSPH::placeGlobalHostBuffers()
+{
+	// move each device range to the node of the device; this is only needed
+	// with first-touch placement, since the initial touch was done with an even
+	// split across the devices
+	if (gdata->numaPolicy == NUMA_FIRST_TOUCH && MULTI_GPU) {
+		for (auto const& kb : gdata->s_hBuffers) {
+			auto buf = kb.second;
+			// cell buffers are not split by particle, and neither is the
+			// (strided) neighbors list
+			if ((kb.first & BUFFERS_CELL) || kb.first == BUFFER_NEIBSLIST)
+				continue;
+			const size_t elsize = buf->get_element_size();
+			for (uint a = 0; a < buf->get_array_count(); ++a) {
+				char *data = static_cast<char*>(buf->get_buffer(a));
+				for (uint d = 0; d < gdata->devices; d++)
+					numa_move(data + gdata->s_hStartPerDevice[d]*elsize,
+						gdata->s_hPartsPerDevice[d]*elsize,
+						gdata->deviceNumaNode[d]);
+			}
+		}
+	}
+
+	// report the placement of the shared host buffers
+	vector<size_t> placement;
+	for (auto const& kb : gdata->s_hBuffers) {
+		auto buf = kb.second;
+		const size_t bytes = buf->get_allocated_elements()*buf->get_element_size();
+		for (uint a = 0; a < buf->get_array_count(); ++a) {
+			vector<size_t> buf_placement = numa_placement(buf->get_buffer(a), bytes);
+			if (buf_placement.size() > placement.size())
+				placement.resize(buf_placement.size(), 0);
+			for (size_t n = 0; n < buf_placement.size(); ++n)
+				placement[n] += buf_placement[n];
+		}
+	}
+
+	if (placement.empty()) {
+		printf("NUMA placement of shared host buffers not available\n");
+		return;
+	}
+
+	printf("NUMA placement of shared host buffers:\n");
+	for (size_t n = 0; n < placement.size(); ++n)
+		printf(" - node %zu: %s\n", n, gdata->memString(placement[n]).c_str());
+}
+
 // Sort the particles in-place (pos, vel, info) according to the device number;
 // update counters s_hPartsPerDevice and s_hStartPerDevice, which will be used to upload
 // and download the buffers. Finally, initialize s_dSegmentsStart
 // Assumptions: problem already filled, deviceMap filled, particles copied in shared arrays
 void GPUSPH::sortParticlesByHash() {
+	PerfRegion region("sortParticlesByHash");
+
 	// DEBUG: print the list of particles before sorting
 	// for (uint p=0; p < gdata->totParticles; p++)
 	//	printf(" p %d has id %u, dev %d\n", p, id(gdata->s_hInfo[p]), gdata->calcDevice(gdata->s_hPos[p]) );
@@ -1572,6 +1764,18 @@ double GPUSPH::Wendland2D(const double r, const double h) {
 
 void GPUSPH::doWrite(WriteFlags const& write_flags)
 {
+	WriterMap writers = startWrite(write_flags);
+	finishWrite(writers, gdata->processParticles[gdata->mpi_rank], gdata->t);
+}
+
+/*! Compute the global positions, energies and gages from the host buffers,
+ * and write everything but the particle data. The writers that have been
+ * started are returned, and must be passed to finishWrite()
+ */
+WriterMap GPUSPH::startWrite(WriteFlags const& write_flags)
+{
+	PerfRegion region("doWrite");
+
 	// TODO FIXME skip unnecessary work based on write_flags
 	// (e.g. do not run whatever isn't needed by the HotWriter during a hot write)
 	uint node_offset = gdata->s_hStartPerDevice[0];
@@ -1709,18 +1913,86 @@ void GPUSPH::doWrite(WriteFlags const& write_flags)
 	PostProcessEngineSet const& enabledPostProcess = gdata->simframework->getPostProcEngines();
 	for (PostProcessEngineSet::const_iterator flt(enabledPostProcess.begin());
 		flt != enabledPostProcess.end(); ++flt) {
-		flt->second->write(writers, gdata->t);
+		// engines running on host write with the particle data
+		if (m_hostPostProcess.find(flt->first) == m_hostPostProcess.end())
+			flt->second->write(writers, gdata->t);
 	}
 
 	Writer::WriteEnergy(writers, gdata->t, energy);
 
+	return writers;
+}
+
+/*! Write the particle data, and the results of the host post-processing,
+ * and mark the writers as written at time t
+ */
+void GPUSPH::finishWrite(WriterMap writers, uint numParts, double t)
+{
+	PerfRegion region("doWrite");
+
+	for (auto const& flt : m_hostPostProcess)
+		flt.second->write(writers, t);
+
 	Writer::Write(writers,
-		gdata->processParticles[gdata->mpi_rank],
+		numParts,
 		gdata->s_hBuffers,
-		node_offset,
-		gdata->t, gdata->simframework->hasPostProcessEngine(TESTPOINTS));
+		gdata->s_hStartPerDevice[0],
+		t, gdata->simframework->hasPostProcessEngine(TESTPOINTS));
 
-	Writer::MarkWritten(writers, gdata->t);
+	Writer::MarkWritten(writers, t);
+}
+
+/*! The post-processing engines that only produce output fields get a host
+ * counterpart, that runs on the buffers downloaded for the write, instead of
+ * running on the devices before the download. Surface and interface detection
+ * update the particle info that the simulation itself reads, so they keep
+ * running on the devices.
+ */
+void GPUSPH::createHostPostProcess()
+{
+	// the host buffers of a node do not hold the neighbors from the other nodes
+	if (MULTI_NODE) {
+		fprintf(stderr, "WARNING: host post-processing is not supported in multi-node simulations, "
+			"running the post-processing on the devices\n");
+		return;
+	}
+
+	PostProcessEngineSet const& enabledPostProcess = gdata->simframework->getPostProcEngines();
+	for (auto const& flt : enabledPostProcess) {
+		const PostProcessType pptype = flt.first;
+		if (pptype != VORTICITY && pptype != TESTPOINTS && pptype != FLUX_COMPUTATION)
+			continue;
+
+		AbstractPostProcessEngine *engine =
+			new HostPostProcessEngine(pptype, flt.second->get_options(), problem);
+		engine->hostAllocate(gdata);
+		m_hostPostProcess[pptype] = engine;
+
+		printf("Post-processing %s will run on host\n", PostProcessName[pptype]);
+	}
+}
+
+void GPUSPH::runHostPostProcess(vector<AbstractPostProcessEngine*> const& engines, uint numParts)
+{
+	for (AbstractPostProcessEngine *engine : engines) {
+		engine->process(gdata->s_hBuffers, gdata->s_hBuffers, numParts, numParts, 0, gdata);
+		engine->hostProcess(gdata);
+	}
+}
+
+/*! The shared host buffers and the writers belong to the pending write until
+ * this is called, so it must be called before any further dump or write.
+ */
+void GPUSPH::completePendingWrite()
+{
+	if (!m_pendingPostProcess.valid())
+		return;
+
+	// rethrows any exception from the host post-processing
+	m_pendingPostProcess.get();
+
+	finishWrite(m_pendingWriters, m_pendingWriteParticles, m_pendingWriteTime);
+	m_pendingWriters.clear();
 }
 
 /*! Save the particle system to disk.
@@ -1736,6 +2008,9 @@ void GPUSPH::saveParticles(
 {
 	const SimParams * const simparams = problem->simparams();
 
+	// the host buffers are still in use by the previous write
+	completePendingWrite();
+
 	// set the buffers to be dumped
 	flag_t which_buffers = BUFFER_POS | BUFFER_VEL | BUFFER_INFO | BUFFER_HASH;
 
@@ -1784,12 +2059,32 @@ void GPUSPH::saveParticles(
 	if (simparams->simflags & ENABLE_INLET_OUTLET)
 		which_buffers |= BUFFER_NEXTID;
 
+	// fields with their own write frequency that are not due
+	// will not be written, so they need not be computed nor downloaded
+	const flag_t skipped_fields = Writer::SkippedFields(gdata->t, write_flags);
+
+	// post-process engines to run on host, after the dump
+	vector<AbstractPostProcessEngine*> host_engines;
+
 	// run post-process filters and dump their arrays
 	// TODO migrate post-processing commands to command structure
 	for (auto const& flt : enabledPostProcess) {
 		PostProcessType filter = flt.first;
 		AbstractPostProcessEngine *engine = flt.second;
 
+		// skip engines that only produce skipped fields
+		if (skipped_fields && !engine->get_updated_buffers() &&
+			!(engine->get_written_buffers() & ~skipped_fields))
+			continue;
+
+		// the host engines work on the buffers downloaded anyway
+		// (position, velocity, info and the model-specific ones)
+		PostProcessEngineSet::const_iterator host_engine(m_hostPostProcess.find(filter));
+		if (host_engine != m_hostPostProcess.end()) {
+			host_engines.push_back(host_engine->second);
+			continue;
+		}
+
 		dispatchCommand(POSTPROCESS, filter);
 
 		engine->hostProcess(gdata);
@@ -1837,13 +2132,34 @@ void GPUSPH::saveParticles(
 	if (write_flags.hot_write)
 		which_buffers &= ~EPHEMERAL_BUFFERS;
 
+	which_buffers &= ~skipped_fields;
+
 	// dump what we want to save
 	CommandStruct dump(DUMP);
 	dump.reading(state, which_buffers);
 	dispatchCommand(dump);
 
 	// triggers Writer->write()
-	doWrite(write_flags);
+	WriterMap writers = startWrite(write_flags);
+	const uint numParts = gdata->processParticles[gdata->mpi_rank];
+
+	// Forced writes are completed right away, since the HotWriter takes
+	// the simulation state from the global data at the time of writing.
+	// Otherwise, the devices go on with the simulation while the host
+	// post-processes the downloaded buffers, and the particle data is
+	// written by completePendingWrite()
+	if (host_engines.empty() || write_flags.forced_write || write_flags.hot_write) {
+		runHostPostProcess(host_engines, numParts);
+		finishWrite(writers, numParts, gdata->t);
+		return;
+	}
+
+	m_pendingWriters = writers;
+	m_pendingWriteParticles = numParts;
+	m_pendingWriteTime = gdata->t;
+	m_pendingPostProcess = async(launch::async, [this, host_engines, numParts]() {
+		runHostPostProcess(host_engines, numParts);
+	});
 }
 
 // scan and check the peak number of neighbors and the estimated number of interactions
@@ -1876,6 +2192,8 @@ void GPUSPH::runCommand<CHECK_NEIBSNUM>(CommandStruct const& cmd)
 	}
 
 	gdata->last_buildneibs_iteration = gdata->iterations;
+	gdata->nlMaxDisplacement = 0;
+	++gdata->neibsBuilds;
 }
 
 // find if new particles were created on any device
@@ -2153,6 +2471,7 @@ void GPUSPH::runCommand<UPDATE_ARRAY_INDICES>(CommandStruct const& cmd)
 
 				// who is missing? if single-node, do a roll call
 				if (SINGLE_NODE) {
+					completePendingWrite();
 					dispatchCommand(debug_dump);
 					rollCallParticles();
 				}
@@ -2234,6 +2553,16 @@ void GPUSPH::runCommand<DEBUG_DUMP>(CommandStruct const& cmd)
 void GPUSPH::check_write(bool we_are_done)
 {
 	static PostProcessEngineSet const& enabledPostProcess = gdata->simframework->getPostProcEngines();
+
+	// while the previous write is waiting for the host post-processing,
+	// new writes are only checked for when we have to write anyway
+	if (m_pendingPostProcess.valid()) {
+		if (!we_are_done && !gdata->save_request &&
+			m_pendingPostProcess.wait_for(chrono::seconds(0)) != future_status::ready)
+			return;
+		completePendingWrite();
+	}
+
 	// list of writers that need to write at this timestep
 	ConstWriterMap writers = Writer::NeedWrite(gdata->t);
 
@@ -2327,6 +2656,8 @@ void GPUSPH::runCommand<JACOBI_STOP_CRITERION>(CommandStruct const& cmd)
 //! so that on return from dispatchCommand() the TimerObject destructor updates the effective
 //! runtime of the corresponding object.
 //! \note Nested commands contribute to the calling command runtimes.
+//! If a set of hardware counters is also associated with the TimerObject,
+//! the counters of the calling thread are accumulated into it as well.
 struct TimerObject
 {
 	using clock = GPUSPH::cmd_time_clock;
@@ -2334,11 +2665,15 @@ struct TimerObject
 
 	duration &max_ref;
 	duration &tot_ref;
+	PerfCounterValues *counters_ptr;
+	PerfCounterSnapshot start_counters;
 	std::chrono::time_point<clock> start;
 
-	TimerObject(duration &max_ref_, duration &tot_ref_) :
+	TimerObject(duration &max_ref_, duration &tot_ref_, PerfCounterValues *counters_ptr_ = NULL) :
 		max_ref(max_ref_),
 		tot_ref(tot_ref_),
+		counters_ptr(counters_ptr_),
+		start_counters(counters_ptr ? PerfCounterGroup::thread_instance().read() : PerfCounterSnapshot()),
 		start(clock::now())
 	{ }
 
@@ -2349,6 +2684,10 @@ struct TimerObject
 		tot_ref += duration;
 		if (duration > max_ref)
 			max_ref = duration;
+		if (counters_ptr) {
+			*counters_ptr += perf_counters_delta(start_counters,
+				PerfCounterGroup::thread_instance().read());
+		}
 	}
 };
 
@@ -2356,11 +2695,15 @@ struct TimerObject
 void GPUSPH::dispatchCommand(CommandStruct const& cmd)
 {
 	shared_ptr<TimerObject> timer;
-	if (gdata->debug.benchmark_command_runtimes) {
+	if (gdata->debug.benchmark_command_runtimes || gdata->debug.benchmark_host_counters) {
+		// hardware counters are per-thread, so they are only meaningful
+		// for the commands that are run by the host thread itself
+		const bool host_command = cmd.command > NUM_WORKER_COMMANDS;
 		++cmd_calls[cmd.command];
 		timer = make_shared<TimerObject>(
 			max_cmd_time[cmd.command],
-			tot_cmd_time[cmd.command]);
+			tot_cmd_time[cmd.command],
+			(host_command && perf_counters_enabled()) ? &cmd_counters[cmd.command] : NULL);
 	}
 
 	// resetting the host buffers is useful to check if the arrays are completely filled
@@ -34,6 +34,8 @@
 
 #include <cstdio>
 #include <type_traits>
+#include <future>
+#include <vector>
 
 #include "Options.h"
 #include "GlobalData.h"
@@ -44,6 +46,9 @@
 // IPPSCounter
 #include "timing.h"
 
+// PerfCounterValues
+#include "perf_counters.h"
+
 // The GPUSPH class is singleton. Wise tips about a correct singleton implementation are give here:
 // http://stackoverflow.com/questions/1008019/c-singleton-design-pattern
 
@@ -77,6 +82,15 @@ private:
 	float m_peakParticleSpeed;
 	double m_peakParticleSpeedTime; // ...and when
 
+	// host counterparts of the post-processing engines (--host-postprocess)
+	PostProcessEngineSet m_hostPostProcess;
+	// host post-processing of the last write, running while the devices simulate,
+	// and what is needed to complete the write when it's done
+	std::future<void> m_pendingPostProcess;
+	WriterMap m_pendingWriters;
+	uint m_pendingWriteParticles;
+	double m_pendingWriteTime;
+
 	// other vars
 	bool initialized;
 	bool repacked;
@@ -85,6 +99,8 @@ private:
 
 protected:
 	friend class TimerObject;
+	// the host benchmarks (bench/) exercise the host-side methods directly
+	friend struct HostBenchmarks;
 
 	using cmd_time_clock = std::chrono::steady_clock;
 	using cmd_time_duration = cmd_time_clock::duration;
@@ -94,6 +110,8 @@ protected:
 	// Total time spent executing each command
 	cmd_time_duration tot_cmd_time[NUM_COMMANDS];
 	unsigned long cmd_calls[NUM_COMMANDS];
+	// Hardware counters accumulated over each (host) command
+	PerfCounterValues cmd_counters[NUM_COMMANDS];
 
 private:
 	// constructor and copy/assignment: private for singleton scheme
@@ -119,6 +137,10 @@ private:
 	// and return the number of open boundary vertices
 	uint initializeNextIDs(bool resumed);
 
+	// move the pages of the shared host buffers to the NUMA node of the device
+	// processing them, and report their placement
+	void placeGlobalHostBuffers();
+
 	// sort particles by device before uploading
 	void sortParticlesByHash();
 	// aux function for sorting; swaps particles in s_hPos, s_hVel, s_hInfo
@@ -151,6 +173,17 @@ private:
 
 	// use the writer, with additional options about forced writes
 	void doWrite(WriteFlags const& write_flags);
+	// the two halves of doWrite(): everything but the particle data,
+	// and the particle data (with the host post-processing results)
+	WriterMap startWrite(WriteFlags const& write_flags);
+	void finishWrite(WriterMap writers, uint numParts, double t);
+
+	// create the host counterparts of the post-processing engines
+	void createHostPostProcess();
+	// run the given host post-processing engines on the shared host buffers
+	void runHostPostProcess(std::vector<AbstractPostProcessEngine*> const& engines, uint numParts);
+	// wait for the host post-processing of the last write, and complete it
+	void completePendingWrite();
 
 	// save the particle system to disk
 	void saveParticles(PostProcessEngineSet const& enabledPostProcess,
@@ -85,6 +85,8 @@ GPUWorker::GPUWorker(GlobalData* _gdata, devcount_t _deviceIndex) :
 
 	m_hostMemory(0),
 	m_deviceMemory(0),
+	m_hostMemoryTag("host/worker" + to_string(_deviceIndex)),
+	m_deviceMemoryTag("device" + to_string(_deviceIndex)),
 
 	// set to true to force host staging even if peer access is set successfully
 	m_disableP2Ptranfers(false),
@@ -108,6 +110,8 @@ GPUWorker::GPUWorker(GlobalData* _gdata, devcount_t _deviceIndex) :
 {
 	printf("number of forces rigid bodies particles = %d\n", m_numForcesBodiesParticles);
 
+	m_dBuffers.set_name(m_deviceMemoryTag);
+	m_dBuffers.setArena(make_shared<CUDABufferArena>());
 	m_dBuffers.setAllocPolicy(gdata->simframework->getAllocPolicy());
 
 	m_dBuffers.addBuffer<CUDABuffer, BUFFER_POS>();
@@ -126,6 +130,7 @@ GPUWorker::GPUWorker(GlobalData* _gdata, devcount_t _deviceIndex) :
 	if (MULTI_DEVICE) {
 		m_dBuffers.addBuffer<CUDABuffer, BUFFER_COMPACT_DEV_MAP>();
 		m_hBuffers.addBuffer<HostBuffer, BUFFER_COMPACT_DEV_MAP>();
+		m_hBuffers.set_memory_tag_prefix(m_hostMemoryTag);
 	}
 
 	m_dBuffers.addBuffer<CUDABuffer, BUFFER_HASH>();
@@ -253,10 +258,6 @@ size_t GPUWorker::computeMemoryPerParticle()
 		// which is currently heavily overestimated
 		else if (key == BUFFERS_CFL)
 			contrib /= 4;
-		// particle index occupancy is double to account for memory allocated
-		// by thrust::sort TODO refine
-		else if (key == BUFFER_PARTINDEX)
-			contrib *= 2;
 
 		tot += contrib;
 #if _DEBUG_
@@ -271,6 +272,13 @@ size_t GPUWorker::computeMemoryPerParticle()
 	//float4*		m_dRbTorques;
 	//uint*		m_dRbNum;
 
+	// scratch of the particle sort: the temporary storage of each thrust
+	// algorithm, and the destination of the merge, are about a copy of the
+	// hash, info and index arrays, and the scratch is recycled between them
+	tot += sizeof(BufferTraits<BUFFER_HASH>::element_type) +
+		sizeof(BufferTraits<BUFFER_INFO>::element_type) +
+		sizeof(BufferTraits<BUFFER_PARTINDEX>::element_type);
+
 	// round up to next multiple of 4
 	tot = round_up<size_t>(tot, 4);
 	if (m_deviceIndex == 0)
@@ -967,6 +975,7 @@ size_t GPUWorker::allocateHostBuffers() {
 		cudaMallocHost(&(gdata->s_dCellStarts[m_deviceIndex]), uintCellsSize);
 		cudaMallocHost(&(gdata->s_dCellEnds[m_deviceIndex]), uintCellsSize);
 		allocated += 2*uintCellsSize;
+		memory_account_set(m_hostMemoryTag + "/cell starts and ends", 2*uintCellsSize);
 	}
 
 
@@ -987,6 +996,11 @@ size_t GPUWorker::allocateDeviceBuffers() {
 
 	const uint fmaxElements = forcesEngine->getFmaxElements(m_numAllocatedParticles);
 	const uint tempCflEls = forcesEngine->getFmaxTempElements(fmaxElements);
+
+	// collect the sizes first, so that all buffers are allocated at once
+	// from the device arena
+	ParticleSystem::BufferSizes buffer_sizes;
+
 	set<flag_t>::const_iterator iter = m_dBuffers.get_keys().begin();
 	set<flag_t>::const_iterator stop = m_dBuffers.get_keys().end();
 	while (iter != stop) {
@@ -1018,26 +1032,31 @@ size_t GPUWorker::allocateDeviceBuffers() {
 				nels = fmaxElements;
 		}
 
-		allocated += m_dBuffers.alloc(key, nels);
+		buffer_sizes[key] = nels;
 		++iter;
 	}
 
+	allocated += m_dBuffers.alloc(buffer_sizes);
+
 	if (MULTI_DEVICE) {
 		// alloc segment only if not single_device
 		CUDA_SAFE_CALL(cudaMalloc(&m_dSegmentStart, segmentsSize));
 		CUDA_SAFE_CALL(cudaMemset(m_dSegmentStart, 0, segmentsSize));
 		allocated += segmentsSize;
+		memory_account_alloc(m_deviceMemoryTag + "/other", segmentsSize);
 	}
 
 	// water depth at open boundaries
 	if (m_simparams->simflags & (ENABLE_INLET_OUTLET | ENABLE_WATER_DEPTH)) {
 		CUDA_SAFE_CALL(cudaMalloc((void**)&m_dIOwaterdepth, m_simparams->numOpenBoundaries*sizeof(uint)));
 		allocated += m_simparams->numOpenBoundaries*sizeof(uint);
+		memory_account_alloc(m_deviceMemoryTag + "/other", m_simparams->numOpenBoundaries*sizeof(uint));
 	}
 
 	// newNumParticles for inlets
 	CUDA_SAFE_CALL(cudaMalloc((void**)&m_dNewNumParticles, sizeof(uint)));
 	allocated += sizeof(uint);
+	memory_account_alloc(m_deviceMemoryTag + "/other", sizeof(uint));
 
 	if (m_simparams->numforcesbodies) {
 		uint* rbnum = new uint[m_numForcesBodiesParticles];
@@ -1077,13 +1096,18 @@ void GPUWorker::deallocateHostBuffers() {
 		cudaFreeHost(gdata->s_dCellStarts[m_deviceIndex]);
 		cudaFreeHost(gdata->s_dCellEnds[m_deviceIndex]);
 		free(gdata->s_dSegmentsStart[m_deviceIndex]);
+		memory_account_set(m_hostMemoryTag + "/cell starts and ends", 0);
 	}
 
-	if (m_hPeerTransferBuffer)
+	if (m_hPeerTransferBuffer) {
 		cudaFreeHost(m_hPeerTransferBuffer);
+		memory_account_set(m_hostMemoryTag + "/peer transfer buffer", 0);
+	}
 
-	if (m_hNetworkTransferBuffer)
+	if (m_hNetworkTransferBuffer) {
 		cudaFreeHost(m_hNetworkTransferBuffer);
+		memory_account_set(m_hostMemoryTag + "/network transfer buffer", 0);
+	}
 
 	// here: dem host buffers?
 }
@@ -1101,6 +1125,11 @@ void GPUWorker::deallocateDeviceBuffers() {
 	if (m_simparams->simflags & (ENABLE_INLET_OUTLET | ENABLE_WATER_DEPTH))
 		CUDA_SAFE_CALL(cudaFree(m_dIOwaterdepth));
 
+	memory_account_set(m_deviceMemoryTag + "/other", 0);
+
+	neibsEngine->releaseSortScratch();
+	memory_account_set(m_deviceMemoryTag + "/sort scratch", 0);
+
 	// here: dem device buffers?
 }
 
@@ -1352,6 +1381,7 @@ void GPUWorker::resizePeerTransferBuffer(size_t required_size)
 	// (re)allocate
 	CUDA_SAFE_CALL(cudaMallocHost(&m_hPeerTransferBuffer, m_hPeerTransferBufferSize));
 	m_hostMemory += m_hPeerTransferBufferSize;
+	memory_account_set(m_hostMemoryTag + "/peer transfer buffer", m_hPeerTransferBufferSize);
 }
 
 // analog to resizeTransferBuffer
@@ -1378,6 +1408,7 @@ void GPUWorker::resizeNetworkTransferBuffer(size_t required_size)
 	// (re)allocate
 	CUDA_SAFE_CALL(cudaMallocHost(&m_hNetworkTransferBuffer, m_hNetworkTransferBufferSize));
 	m_hostMemory += m_hNetworkTransferBufferSize;
+	memory_account_set(m_hostMemoryTag + "/network transfer buffer", m_hNetworkTransferBufferSize);
 }
 
 // download cellStart and cellEnd to the shared arrays
@@ -1815,6 +1846,7 @@ void GPUWorker::runCommand<SORT>(CommandStruct const& cmd)
 			BufferList(), /* there aren't any buffers that are only read by SORT */
 			bufwrite,
 			numPartsToElaborate);
+	memory_account_set(m_deviceMemoryTag + "/sort scratch", neibsEngine->sortScratchSize());
 
 	m_dBuffers.change_buffers_state(bufwrite.get_updated_buffers(), cmd.src, cmd.dst);
 	bufwrite.clear_pending_state();
@@ -1897,6 +1929,22 @@ void GPUWorker::runCommand<BUILDNEIBS>(CommandStruct const& cmd)
 	bufwrite.clear_pending_state();
 }
 
+template<>
+void GPUWorker::runCommand<FIND_MAX_SPEED>(CommandStruct const& cmd)
+// void GPUWorker::kernel_findMaxSpeed()
+{
+	uint numPartsToElaborate = (cmd.only_internal ? m_particleRangeEnd : m_numParticles);
+
+	gdata->maxSpeeds[m_deviceIndex] = 0;
+
+	// is the device empty? (unlikely but possible before LB kicks in)
+	if (numPartsToElaborate == 0) return;
+
+	const BufferList bufread = extractExistingBufferList(m_dBuffers, cmd.reads);
+
+	gdata->maxSpeeds[m_deviceIndex] = neibsEngine->maxSpeed(bufread, numPartsToElaborate);
+}
+
 // returns numBlocks as computed by forces()
 uint GPUWorker::enqueueForcesOnRange(CommandStruct const& cmd,
 	BufferListPair& buffer_lists, uint fromParticle, uint toParticle, uint cflOffset)
@@ -3237,6 +3285,13 @@ void GPUWorker::simulationThread() {
 
 		setDeviceProperties( checkCUDA(gdata, m_deviceIndex) );
 
+		// run on the NUMA node of the device, where its share of the
+		// shared host buffers has been placed
+		if (gdata->numaPolicy != NUMA_NONE &&
+			!numa_bind_thread(gdata->deviceNumaNode[m_deviceIndex]))
+			printf("WARNING: could not bind thread for device %u to NUMA node %d\n",
+				m_deviceIndex, gdata->deviceNumaNode[m_deviceIndex]);
+
 		initialize();
 
 		gdata->threadSynchronizer->barrier(); // end of INITIALIZATION ***
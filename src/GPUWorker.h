@@ -117,6 +117,9 @@ private:
 	// memory allocated
 	size_t m_hostMemory;
 	size_t m_deviceMemory;
+	// tag prefixes for the memory accounting of this worker (see memory_accounting.h)
+	const std::string m_hostMemoryTag;
+	const std::string m_deviceMemoryTag;
 
 	// it would be easier to put the device properties in a shared array in GlobalData;
 	// this, however, would violate the principle that any CUDA-related code should be
@@ -264,6 +267,7 @@ private:
 	// runCommand<SORT> = void kernel_sort();
 	// runCommand<REORDER> = void kernel_reorderDataAndFindCellStart();
 	// runCommand<BUILDNEIBS> = void kernel_buildNeibsList();
+	// runCommand<FIND_MAX_SPEED> = void kernel_findMaxSpeed();
 	// runCommand<FORCES_SYNC> = void kernel_forces();
 	// runCommand<EULER> = void kernel_euler();
 	// runCommand<DENSITY_SUM> = void kernel_density_sum();
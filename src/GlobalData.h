@@ -89,6 +89,9 @@ class Writer;
 
 #include "debugflags.h"
 
+// NumaPolicy
+#include "numa_placement.h"
+
 // The GlobalData struct can be considered as a set of pointers. Different pointers may be initialized
 // by different classes in different phases of the initialization. Pointers should be used in the code
 // only where we are sure they were already initialized.
@@ -104,6 +107,11 @@ struct GlobalData {
 	devcount_t devices;
 	// array of cuda device numbers
 	unsigned int device[MAX_DEVICES_PER_NODE];
+	// NUMA node each device is attached to (-1 if unknown)
+	int deviceNumaNode[MAX_DEVICES_PER_NODE];
+
+	// placement policy for the global host buffers
+	NumaPolicy numaPolicy;
 
 	// MPI vars
 	devcount_t mpi_nodes; // # of MPI nodes. 0 if network manager is not initialized, 1 if no other nodes (only multi-gpu)
@@ -180,6 +188,15 @@ struct GlobalData {
 	// last dt for each PS
 	float dts[MAX_DEVICES_PER_NODE];
 
+	// adaptive neighbors list construction: maximum particle speed on each device
+	// at the end of the last step, its (global) value at the end of the previous step,
+	// and the resulting bound on the particle displacement since the last construction
+	float maxSpeeds[MAX_DEVICES_PER_NODE];
+	float lastMaxSpeed;
+	double nlMaxDisplacement;
+	// number of neighbors list constructions
+	unsigned long neibsBuilds;
+
 	// indicates whether particles were created at open boundaries
 	bool	particlesCreatedOnNode[MAX_DEVICES_PER_NODE];
 	bool	particlesCreated;
@@ -285,6 +302,7 @@ struct GlobalData {
 		ret(0),
 		debug(),
 		devices(0),
+		numaPolicy(NUMA_NONE),
 		mpi_nodes(0),
 		mpi_rank(-1),
 		totDevices(0),
@@ -341,6 +359,16 @@ struct GlobalData {
 		for (uint d=0; d < MAX_DEVICES_PER_NODE; d++)
 			dts[d] = 0.0F;
 
+		// the first neighbors list construction is always needed
+		for (uint d=0; d < MAX_DEVICES_PER_NODE; d++)
+			maxSpeeds[d] = 0.0F;
+		lastMaxSpeed = 0.0F;
+		nlMaxDisplacement = INFINITY;
+		neibsBuilds = 0;
+
+		for (uint d=0; d < MAX_DEVICES_PER_NODE; d++)
+			deviceNumaNode[d] = -1;
+
 		// init Jacobi solver auxiliary data
 		for (uint d=0; d < MAX_DEVICES_PER_NODE; d++) {
 			h_jacobiResidual[d] = NAN;
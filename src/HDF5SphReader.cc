@@ -93,12 +93,7 @@ HDF5SphReader::read()
 	if (npart == UINT_MAX)
 		getNParts();
 	cout << "Reading particle data from the input: " << filename << endl;
-	if(buf == NULL)
-		buf = new ReadParticles[npart];
-	else{
-		delete [] buf;
-		buf = new ReadParticles[npart];
-	}
+	allocBuffer();
 	hid_t		mem_type_id, loc_id, dataset_id, file_space_id, mem_space_id;
 	hsize_t		count[RANK], offset[RANK];
 	herr_t		status;
@@ -80,15 +80,31 @@ Integrator::enter_phase(size_t phase_idx)
 
 //! A function that determines if we should build the neighbors list
 /**! This is only done every buildneibsfreq or if particles got created,
- * but only if we didn't do it already in this iteration
+ * but only if we didn't do it already in this iteration.
+ * With buildneibsfreq = 0 (adaptive construction), the list is rebuilt
+ * when particles may have moved by more than half the skin
+ * (nlexpansionfactor - 1)*influenceRadius since the last construction,
+ * so that no pair of particles can have come into interaction range unseen.
+ * The displacement is bounded by the sum over the steps of dt times the
+ * maximum particle speed (see FIND_MAX_SPEED).
+ * Adaptive construction needs a skin: ProblemCore::initialize() rejects
+ * it if nlexpansionfactor is not larger than 1.
  */
 bool needs_new_neibs(Integrator::Phase const*, GlobalData const* gdata)
 {
 	const unsigned long iterations = gdata->iterations;
 	const SimParams* sp = gdata->problem->simparams();
 
-	return (iterations != gdata->last_buildneibs_iteration) &&
-		((iterations % sp->buildneibsfreq == 0) || gdata->particlesCreated);
+	if (iterations == gdata->last_buildneibs_iteration)
+		return false;
+	if (gdata->particlesCreated)
+		return true;
+
+	if (sp->buildneibsfreq > 0)
+		return iterations % sp->buildneibsfreq == 0;
+
+	const double skin = (sp->nlexpansionfactor - 1)*sp->influenceRadius;
+	return 2*gdata->nlMaxDisplacement >= skin;
 }
 
 Integrator::Phase *
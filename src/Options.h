@@ -75,7 +75,11 @@ public:
 	unsigned int repack_maxiter; ///< maximum number of iterations for repacking
 	float	checkpoint_freq; ///< frequency of hotstart checkpoints (in simulated seconds)
 	int		checkpoints; ///< number of hotstart checkpoints to keep
+	int		checkpoint_full_every; ///< write a full hotstart file every this many checkpoints, deltas in between
+	bool	checkpoint_compress; ///< compress the hotstart files
 	bool	nosave; ///< disable saving
+	bool	binary_series; ///< write the time series in columnar binary format
+	bool	host_postprocess; ///< run the post-processing on host, while the devices go on simulating
 	bool	gpudirect; ///< enable GPUDirect
 	bool	striping; ///< enable striping (i.e. compute/transfer overlap)
 	bool	asyncNetworkTransfers; ///< enable asynchronous network transfers
@@ -104,7 +108,11 @@ public:
 		repack_maxiter(0),
 		checkpoint_freq(NAN),
 		checkpoints(-1),
+		checkpoint_full_every(-1),
+		checkpoint_compress(false),
 		nosave(false),
+		binary_series(false),
+		host_postprocess(false),
 		gpudirect(false),
 		striping(false),
 		asyncNetworkTransfers(false),
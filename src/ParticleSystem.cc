@@ -78,6 +78,25 @@ void ParticleSystem::pool_buffer(flag_t key, ptr_type buf)
 	buf->clear_state();
 }
 
+void ParticleSystem::account_state(string const& state)
+{
+	if (m_name.empty())
+		return;
+
+	size_t memory = 0;
+	auto found = m_state.find(state);
+	if (found != m_state.end())
+		for (auto const& kb : found->second)
+			memory += kb.second->get_accounted_memory();
+
+	// only update the accounting when something changed
+	size_t& accounted = m_state_memory[state];
+	if (accounted == memory)
+		return;
+	accounted = memory;
+	memory_account_set("states/" + m_name + "/" + state, memory);
+}
+
 ptr_type ParticleSystem::add_buffer_to_state(State& dst, flag_t key)
 {
 	auto& bufvec = m_pool.at(key);
@@ -92,6 +111,7 @@ ptr_type ParticleSystem::add_buffer_to_state(State& dst, flag_t key)
 	dst.addExistingBuffer(key, buf);
 	buf->set_state(dst.name());
 	bufvec.pop_back();
+	account_state(dst.name());
 	return buf;
 }
 
@@ -105,8 +125,16 @@ void ParticleSystem::clear()
 	m_state.clear();
 	m_pool.clear();
 
+	for (auto const& sm : m_state_memory)
+		account_state(sm.first);
+
 	// and purge the list of keys too
 	m_buffer_keys.clear();
+
+	// return the arena memory to the system, unless some buffer
+	// is still being held elsewhere
+	if (m_arena && m_arena.use_count() == 1)
+		m_arena->release();
 }
 
 string ParticleSystem::inspect() const
@@ -204,6 +232,9 @@ void ParticleSystem::change_buffers_state(flag_t keys,
 	for (auto& key : processed) {
 		src.removeBuffer(key);
 	}
+
+	account_state(src_state);
+	account_state(dst_state);
 }
 
 void ParticleSystem::swap_state_buffers(
@@ -260,6 +291,8 @@ void ParticleSystem::remove_state_buffers(string const& state, flag_t req_keys)
 	for (auto& key : present) {
 		list.removeBuffer(key);
 	}
+
+	account_state(state);
 }
 
 State& ParticleSystem::initialize_state(string const& state)
@@ -283,6 +316,7 @@ void ParticleSystem::release_state(string const& state)
 			pool_buffer(kb);
 	}
 	m_state.erase(state);
+	account_state(state);
 }
 
 void ParticleSystem::rename_state(string const& old_state, string const& new_state)
@@ -306,6 +340,9 @@ void ParticleSystem::rename_state(string const& old_state, string const& new_sta
 
 		buf->replace_state(old_state, new_state);
 	}
+
+	account_state(old_state);
+	account_state(new_state);
 }
 
 void ParticleSystem::share_buffers(string const& src_state, string const& dst_state,
@@ -339,6 +376,8 @@ void ParticleSystem::share_buffers(string const& src_state, string const& dst_st
 		dst.replaceBuffer(key, pair.second);
 		pool_buffer(key, old);
 	}
+
+	account_state(dst_state);
 }
 
 BufferList ParticleSystem::state_subset(string const& state, flag_t selection)
@@ -382,6 +421,28 @@ ptr_type ParticleSystem::get_state_buffer(string const& state, flag_t key)
 	return buf;
 }
 
+size_t ParticleSystem::alloc(BufferSizes const& sizes)
+{
+	if (m_arena) {
+		// the space needed in the arena, taking into account the slice alignment
+		size_t needed = 0;
+		for (auto const& kn : sizes) {
+			const flag_t key = kn.first;
+			if (m_buffer_keys.find(key) == m_buffer_keys.end())
+				continue;
+			const auto buf = m_pool.at(key).front();
+			const size_t slices = m_policy->get_buffer_count(key)*buf->get_array_count();
+			needed += slices*BufferArena::slice_size(buf->get_element_size()*kn.second);
+		}
+		m_arena->reserve(needed);
+	}
+
+	size_t allocated = 0;
+	for (auto const& kn : sizes)
+		allocated += alloc(kn.first, kn.second);
+	return allocated;
+}
+
 size_t ParticleSystem::get_memory_occupation(flag_t Key, size_t nels) const
 {
 	// return 0 unless the buffer was actually added
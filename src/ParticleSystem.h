@@ -125,6 +125,23 @@ private:
 	// of keys available in m_pool.
 	std::set<flag_t> m_buffer_keys;
 
+	// Name of the particle system, used as prefix for memory accounting
+	// (see memory_accounting.h); no accounting is done if empty
+	std::string m_name;
+
+	// Memory last accounted for each state
+	std::map<std::string, size_t> m_state_memory;
+
+	// Arena the buffers are allocated from, if any
+	std::shared_ptr<BufferArena> m_arena;
+
+	//! Update the memory accounting for the given state
+	/*! The state memory is the total memory of the buffers it holds,
+	 * including the ones shared with other states. The state is
+	 * accounted as empty if it doesn't exist (anymore).
+	 */
+	void account_state(std::string const& state);
+
 	//! Put a buffer back into the pool
 	void pool_buffer(flag_t key, ptr_type buf);
 
@@ -157,6 +174,32 @@ public:
 
 	std::string inspect() const;
 
+	//! Set the name used to account the memory of this particle system
+	/*! Buffers are accounted under <name>/<buffer name>, and the states
+	 * under states/<name>/<state name>. Must be set before adding buffers.
+	 */
+	inline void set_name(std::string const& name)
+	{
+		if (!m_buffer_keys.empty())
+			throw std::runtime_error("cannot change particle system name after adding buffers");
+		m_name = name;
+	}
+
+	inline std::string const& name() const
+	{ return m_name; }
+
+	//! Set the arena to allocate all the buffers from
+	/*! Must be set before adding buffers. The arena is reserved
+	 * for all the buffers at once by alloc(BufferSizes), and it is
+	 * released on clear() when no buffer is using it anymore.
+	 */
+	inline void setArena(std::shared_ptr<BufferArena> arena)
+	{
+		if (!m_buffer_keys.empty())
+			throw std::runtime_error("cannot change particle system arena after adding buffers");
+		m_arena = arena;
+	}
+
 	inline void setAllocPolicy(std::shared_ptr<const BufferAllocPolicy> _policy)
 	{
 		if (m_policy)
@@ -186,6 +229,10 @@ public:
 				buff->set_uid("0U" + std::to_string(Key));
 			else
 				buff->set_uid( std::string(1, 'A' + c) + std::to_string(Key) );
+			if (!m_name.empty())
+				buff->set_memory_tag(m_name + "/" + BufferTraits<Key>::name);
+			if (m_arena)
+				buff->set_arena(m_arena);
 			m_pool[Key].push_back(buff);
 		}
 	}
@@ -273,6 +320,15 @@ public:
 		return allocated;
 	}
 
+	//! Number of elements to allocate for each buffer
+	typedef std::map<flag_t, size_t> BufferSizes;
+
+	/* Allocate all the necessary copies of all the given buffers,
+	 * returning the total amount of memory used.
+	 * If an arena is set, it is reserved for all of them beforehand,
+	 * so that they are carved out of a single block */
+	size_t alloc(BufferSizes const& sizes);
+
 	/* Get the buffer list of a specific state */
 	State& getState(std::string const& str)
 	{ return m_state.at(str); }
@@ -117,6 +117,12 @@ ProblemCore::initialize()
 			"Viscous computation will not be optimized\n");
 	}
 
+	// without a skin, the list would have to be rebuilt at every iteration
+	if (_sp->buildneibsfreq == 0 && !(_sp->nlexpansionfactor > 1)) {
+		throw invalid_argument("adaptive neighbors list construction (buildneibsfreq = 0) "
+			"needs a neighbors list expansion factor larger than 1, see set_neiblist_expansion()");
+	}
+
 	// run post-construction functions
 	check_dt();
 	check_neiblistsize();
@@ -1005,6 +1011,12 @@ ProblemCore::add_writer(WriterType wt, double freq)
 	m_writers.push_back(make_pair(wt, freq));
 }
 
+void
+ProblemCore::set_field_write_freq(flag_t fields, double freq)
+{
+	m_field_freqs.push_back(make_pair(fields, freq));
+}
+
 
 // override in problems where you want to save
 // at specific times regardless of standard conditions
@@ -87,6 +87,8 @@ class ProblemCore
 	private:
 		std::string			m_problem_dir;
 		WriterList		m_writers;
+		OutputFilterMap	m_output_filters;
+		FieldFreqList	m_field_freqs;
 
 		const float		*m_dem;
 		int				m_ncols, m_nrows;
@@ -500,6 +502,23 @@ class ProblemCore
 		WriterList const& get_writers() const
 		{ return m_writers; }
 
+		// filter of the particles written by the given writer
+		// (e.g. regions of interest, decimation; see OutputFilter.h)
+		OutputFilter& output_filter(WriterType wt)
+		{ return m_output_filters[wt]; }
+
+		// return the output filters
+		OutputFilterMap const& get_output_filters() const
+		{ return m_output_filters; }
+
+		// write the given particle buffers (e.g. BUFFER_VORTICITY | BUFFER_TAU)
+		// only every freq (fractions of) seconds, rather than at every write
+		void set_field_write_freq(flag_t fields, double freq);
+
+		// return the fields with their own write frequency
+		FieldFreqList const& get_field_write_freqs() const
+		{ return m_field_freqs; }
+
 		/*!
 		 overridden in subclasses if they want explicit writes
 		 beyond those controlled by the writer(s) periodic time
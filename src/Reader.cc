@@ -29,8 +29,10 @@
 #include <fstream>
 
 #include "Reader.h"
+#include "memory_accounting.h"
 
 Reader::Reader(void) :
+	m_bufParts(0),
 	filename(),
 	npart(SIZE_MAX),
 	buf(NULL)
@@ -40,12 +42,23 @@ Reader::~Reader(void) {
 	empty();
 }
 
+void
+Reader::allocBuffer()
+{
+	empty();
+	buf = new ReadParticles[npart];
+	m_bufParts = npart;
+	memory_account_alloc("host/readers", m_bufParts*sizeof(ReadParticles));
+}
+
 void
 Reader::empty()
 {
 	if (buf != NULL){
 		delete [] buf;
 		buf = NULL;
+		memory_account_free("host/readers", m_bufParts*sizeof(ReadParticles));
+		m_bufParts = 0;
 	}
 }
 
@@ -56,9 +56,15 @@ struct ReadParticles {
 
 class Reader
 {
+	// number of particles buf was allocated for
+	size_t	m_bufParts;
+
 protected:
 	std::string		filename;
 	size_t	npart;
+
+	//! (re)allocates the buffer for npart particles
+	void allocBuffer(void);
 public:
 	Reader(void);
 	virtual ~Reader(void);
@@ -30,60 +30,90 @@
 #include <sstream>
 #include <string>
 #include <cstring>
+#include <memory>
 #include <stdexcept>
 
 #include <limits.h> // UINT_MAX
 
+#include "zlib_select.opt"
+
+#if USE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "VTUReader.h"
+#include "mapped_file.h"
 
 using namespace std;
 
 size_t
-VTUReader::getNParts()
+VTUReader::parseHeader(pugi::xml_document &header)
 {
-	pugi::xml_document vtuFile;
 	ostringstream err_msg;
 
-	if (!vtuFile.load_file(filename.c_str())) {
-		// open binary file for reading to check if we have an appended data xml entry
-		ifstream binaryFile(filename.c_str(), ifstream::in | ifstream::binary);
-		if (!binaryFile.is_open()) {
-			err_msg << "Cannot open " <<  filename.c_str() << "!\n";
-			throw runtime_error(err_msg.str());
-		}
-		// search for <AppendedData
-		stringstream bufferss;
-		bufferss << binaryFile.rdbuf();
-		string buffer(bufferss.str());
-		size_t startData = buffer.find("<AppendedData");
-		if (startData == string::npos) {
-			err_msg << "FATAL: Could not find <AppendedData in file " << filename << "!\n";
-			throw runtime_error(err_msg.str());
-		}
-		// now look for the closing ">" of the <AppendData .... > node. This is where the data will start
-		startData = buffer.find(">", startData);
-		if (startData == string::npos) {
-			err_msg << "FATAL: Could not find closing > of AppendedData node in file " << filename << "!\n";
-			throw runtime_error(err_msg.str());
-		}
-		// the data starts after the ">" so increase count by 1
-		startData++;
-		// the data will end at the last occurance of </AppendData so look for it
-		size_t endData = buffer.rfind("</AppendedData");
-		if (endData == string::npos && startData < endData) {
-			err_msg << "FATAL: Could not identify end of data in file " << filename << "!\n";
-			throw runtime_error(err_msg.str());
-		}
-		// remove the binary data in the original file to get a valid xml file in the buffer string
-		buffer.replace(startData, endData-startData, "");
-		// load that xml file with pugixml
-		if(!vtuFile.load_string(buffer.c_str(), buffer.size())) {
-			err_msg << "FATAL: Cannot open " << filename << " using the xml parser even after removing binary data.\n";
+	ifstream vtuFile(filename.c_str(), ifstream::in | ifstream::binary);
+	if (!vtuFile.is_open()) {
+		err_msg << "Cannot open " <<  filename.c_str() << "!\n";
+		throw runtime_error(err_msg.str());
+	}
+
+	// read the file a chunk at a time, until we find the data start marker
+	// (the _ after the opening AppendedData tag), or the end of the file
+	static const char appendedTag[] = "<AppendedData";
+	vector<char> chunk(64*1024);
+	string text;
+	size_t tagStart = string::npos;
+	size_t tagEnd = string::npos;
+	size_t dataStart = string::npos;
+	while (dataStart == string::npos && vtuFile) {
+		vtuFile.read(chunk.data(), chunk.size());
+		// the tag may straddle the chunk boundary
+		const size_t searchFrom = text.size() > sizeof(appendedTag) ? text.size() - sizeof(appendedTag) : 0;
+		text.append(chunk.data(), vtuFile.gcount());
+
+		if (tagStart == string::npos)
+			tagStart = text.find(appendedTag, searchFrom);
+		if (tagStart != string::npos && tagEnd == string::npos)
+			tagEnd = text.find('>', tagStart);
+		if (tagEnd != string::npos)
+			dataStart = text.find('_', tagEnd);
+	}
+
+	if (tagStart == string::npos) {
+		// no appended data: the whole file is XML
+		if (!header.load_buffer(text.data(), text.size())) {
+			err_msg << "FATAL: Cannot open " << filename << " using the xml parser.\n";
 			throw runtime_error(err_msg.str());
 		}
-		binaryFile.close();
+		return 0;
+	}
+
+	if (dataStart == string::npos) {
+		err_msg << "FATAL: Could not find the start of the AppendedData in file " << filename << "!\n";
+		throw runtime_error(err_msg.str());
 	}
 
+	// close the AppendedData and VTKFile nodes right after the opening tag,
+	// to get a valid XML document without the data
+	text.resize(tagEnd);
+	text += "/></VTKFile>";
+	if (!header.load_buffer(text.data(), text.size())) {
+		err_msg << "FATAL: Cannot open " << filename << " using the xml parser even after removing binary data.\n";
+		throw runtime_error(err_msg.str());
+	}
+
+	// the data starts after the _
+	return dataStart + 1;
+}
+
+size_t
+VTUReader::getNParts()
+{
+	pugi::xml_document vtuFile;
+	ostringstream err_msg;
+
+	parseHeader(vtuFile);
+
 	pugi::xml_node vtkFile = vtuFile.child("VTKFile");
 	if (!vtkFile) {
 		err_msg << "FATAL: " << filename << " is not a valid vtk file\n";
@@ -121,60 +151,14 @@ VTUReader::read()
 	cout << "Reading particle data from the input: " << filename << endl;
 
 	// allocating read buffer
-	if(buf == NULL)
-		buf = new ReadParticles[npart];
-	else{
-		delete [] buf;
-		buf = new ReadParticles[npart];
-	}
+	allocBuffer();
 
 	pugi::xml_document vtuFile;
-	string binaryData;
 	ostringstream err_msg;
 	// big endian encoding
 	bool bigEndian = true;
 
-	if (!vtuFile.load_file(filename.c_str())) {
-		// open binary file for reading to check if we have an appended data xml entry
-		ifstream binaryFile(filename.c_str(), ifstream::in | ifstream::binary);
-		if (!binaryFile.is_open()) {
-			err_msg << "Cannot open " <<  filename.c_str() << "!\n";
-			throw runtime_error(err_msg.str());
-		}
-		// search for <AppendedData
-		stringstream bufferss;
-		bufferss << binaryFile.rdbuf();
-		string buffer(bufferss.str());
-		size_t startData = buffer.find("<AppendedData");
-		if (startData == string::npos) {
-			err_msg << "FATAL: Could not find <AppendedData in file " << filename << "!\n";
-			throw runtime_error(err_msg.str());
-		}
-		// now look for the closing ">" of the <AppendData .... > node. This is where the data will start
-		startData = buffer.find(">", startData);
-		if (startData == string::npos) {
-			err_msg << "FATAL: Could not find closing > of AppendedData node in file " << filename << "!\n";
-			throw runtime_error(err_msg.str());
-		}
-		// the data starts after the ">" so increase count by 1
-		startData++;
-		// the data will end at the last occurance of </AppendData so look for it
-		size_t endData = buffer.rfind("</AppendedData");
-		if (endData == string::npos && startData < endData) {
-			err_msg << "FATAL: Could not identify end of data in file " << filename << "!\n";
-			throw runtime_error(err_msg.str());
-		}
-		// put the binary data into the binaryData string for access later on
-		binaryData = buffer.substr(startData, endData-startData);
-		// remove the binary data in the original file to get a valid xml file in the buffer string
-		buffer.replace(startData, endData-startData, "");
-		// load that xml file with pugixml
-		if(!vtuFile.load_string(buffer.c_str(), buffer.size())) {
-			err_msg << "FATAL: Cannot open " << filename << " using the xml parser even after removing binary data.\n";
-			throw runtime_error(err_msg.str());
-		}
-		binaryFile.close();
-	}
+	const size_t appendedStart = parseHeader(vtuFile);
 
 	pugi::xml_node vtkFile = vtuFile.child("VTKFile");
 	if (!vtkFile) {
@@ -192,15 +176,68 @@ VTUReader::read()
 		char c[sizeof(uint)];
 	} bint = {0x01020304};
 	const bool localBigEndian = (bint.c[0] == 1);
+
+	AppendedData appended;
+	appended.data = NULL;
+	appended.size = 0;
 	// if the byte order on the machine is different from the one in the file make sure we swap later on
-	const bool swapRequired = bigEndian != localBigEndian;
+	appended.swapRequired = bigEndian != localBigEndian;
 
 	// Determine header int size
-	uint sizeofHeader = 4;
+	appended.sizeofHeader = 4;
 	// this attribute only exists in vtk version 1.0
 	// by default it's uint32 (also in vtk version 0.1)
 	if (vtkFile.attribute("header_type")) {
-		if (!strcmp(vtkFile.attribute("header_type").value(), "UInt64")) sizeofHeader = 8;
+		if (!strcmp(vtkFile.attribute("header_type").value(), "UInt64")) appended.sizeofHeader = 8;
+	}
+
+	// data compression
+	appended.compressed = false;
+	if (vtkFile.attribute("compressor")) {
+		if (strcmp(vtkFile.attribute("compressor").value(), "vtkZLibDataCompressor")) {
+			err_msg << "FATAL: VTK reader does not support compressor " <<
+				vtkFile.attribute("compressor").value() << " in file " << filename << "!\n";
+			throw runtime_error(err_msg.str());
+		}
+		appended.compressed = true;
+	}
+
+	// map the file, and locate the appended data
+	unique_ptr<MappedFile> mapped;
+	// decoded data, for base64-encoded appended data
+	vector<BYTE> decoded;
+	pugi::xml_node appData = vtkFile.child("AppendedData");
+	if (appData) {
+		mapped.reset(new MappedFile(filename));
+		if (appendedStart > mapped->size()) {
+			err_msg << "FATAL: Truncated AppendedData in file " << filename << "!\n";
+			throw runtime_error(err_msg.str());
+		}
+		const char *start = mapped->data() + appendedStart;
+		const char *end = mapped->data() + mapped->size();
+
+		bool dataEncoded = true;
+		if (appData.attribute("encoding")) {
+			if (!strcmp(appData.attribute("encoding").value(), "raw")) dataEncoded = false;
+		}
+
+		if (dataEncoded) {
+			// the text data ends at the closing AppendedData tag
+			static const char closingTag[] = "</AppendedData";
+			const char *close = end - (sizeof(closingTag) - 1);
+			while (close > start && strncmp(close, closingTag, sizeof(closingTag) - 1))
+				--close;
+			if (close <= start) {
+				err_msg << "FATAL: Could not identify end of data in file " << filename << "!\n";
+				throw runtime_error(err_msg.str());
+			}
+			decoded = base64_decode(string(start, close));
+			appended.data = decoded.data();
+			appended.size = decoded.size();
+		} else {
+			appended.data = (const BYTE*)start;
+			appended.size = end - start;
+		}
 	}
 
 	pugi::xml_node uGrid = vtkFile.child("UnstructuredGrid");
@@ -278,7 +315,7 @@ VTUReader::read()
 		}
 
 		if (doRead)
-			readData(da, data0, data1, data2, swapRequired, sizeofHeader, binaryData, vtkFile);
+			readData(da, data0, data1, data2, appended);
 	}
 
 	if (counter != 9) {
@@ -302,7 +339,7 @@ VTUReader::read()
 	data1 = (void*) &buf[0].Coords_1;
 	data2 = (void*) &buf[0].Coords_2;
 
-	readData(da, data0, data1, data2, swapRequired, sizeofHeader, binaryData, vtkFile);
+	readData(da, data0, data1, data2, appended);
 
 	return;
 }
@@ -311,10 +348,7 @@ void VTUReader::readData(	pugi::xml_node	da,
 							void*			data0,
 							void*			data1,
 							void*			data2,
-							bool			swapRequired,
-							uint			sizeofHeader,
-							string			&binaryData,
-							pugi::xml_node	vtkFile)
+							AppendedData const& appended)
 {
 	ostringstream err_msg;
 	uint numberOfComponents = 1;
@@ -325,27 +359,35 @@ void VTUReader::readData(	pugi::xml_node	da,
 	switch (numberOfComponents) {
 	case 1:
 		if(!data0) {
-			err_msg << "FATAL: VTK reader void array not initialized correctly for 1 component with variable " << da.attribute("Name") << "!\n";
+			err_msg << "FATAL: VTK reader void array not initialized correctly for 1 component with variable " << da.attribute("Name").value() << "!\n";
 			throw runtime_error(err_msg.str());
 		}
 		break;
 	case 3:
 		if(!data0 || !data1 || !data2) {
-			err_msg << "FATAL: VTK reader void array not initialized correctly for 3 components with variable " << da.attribute("Name") << "!\n";
+			err_msg << "FATAL: VTK reader void array not initialized correctly for 3 components with variable " << da.attribute("Name").value() << "!\n";
 			throw runtime_error(err_msg.str());
 		}
 		break;
 	default:
-		err_msg << "FATAL: VTK reader found array with " << numberOfComponents << " components at variable " << da.attribute("Name") << "!\n";
+		err_msg << "FATAL: VTK reader found array with " << numberOfComponents << " components at variable " << da.attribute("Name").value() << "!\n";
 		throw runtime_error(err_msg.str());
 	}
 
 	string format = "ascii";
-	if (da.attribute("format")) {
+	if (da.attribute("format"))
 		format = da.attribute("format").value();
-		if (format.compare("ascii") && format.compare("binary") && format.compare("appended")) {
-			printf("Fatal: VTK reader discovered unkown format: %s in file %s\n", format.c_str(), filename.c_str());
-		}
+	if (format == "ascii")
+		throw std::runtime_error("Inline ASCII data is not supported");
+	if (format == "binary")
+		throw std::runtime_error("Inline binary data is not supported");
+	if (format != "appended") {
+		err_msg << "FATAL: VTK reader discovered unknown format " << format << " in file " << filename << "!\n";
+		throw runtime_error(err_msg.str());
+	}
+	if (!appended.data) {
+		err_msg << "FATAL: VTK reader cannot find a AppendedData child in the VTKFile node in file " << filename << "!\n";
+		throw runtime_error(err_msg.str());
 	}
 
 	string type = "";
@@ -357,7 +399,7 @@ void VTUReader::readData(	pugi::xml_node	da,
 		else if (tmp.find("Int") != string::npos)
 			type = "int";
 		else {
-			err_msg << "FATAL: VTK reader found array with unkown type " << tmp << " at variable " << da.attribute("Name") << "!\n";
+			err_msg << "FATAL: VTK reader found array with unkown type " << tmp << " at variable " << da.attribute("Name").value() << "!\n";
 			throw runtime_error(err_msg.str());
 		}
 		if (tmp.find("32") != string::npos) {
@@ -365,127 +407,45 @@ void VTUReader::readData(	pugi::xml_node	da,
 		} else if (tmp.find("64") != string::npos) {
 			sizeofData = 8;
 		} else {
-			err_msg << "FATAL: VTK reader found array with unkown size " << tmp << " at variable " << da.attribute("Name") << "!\n";
+			err_msg << "FATAL: VTK reader found array with unkown size " << tmp << " at variable " << da.attribute("Name").value() << "!\n";
 			throw runtime_error(err_msg.str());
 		}
 	} else {
-		err_msg << "FATAL: VTK reader found array without type at variable " << da.attribute("Name") << "!\n";
+		err_msg << "FATAL: VTK reader found array without type at variable " << da.attribute("Name").value() << "!\n";
 		throw runtime_error(err_msg.str());
 	}
 
-	if (format == "ascii") {
-		if (type == "int")
-			readAsciiData<int>(	da,
-								data0,
-								data1,
-								data2,
-								numberOfComponents,
-								swapRequired,
-								sizeofHeader,
-								sizeofData);
+	if (type == "int") {
+		if (sizeofData == 4)
+			readAppendedData<int32_t, int>(da, data0, data1, data2, numberOfComponents, appended);
 		else
-			readAsciiData<double>(	da,
-									data0,
-									data1,
-									data2,
-									numberOfComponents,
-									swapRequired,
-									sizeofHeader,
-									sizeofData);
-
-	} else if (format == "binary") {
-		if (type == "int")
-			readBinaryData<int>(da,
-								data0,
-								data1,
-								data2,
-								numberOfComponents,
-								swapRequired,
-								sizeofHeader,
-								sizeofData);
+			readAppendedData<int64_t, int>(da, data0, data1, data2, numberOfComponents, appended);
+	} else {
+		if (sizeofData == 4)
+			readAppendedData<float, double>(da, data0, data1, data2, numberOfComponents, appended);
 		else
-			readBinaryData<double>(	da,
-									data0,
-									data1,
-									data2,
-									numberOfComponents,
-									swapRequired,
-									sizeofHeader,
-									sizeofData);
-
-	} else if (format == "appended") {
-		if (type == "int") {
-			if (sizeofData == 4)
-				readAppendedData<int32_t, int>(	da,
-												data0,
-												data1,
-												data2,
-												numberOfComponents,
-												swapRequired,
-												sizeofHeader,
-												binaryData,
-												vtkFile);
-			else
-				readAppendedData<int64_t, int>(	da,
-												data0,
-												data1,
-												data2,
-												numberOfComponents,
-												swapRequired,
-												sizeofHeader,
-												binaryData,
-												vtkFile);
-		} else {
-			if (sizeofData == 4)
-				readAppendedData<float, double>(da,
-												data0,
-												data1,
-												data2,
-												numberOfComponents,
-												swapRequired,
-												sizeofHeader,
-												binaryData,
-												vtkFile);
-			else
-				readAppendedData<double, double>(da,
-												data0,
-												data1,
-												data2,
-												numberOfComponents,
-												swapRequired,
-												sizeofHeader,
-												binaryData,
-												vtkFile);
-		}
+			readAppendedData<double, double>(da, data0, data1, data2, numberOfComponents, appended);
 	}
 }
 
-template<typename T>
-void
-VTUReader::readAsciiData(	pugi::xml_node	da,
-							void			*data0,
-							void			*data1,
-							void			*data2,
-							uint			numberOfComponents,
-							bool			swapRequired,
-							uint			sizeofHeader,
-							uint			sizeofData)
+// read an unsigned integer of the given size (4 or 8), swapping bytes if needed
+static uint64_t
+readHeaderInt(const BYTE *data, uint size, bool swapRequired)
 {
-	throw std::runtime_error("Inline ASCII data is not supported");
-}
-
-template<typename T>
-void
-VTUReader::readBinaryData(	pugi::xml_node	da,
-							void			*data0,
-							void			*data1,
-							void			*data2,
-							uint			numberOfComponents,
-							bool			swapRequired,
-							uint			sizeofHeader,
-							uint			sizeofData)
-{
-	throw std::runtime_error("Inline binary data is not supported");
+	BYTE tmp[8];
+	if (swapRequired) {
+		for (uint ii=0; ii<size; ii++) tmp[ii] = data[size-1-ii];
+	} else {
+		for (uint ii=0; ii<size; ii++) tmp[ii] = data[ii];
+	}
+	if (size == 8) {
+		uint64_t value;
+		memcpy(&value, tmp, sizeof(value));
+		return value;
+	}
+	uint32_t value;
+	memcpy(&value, tmp, sizeof(value));
+	return value;
 }
 
 template<typename IN, typename OUT>
@@ -495,121 +455,111 @@ VTUReader::readAppendedData(pugi::xml_node	da,
 							void			*data1,
 							void			*data2,
 							uint			numberOfComponents,
-							bool			swapRequired,
-							uint			sizeofHeader,
-							string			&binaryData,
-							pugi::xml_node	vtkFile)
+							AppendedData const& appended)
 {
-	uint offset = 0;
-	bool dataEncoded = true;
 	ostringstream err_msg;
 
-	pugi::xml_node appData = vtkFile.child("AppendedData");
-	if (!appData) {
-		err_msg << "Fatal: VTK reader cannot find a AppendedData child in the VTKFile node in file " << filename;
-	}
-
-	if (appData.attribute("encoding")) {
-		if (!strcmp(appData.attribute("encoding").value(), "raw")) dataEncoded = false;
-	}
-
-	if (da.attribute("offset")) {
-		offset = da.attribute("offset").as_int();
-	}
-
-	// this is the char array full of data starting with a header then a _ and then binary data possibly encoded in base64
-	string dataIncHead;
-	if (dataEncoded) dataIncHead = appData.text().get();
-	else dataIncHead = binaryData;
-	string::iterator dataIt = dataIncHead.begin();
-	// skip header
-	while ((*dataIt != '_') && dataIt < dataIncHead.end()) dataIt++;
-	// skip the _ as well
-	dataIt++;
-	// byte array that contains the decoded data
-	vector<BYTE> data;
-	// text data is base64 encoded
-	if (dataEncoded) {
-		// new data array without header
-		string encodedData = string(dataIt, dataIncHead.end());
-		// convert to byte array
-		data = base64_decode(encodedData);
-	// data not base64 encoded: can be read raw
-	} else {
-		// write string into data vector
-		while (dataIt < dataIncHead.end()) {
-			data.push_back((BYTE) *dataIt);
-			dataIt++;
+	const uint64_t offset = da.attribute("offset").as_ullong();
+	const uint sizeofHeader = appended.sizeofHeader;
+	const size_t maxValues = npart*numberOfComponents;
+
+	// check that the given range is within the appended data
+	auto check_range = [&](uint64_t start, uint64_t bytes) {
+		if (start > appended.size || bytes > appended.size - start) {
+			err_msg << "FATAL: VTK reader found truncated data at variable " << da.attribute("Name").value()
+				<< " in file " << filename << "!\n";
+			throw runtime_error(err_msg.str());
+		}
+	};
+	// check that the data fits in the read buffer
+	auto check_count = [&](uint64_t count) {
+		if (count > maxValues) {
+			err_msg << "FATAL: VTK reader found too many values at variable " << da.attribute("Name").value()
+				<< " in file " << filename << "!\n";
+			throw runtime_error(err_msg.str());
 		}
+	};
+
+	check_range(offset, sizeofHeader);
+
+	if (!appended.compressed) {
+		// the header holds the size of the data
+		const uint64_t dataSize = readHeaderInt(appended.data + offset, sizeofHeader, appended.swapRequired);
+		check_range(offset + sizeofHeader, dataSize);
+		check_count(dataSize/sizeof(IN));
+		readBinaryVtkData<IN, OUT>(appended.data + offset + sizeofHeader, dataSize/sizeof(IN), 0,
+			data0, data1, data2, numberOfComponents, appended.swapRequired);
+		return;
+	}
+
+#if USE_ZLIB
+	// the header holds the number of blocks, the (uncompressed) size of
+	// the blocks and of the last block, and the compressed size of each block
+	const BYTE *header = appended.data + offset;
+	const uint64_t numBlocks = readHeaderInt(header, sizeofHeader, appended.swapRequired);
+	check_range(offset, (3 + numBlocks)*sizeofHeader);
+	const uint64_t blockSize = readHeaderInt(header + sizeofHeader, sizeofHeader, appended.swapRequired);
+	const uint64_t lastBlockSize = readHeaderInt(header + 2*sizeofHeader, sizeofHeader, appended.swapRequired);
+	if (blockSize % sizeof(IN)) {
+		err_msg << "FATAL: VTK reader found compressed blocks of " << blockSize << " bytes at variable "
+			<< da.attribute("Name").value() << " in file " << filename << "!\n";
+		throw runtime_error(err_msg.str());
 	}
 
-	readBinaryVtkData<IN, OUT> (	data,
-									data0,
-									data1,
-									data2,
-									numberOfComponents,
-									sizeofHeader,
-									offset,
-									swapRequired);
+	// decompress one block at a time, and decode it straight into the read buffer
+	vector<BYTE> block(blockSize);
+	uint64_t compressedStart = offset + (3 + numBlocks)*sizeofHeader;
+	size_t valuesRead = 0;
+	for (uint64_t b = 0; b < numBlocks; ++b) {
+		const uint64_t compressedSize = readHeaderInt(header + (3 + b)*sizeofHeader, sizeofHeader, appended.swapRequired);
+		check_range(compressedStart, compressedSize);
+		const uint64_t rawSize = (b == numBlocks - 1 && lastBlockSize > 0) ? lastBlockSize : blockSize;
+		uLongf destLen = rawSize;
+		if (rawSize > blockSize ||
+			uncompress(block.data(), &destLen, appended.data + compressedStart, compressedSize) != Z_OK ||
+			destLen != rawSize) {
+			err_msg << "FATAL: VTK reader failed to decompress data at variable " << da.attribute("Name").value()
+				<< " in file " << filename << "!\n";
+			throw runtime_error(err_msg.str());
+		}
+		const size_t count = rawSize/sizeof(IN);
+		check_count(valuesRead + count);
+		readBinaryVtkData<IN, OUT>(block.data(), count, valuesRead,
+			data0, data1, data2, numberOfComponents, appended.swapRequired);
+		valuesRead += count;
+		compressedStart += compressedSize;
+	}
+#else
+	err_msg << "FATAL: " << filename << " is compressed, but GPUSPH was built without zlib support!\n";
+	throw runtime_error(err_msg.str());
+#endif
 }
 
 template<typename IN, typename OUT>
-void VTUReader::readBinaryVtkData (	vector<BYTE>	&data,
+void VTUReader::readBinaryVtkData (	const BYTE		*data,
+									size_t			count,
+									size_t			first,
 									void			*data0,
 									void			*data1,
 									void			*data2,
 									uint			numberOfComponents,
-									uint			sizeofHeader,
-									uint			offset,
 									bool			swapRequired)
 {
-	// dataI is the iterator that tells us where in the data we are
-	uint dataI = offset;
-	// dataSize is the size of the entry that we are going to read, it is determined in the first sizeofHeader bytes
-	int64_t dataSize = 0;
-	// read header for 64 bit integer
-	if (sizeofHeader == 8) {
-		BYTE *iC = (BYTE*) &dataSize;
-		if (swapRequired) {
-			for (uint ii=0; ii<sizeofHeader; ii++) iC[ii] = data[dataI+sizeofHeader-1-ii];
-		} else {
-			for (uint ii=0; ii<sizeofHeader; ii++) iC[ii] = data[dataI+ii];
-		}
-	// read header for 32 bit integer
-	} else {
-		int32_t tmp;
-		BYTE *iC = (BYTE*) &tmp;
-		if (swapRequired) {
-			for (uint ii=0; ii<sizeofHeader; ii++) iC[ii] = data[dataI+sizeofHeader-1-ii];
-		} else {
-			for (uint ii=0; ii<sizeofHeader; ii++) iC[ii] = data[dataI+ii];
-		}
-		dataSize = (int64_t) tmp;
-	}
-	dataI += sizeofHeader;
-	dataSize /= sizeof(IN);
-	uint pointsRead = 0;
-	while (pointsRead < dataSize) {
-		OUT dvalue;
+	void *component[3] = { data0, data1, data2 };
+	for (size_t i = 0; i < count; ++i) {
 		IN tmp;
 		BYTE *dvalueC = (BYTE*) &tmp;
+		const BYTE *src = data + i*sizeof(IN);
 		if (swapRequired) {
-			for (uint ii=0; ii<sizeof(IN); ii++) dvalueC[ii] = data[dataI+sizeof(IN)-1-ii];
+			for (uint ii=0; ii<sizeof(IN); ii++) dvalueC[ii] = src[sizeof(IN)-1-ii];
 		} else {
-			for (uint ii=0; ii<sizeof(IN); ii++) dvalueC[ii] = data[dataI+ii];
+			memcpy(dvalueC, src, sizeof(IN));
 		}
-		dataI += sizeof(IN);
-		dvalue = (OUT) tmp;
-
-		if (numberOfComponents == 3) {
-			if (pointsRead%3 == 0)
-				*((OUT*)((char*)data0 + pointsRead/3*sizeof(ReadParticles))) = dvalue;
-			else if (pointsRead%3 == 1)
-				*((OUT*)((char*)data1 + pointsRead/3*sizeof(ReadParticles))) = dvalue;
-			else if (pointsRead%3 == 2)
-				*((OUT*)((char*)data2 + pointsRead/3*sizeof(ReadParticles))) = dvalue;
-		} else
-			*((OUT*)((char*)data0 + pointsRead*sizeof(ReadParticles))) = dvalue;
-		pointsRead++;
+		const OUT dvalue = (OUT) tmp;
+
+		const size_t pointsRead = first + i;
+		const size_t particle = pointsRead/numberOfComponents;
+		void *dst = component[pointsRead % numberOfComponents];
+		*((OUT*)((char*)dst + particle*sizeof(ReadParticles))) = dvalue;
 	}
 }
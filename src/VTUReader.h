@@ -29,52 +29,43 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
 #include "Reader.h"
 #include "pugixml.h"
 #include "base64.h"
 #include "common_types.h"
 
+/*! Reader for VTK UnstructuredGrid (.vtu) files with appended data
+ *
+ * Only the XML header of the file (everything before the AppendedData)
+ * is parsed; the file is then memory-mapped, and each data array is decoded
+ * straight from the mapping into the read buffer, so that the memory
+ * needed is essentially the read buffer itself. Raw and base64-encoded
+ * appended data is supported, optionally compressed with zlib
+ * (vtkZLibDataCompressor) if GPUSPH was built with zlib support.
+ */
 class VTUReader : public Reader
 {
-public:
-	// returns the number of particles in the vtu file
-	size_t getNParts(void) override;
-
-	// allocates the buffer and reads the data from the vtu file
-	void read(void) override;
-
-	// read Data array from a node in a vtk file
+	//! The appended data section, and how to decode it
+	struct AppendedData {
+		const BYTE	*data; ///< start of the data (after the leading _)
+		size_t		size; ///< size of the data
+		bool		swapRequired; ///< the file endianness differs from ours
+		uint		sizeofHeader; ///< size of the array headers (4 or 8)
+		bool		compressed; ///< the arrays are zlib-compressed
+	};
+
+	// parse the XML header of the file, returning the offset of the
+	// appended data in the file (0 if there is none)
+	size_t parseHeader(pugi::xml_document &header);
+
+	// read a data array into the read buffer
 	void readData(	pugi::xml_node	da,
 					void*			data0,
 					void*			data1,
 					void*			data2,
-					bool			swapRequired,
-					uint			sizeofHeader,
-					std::string		&binaryData,
-					pugi::xml_node	vtkFile);
-
-	// read ascii data from a node in a vtk file
-	template<typename T>
-	void readAsciiData(	pugi::xml_node	da,
-						void			*data0,
-						void			*data1,
-						void			*data2,
-						uint			numberOfComponents,
-						bool			swapRequired,
-						uint			sizeofHeader,
-						uint			sizeofData);
-
-	// read binary data from a node in a vtk file
-	template<typename T>
-	void readBinaryData(pugi::xml_node	da,
-						void			*data0,
-						void			*data1,
-						void			*data2,
-						uint			numberOfComponents,
-						bool			swapRequired,
-						uint			sizeofHeader,
-						uint			sizeofData);
+					AppendedData const& appended);
 
 	// read appended data from a node in a vtk file
 	template<typename IN, typename OUT>
@@ -83,21 +74,25 @@ public:
 							void			*data1,
 							void			*data2,
 							uint			numberOfComponents,
-							bool			swapRequired,
-							uint			sizeofHeader,
-							std::string		&binaryData,
-							pugi::xml_node	vtkFile);
+							AppendedData const& appended);
 
-template<typename IN, typename OUT>
-void readBinaryVtkData (std::vector<BYTE>	&data,
-						void			*data0,
-						void			*data1,
-						void			*data2,
-						uint			numberOfComponents,
-						uint			sizeofHeader,
-						uint			offset,
-						bool			swapRequired);
+	// decode count values, starting from the first-th one, into the read buffer
+	template<typename IN, typename OUT>
+	void readBinaryVtkData(	const BYTE		*data,
+							size_t			count,
+							size_t			first,
+							void			*data0,
+							void			*data1,
+							void			*data2,
+							uint			numberOfComponents,
+							bool			swapRequired);
+
+public:
+	// returns the number of particles in the vtu file
+	size_t getNParts(void) override;
 
+	// allocates the buffer and reads the data from the vtu file
+	void read(void) override;
 };
 
 #endif
@@ -45,6 +45,9 @@
 #include "Writer.h"
 #include "HotWriter.h"
 
+// PerfRegion
+#include "perf_counters.h"
+
 #include "catalyst_select.opt"
 #if USE_CATALYST == 1
 #include "DisplayWriter.h"
@@ -55,6 +58,9 @@ using namespace std;
 WriterMap Writer::m_writers = WriterMap();
 WriteFlags Writer::m_write_flags = WriteFlags();
 bool Writer::m_pending_hotwriter = false;
+FieldFreqList Writer::m_field_freqs = FieldFreqList();
+vector<double> Writer::m_field_last_write = vector<double>();
+flag_t Writer::m_skipped_fields = 0;
 
 static const char* WriterName[] = {
 	"CommonWriter",
@@ -164,6 +170,29 @@ Writer::Create(GlobalData *_gdata)
 
 	avg_freq /= avg_count;
 
+	/* Fields with their own write frequency */
+	m_field_freqs = problem->get_field_write_freqs();
+	m_field_last_write.assign(m_field_freqs.size(), -1);
+	for (auto const& ff : m_field_freqs)
+		cout << "Buffers 0x" << hex << ff.first << dec << " will be written every "
+			<< ff.second << " (simulated) seconds" << endl;
+
+	/* Output filters */
+	OutputFilterMap const& filters = problem->get_output_filters();
+	for (OutputFilterMap::const_iterator flt = filters.begin(); flt != filters.end(); ++flt) {
+		if (!flt->second.active())
+			continue;
+		WriterMap::iterator wm = m_writers.find(flt->first);
+		if (wm == m_writers.end()) {
+			cerr << "Output filter for " << WriterName[flt->first] << " ignored, writer not enabled" << endl;
+		} else if (flt->first == HOTWRITER) {
+			cerr << "Output filter for " << WriterName[flt->first] << " ignored, checkpoints need all particles" << endl;
+		} else {
+			wm->second->set_output_filter(flt->second);
+			cout << WriterName[flt->first] << " will only write the filtered particles" << endl;
+		}
+	}
+
 	/* Checkpoint setup: we setup a HOTWRITER if it's missing,
 	 * change its frequency if present, and set the number of checkpoints
 	 * as appropriate
@@ -202,6 +231,10 @@ Writer::Create(GlobalData *_gdata)
 			htwr->set_write_freq(freq);
 		if (chkpts >= 0)
 			htwr->set_num_files_to_save(chkpts);
+		if (options->checkpoint_full_every >= 0)
+			htwr->set_full_checkpoint_every(options->checkpoint_full_every);
+		if (options->checkpoint_compress)
+			htwr->set_codec(HOTFILE_XOR_SHUFFLE);
 
 		/* retrieve the actual values used, to select message */
 		freq  = htwr->get_write_freq();
@@ -212,6 +245,11 @@ Writer::Create(GlobalData *_gdata)
 				cout << "\twill keep the last " << chkpts << " checkpoints" << endl;
 			else
 				cout << "\twill keep ALL checkpoints" << endl;
+			if (htwr->get_full_checkpoint_every() > 1)
+				cout << "\tfull checkpoint every " << htwr->get_full_checkpoint_every()
+					<< " checkpoints, deltas in between" << endl;
+			if (htwr->get_codec() != HOTFILE_RAW)
+				cout << "\twill compress checkpoints" << endl;
 		} else {
 			cout << "HotStart checkpoints DISABLED" << endl;
 		}
@@ -223,6 +261,27 @@ Writer::Create(GlobalData *_gdata)
 		m_writers[COMMONWRITER] = new CommonWriter(_gdata);
 }
 
+flag_t
+Writer::SkippedFields(double t, WriteFlags const& write_flags)
+{
+	// everything is written on forced writes, and everything is
+	// needed by the HotWriter
+	if (write_flags.forced_write || write_flags.hot_write)
+		return 0;
+
+	// fields listed under multiple frequencies are written when any of them is due
+	flag_t listed = 0, due = 0;
+	for (size_t f = 0; f < m_field_freqs.size(); ++f) {
+		const double freq = m_field_freqs[f].second;
+		const double last = m_field_last_write[f];
+		listed |= m_field_freqs[f].first;
+		if (freq == 0 || (freq > 0 && floor(t/freq) > floor(last/freq)))
+			due |= m_field_freqs[f].first;
+	}
+	const flag_t skipped = listed & ~due;
+	return skipped;
+}
+
 ConstWriterMap
 Writer::NeedWrite(double t)
 {
@@ -247,6 +306,7 @@ Writer::StartWriting(double t, WriteFlags const& write_flags)
 	WriterMap started;
 
 	m_write_flags = write_flags;
+	m_skipped_fields = SkippedFields(t, write_flags);
 
 	// is this a forced write?
 	const bool forced = write_flags.forced_write;
@@ -310,6 +370,14 @@ Writer::MarkWritten(WriterMap writers, double t)
 	if (common_special && !writers.empty())
 		m_writers[COMMONWRITER]->mark_written(t);
 
+	// the fields that were due have been written
+	if (!hot && !writers.empty()) {
+		for (size_t f = 0; f < m_field_freqs.size(); ++f)
+			if (!(m_field_freqs[f].first & m_skipped_fields))
+				m_field_last_write[f] = t;
+	}
+	m_skipped_fields = 0;
+
 	// clear the write flags
 	m_write_flags.clear();
 	if (hot)
@@ -369,6 +437,15 @@ Writer::Write(WriterMap writers, uint numParts, BufferList const& buffers,
 	// save it because it writes last
 	CallbackWriter *cbwriter = NULL;
 
+	// hide the fields that are not due: their host copy is stale
+	FilteredBufferList due_buffers;
+	if (m_skipped_fields) {
+		for (auto const& kb : buffers)
+			if (!(kb.first & m_skipped_fields))
+				due_buffers.add(kb.first, kb.second);
+	}
+	BufferList const& write_buffers = m_skipped_fields ? due_buffers : buffers;
+
 	ConstWriterMap have_written;
 
 	WriterMap::iterator it(writers.begin());
@@ -384,17 +461,20 @@ Writer::Write(WriterMap writers, uint numParts, BufferList const& buffers,
 			continue;
 		}
 
-		it->second->write(numParts, buffers, node_offset, t, testpoints);
+		{
+			PerfRegion region(WriterName[it->first]);
+			it->second->filtered_write(numParts, write_buffers, node_offset, t, testpoints);
+		}
 
 		have_written[it->first] = it->second;
 	}
 
 	if (common_special && !writers.empty())
-		m_writers[COMMONWRITER]->write(numParts, buffers, node_offset, t, testpoints);
+		m_writers[COMMONWRITER]->filtered_write(numParts, write_buffers, node_offset, t, testpoints);
 
 	if (cbwriter) {
 		cbwriter->set_writers_list(have_written);
-		cbwriter->write(numParts, buffers, node_offset, t, testpoints);
+		cbwriter->filtered_write(numParts, write_buffers, node_offset, t, testpoints);
 	}
 }
 
@@ -562,6 +642,23 @@ Writer::~Writer()
 	// hi
 }
 
+void
+Writer::filtered_write(uint numParts, BufferList const& buffers, uint node_offset, double t, const bool testpoints)
+{
+	if (!m_filter.active()) {
+		write(numParts, buffers, node_offset, t, testpoints);
+		return;
+	}
+
+	FilteredBufferList filtered;
+	uint selected = 0;
+	{
+		PerfRegion region("OutputFilter::apply");
+		selected = m_filter.apply(numParts, buffers, node_offset, filtered);
+	}
+	write(selected, filtered, 0, t, testpoints);
+}
+
 void
 Writer::set_write_freq(double f)
 {
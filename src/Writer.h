@@ -55,6 +55,9 @@
 // StepInfo
 #include "command_type.h"
 
+// OutputFilter
+#include "OutputFilter.h"
+
 // deprecation macros
 // #include "deprecation.h"
 
@@ -83,6 +86,10 @@ enum WriterType
 // list of writer type, write freq pairs
 typedef std::vector<std::pair<WriterType, double> > WriterList;
 
+// list of (particle) buffers, write freq pairs, for fields that are written
+// less frequently than the particles they belong to
+typedef std::vector<std::pair<flag_t, double> > FieldFreqList;
+
 class Writer;
 
 // hash of WriterType, pointer to actual writer
@@ -91,6 +98,9 @@ typedef std::map<WriterType, Writer*> WriterMap;
 // ditto, const
 typedef std::map<WriterType, const Writer*> ConstWriterMap;
 
+// hash of WriterType, particle output filter for the writer
+typedef std::map<WriterType, OutputFilter> OutputFilterMap;
+
 ///! Flags to communicate special needs to the writer
 struct WriteFlags
 {
@@ -157,6 +167,13 @@ class Writer
 	 */
 	static bool m_pending_hotwriter;
 
+	//! Fields with their own write frequency
+	static FieldFreqList m_field_freqs;
+	//! Last write time of each of the m_field_freqs fields
+	static std::vector<double> m_field_last_write;
+	//! Fields that are not being written in the current writing session
+	static flag_t m_skipped_fields;
+
 public:
 	// maximum number of files
 	static const uint MAX_FILES = 99999;
@@ -175,6 +192,16 @@ public:
 	static bool HotWriterPending()
 	{ return m_pending_hotwriter; }
 
+	// return the fields with their own write frequency that would not be due
+	// in a writing session at time t with the given flags; these need not
+	// be downloaded from the devices
+	static flag_t
+	SkippedFields(double t, WriteFlags const& write_flags);
+
+	// fields that are not being written in the current writing session
+	static flag_t CurrentSkippedFields()
+	{ return m_skipped_fields; }
+
 	static const char* Name(WriterType key);
 
 	// tell writers that we're starting to send write requests
@@ -223,6 +250,10 @@ public:
 	double get_write_freq() const
 	{ return m_writefreq; }
 
+	// set the filter selecting the particles passed to this writer
+	void set_output_filter(OutputFilter const& filter)
+	{ m_filter = filter; }
+
 	/* return the last file number as string */
 	std::string last_filenum() const;
 
@@ -259,6 +290,10 @@ protected:
 	virtual void
 	write(uint numParts, BufferList const& buffers, uint node_offset, double t, const bool testpoints) = 0;
 
+	// call write() with the particles selected by the output filter
+	void
+	filtered_write(uint numParts, BufferList const& buffers, uint node_offset, double t, const bool testpoints);
+
 	virtual void
 	write_energy(double t, double4 *energy) {}
 
@@ -301,6 +336,9 @@ protected:
 	{ return open_data_file(out, base, std::string(), m_fname_sfx); }
 
 
+	// particles to be written
+	OutputFilter	m_filter;
+
 	// time of last write
 	double			m_last_write_time;
 	// time between writes. Special values:
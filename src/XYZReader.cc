@@ -29,34 +29,139 @@
 #include <fstream> // ifstream
 #include <sstream> // stringstream
 #include <limits> // UINT_MAX, numeric_limits
+#include <cstdlib> // strtod
+#include <cstring> // memchr
+#include <vector>
 
 #include <stdexcept>
 
+#include "mapped_file.h"
+#include "parallel_jobs.h"
+
 using namespace std;
 
+// size of the chunks the file is split into for parallel parsing
+#define XYZ_CHUNK_SIZE (16*1024*1024)
+
+// is c a field separator?
+static inline bool
+is_separator(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == ',';
+}
+
+// does the line [p, eol) hold no data?
+static bool
+is_blank(const char *p, const char *eol)
+{
+	while (p < eol && is_separator(*p))
+		++p;
+	return p == eol;
+}
+
+// parse up to maxv numbers from the line [p, eol), that must be followed
+// by a non-numeric character (newline or NUL); returns the number of values parsed
+static int
+parse_line(const char *p, const char *eol, double *v, int maxv)
+{
+	int n = 0;
+	while (n < maxv) {
+		while (p < eol && is_separator(*p))
+			++p;
+		if (p == eol)
+			break;
+		char *next;
+		v[n] = strtod(p, &next);
+		if (next == p)
+			break;
+		p = next;
+		++n;
+	}
+	return n;
+}
+
+// the file is split into chunks that start right after a newline
+struct XYZChunk {
+	const char *begin;
+	const char *end;
+	size_t numParts; // non-blank lines in the chunk
+	size_t firstPart; // index of the first particle of the chunk
+	Point bbox_min;
+	Point bbox_max;
+};
+
+static vector<XYZChunk>
+split_chunks(MappedFile const& mapped)
+{
+	const char *data = mapped.data();
+	const size_t size = mapped.size();
+	const size_t num_chunks = (size + XYZ_CHUNK_SIZE - 1)/XYZ_CHUNK_SIZE;
+
+	vector<XYZChunk> chunks(num_chunks);
+	const char *begin = data;
+	for (size_t c = 0; c < num_chunks; ++c) {
+		const char *end = data + min(size, (c + 1)*XYZ_CHUNK_SIZE);
+		if (end < data + size) {
+			const char *nl = (const char*)memchr(end, '\n', data + size - end);
+			end = nl ? nl + 1 : data + size;
+		}
+		if (begin > end)
+			begin = end;
+		chunks[c].begin = begin;
+		chunks[c].end = end;
+		chunks[c].numParts = 0;
+		chunks[c].firstPart = 0;
+		begin = end;
+	}
+
+	// count the particles in each chunk
+	parallel_jobs(num_chunks, [&](size_t c) {
+		const char *p = chunks[c].begin;
+		const char *end = chunks[c].end;
+		while (p < end) {
+			const char *eol = (const char*)memchr(p, '\n', end - p);
+			if (!eol) eol = end;
+			if (!is_blank(p, eol))
+				++chunks[c].numParts;
+			p = eol + 1;
+		}
+	});
+
+	size_t first = 0;
+	for (auto& chunk : chunks) {
+		chunk.firstPart = first;
+		first += chunk.numParts;
+	}
+
+	return chunks;
+}
+
 size_t XYZReader::getNParts()
 {
 	// if npart != UINT_MAX, file was already opened (for loading or counting only)
 	if (npart != UINT_MAX)
 		return npart;
 
-	// otherwise, we just count the lines
+	// the mapping fails on empty files
 	ifstream xyzFile(filename.c_str());
-
 	// basic I/O check
 	if (!xyzFile.good()) {
 		stringstream err_msg;
 		err_msg	<< "failed to open XYZ file " << filename;
 		throw runtime_error(err_msg.str());
 	}
+	if (xyzFile.peek() == EOF) {
+		npart = 0;
+		return npart;
+	}
+	xyzFile.close();
 
-	unsigned int numLines = 0;
-
-	string unused;
-	while ( getline(xyzFile, unused) )
-		++numLines;
+	// otherwise, we count the non-blank lines
+	MappedFile mapped(filename);
+	const vector<XYZChunk> chunks = split_chunks(mapped);
 
-	return numLines;
+	npart = chunks.empty() ? 0 : chunks.back().firstPart + chunks.back().numParts;
+	return npart;
 }
 
 void XYZReader::read()
@@ -73,21 +178,7 @@ void XYZReader::read(Point *bbox_min, Point *bbox_max)
 	cout << "Reading particle data from the input: " << filename << endl;
 
 	// allocating read buffer
-	if(buf == NULL)
-		buf = new ReadParticles[npart];
-	else{
-		delete [] buf;
-		buf = new ReadParticles[npart];
-	}
-
-	ifstream xyzFile(filename.c_str());
-
-	// basic I/O check
-	if (!xyzFile.good()) {
-		stringstream err_msg;
-		err_msg	<< "failed to open XYZ " << filename;
-		throw runtime_error(err_msg.str());
-	}
+	allocBuffer();
 
 	// reset the bounding box
 	// NOTE: using NAN instead of DBL_MAX/-DBL_MAX to leave a "correct"
@@ -95,28 +186,82 @@ void XYZReader::read(Point *bbox_min, Point *bbox_max)
 	if (bbox_min) *bbox_min = Point(NAN, NAN, NAN);
 	if (bbox_max) *bbox_max = Point(NAN, NAN, NAN);
 
-	double x, y, z;
-	ReadParticles *part = buf;
-	while( !xyzFile.eof() ) {
-		// read point coordinates
-		xyzFile >> x >> y >> z;
+	if (npart == 0)
+		return;
 
-		part->Coords_0 = x;
-		part->Coords_1 = y;
-		part->Coords_2 = z;
+	MappedFile mapped(filename);
+	vector<XYZChunk> chunks = split_chunks(mapped);
 
-		// ignore the rest of the line (e.g. vertex normals might be given)
-		// TODO read normals if present
-		xyzFile.ignore ( numeric_limits<streamsize>::max(), '\n' );
+	const size_t numParts = chunks.back().firstPart + chunks.back().numParts;
+	if (numParts != npart) {
+		stringstream err_msg;
+		err_msg	<< "XYZ file " << filename << " changed while reading: "
+			<< numParts << " points, " << npart << " expected";
+		throw runtime_error(err_msg.str());
+	}
 
-		// update the bounding box ends, if given
-		Point p(x, y, z);
-		if (bbox_min) setMinPerElement(*bbox_min, p);
-		if (bbox_max) setMaxPerElement(*bbox_max, p);
+	const char *data = mapped.data();
+	parallel_jobs(chunks.size(), [&](size_t c) {
+		XYZChunk& chunk = chunks[c];
+		chunk.bbox_min = Point(NAN, NAN, NAN);
+		chunk.bbox_max = Point(NAN, NAN, NAN);
 
-		++part;
+		ReadParticles *part = buf + chunk.firstPart;
+		const char *p = chunk.begin;
+		const char *end = chunk.end;
+		string last_line;
+		while (p < end) {
+			const char *eol = (const char*)memchr(p, '\n', end - p);
+			const char *line = p;
+			const size_t line_offset = p - data;
+			if (!eol) {
+				// the last line of the file has no newline: copy it,
+				// so that it is terminated
+				last_line.assign(p, end);
+				line = last_line.c_str();
+				eol = line + last_line.size();
+				p = end;
+			} else {
+				p = eol + 1;
+			}
+			if (is_blank(line, eol))
+				continue;
 
-    }
+			// point coordinates, optionally followed by the vertex normal
+			double v[6];
+			const int n = parse_line(line, eol, v, 6);
+			if (n < 3) {
+				stringstream err_msg;
+				err_msg	<< "malformed line at byte " << line_offset
+					<< " of XYZ file " << filename;
+				throw runtime_error(err_msg.str());
+			}
 
-	xyzFile.close();
+			part->Coords_0 = v[0];
+			part->Coords_1 = v[1];
+			part->Coords_2 = v[2];
+			if (n >= 6) {
+				part->Normal_0 = v[3];
+				part->Normal_1 = v[4];
+				part->Normal_2 = v[5];
+			} else {
+				part->Normal_0 = part->Normal_1 = part->Normal_2 = 0;
+			}
+
+			// update the bounding box ends of the chunk
+			Point pt(v[0], v[1], v[2]);
+			setMinPerElement(chunk.bbox_min, pt);
+			setMaxPerElement(chunk.bbox_max, pt);
+
+			++part;
+		}
+	});
+
+	// reduce the bounding boxes of the chunks
+	for (auto const& chunk : chunks) {
+		if (chunk.numParts == 0)
+			continue;
+		if (bbox_min) setMinPerElement(*bbox_min, chunk.bbox_min);
+		if (bbox_max) setMaxPerElement(*bbox_max, chunk.bbox_max);
+	}
 }
@@ -29,6 +29,13 @@
 #include "Point.h"
 #include "Reader.h"
 
+/*! Reader for XYZ point clouds
+ *
+ * Each non-blank line holds the coordinates of a point, optionally
+ * followed by the vertex normal, separated by whitespace or commas.
+ * The file is memory-mapped and parsed in parallel, in newline-aligned
+ * chunks.
+ */
 class XYZReader : public Reader
 {
 public:
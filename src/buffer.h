@@ -41,6 +41,8 @@
 
 #include "common_types.h"
 #include "buffer_traits.h"
+#include "memory_accounting.h"
+#include "buffer_arena.h"
 
 #define DEBUG_BUFFER_ACCESS 1
 
@@ -90,6 +92,16 @@ class AbstractBuffer
 	// a unique ID on initialization in such a way that it only depends on initialization order
 	std::string m_uid;
 
+	// tag under which allocations are recorded for memory accounting, and
+	// the tag and amount of memory actually recorded by the last allocation
+	std::string m_memory_tag;
+	std::string m_accounted_tag;
+	size_t m_accounted_bytes;
+
+	// arena the arrays are taken from, if any; the buffer keeps it alive,
+	// and doesn't free the arrays by itself
+	std::shared_ptr<BufferArena> m_arena;
+
 protected:
 	// constructor that aliases m_ptr to some array of pointers
 	AbstractBuffer(void *bufs[]) :
@@ -97,7 +109,11 @@ protected:
 		m_allocated_elements(0),
 		m_validity(BUFFER_INVALID),
 		m_state(),
-		m_uid("<unset>")
+		m_uid("<unset>"),
+		m_memory_tag(),
+		m_accounted_tag(),
+		m_accounted_bytes(0),
+		m_arena()
 	{}
 
 	void set_uid(std::string const& uid)
@@ -111,6 +127,31 @@ protected:
 		return allocs;
 	}
 
+	// record the allocation of the given amount of memory under the memory tag;
+	// to be called by the alloc() method of the subclasses
+	void account_alloc(size_t bytes)
+	{
+		account_free();
+		m_accounted_tag = memory_tag();
+		m_accounted_bytes = bytes;
+		memory_account_alloc(m_accounted_tag, bytes);
+	}
+
+	// record the release of the memory previously allocated;
+	// to be called by the destructor of the subclasses
+	void account_free()
+	{
+		if (!m_accounted_bytes)
+			return;
+		memory_account_free(m_accounted_tag, m_accounted_bytes);
+		m_accounted_bytes = 0;
+	}
+
+	// the arena to take the arrays from, or NULL if they should be
+	// allocated individually; to be used by the alloc() method of the subclasses
+	BufferArena *arena() const
+	{ return m_arena.get(); }
+
 	friend class ParticleSystem; // needs to be able to access set_uid
 
 public:
@@ -118,12 +159,39 @@ public:
 	AbstractBuffer() :
 		m_ptr(NULL),
 		m_validity(BUFFER_VALID),
-		m_state()
+		m_state(),
+		m_memory_tag(),
+		m_accounted_tag(),
+		m_accounted_bytes(0),
+		m_arena()
 	{}
 
 	// destructor must be virtual
 	virtual ~AbstractBuffer() {}
 
+	// set the tag under which the allocations of this buffer are accounted for
+	// (see memory_accounting.h); must be set before alloc() to have effect
+	void set_memory_tag(std::string const& tag)
+	{ m_memory_tag = tag; }
+
+	// the tag under which the allocations of this buffer are accounted for;
+	// defaults to the buffer class and name
+	std::string memory_tag() const
+	{
+		return m_memory_tag.empty() ?
+			std::string(get_buffer_class()) + "/" + get_buffer_name() :
+			m_memory_tag;
+	}
+
+	// set the arena to take the arrays from on alloc();
+	// must be set before alloc() to have effect
+	void set_arena(std::shared_ptr<BufferArena> arena)
+	{ m_arena = arena; }
+
+	// amount of memory currently accounted for this buffer
+	size_t get_accounted_memory() const
+	{ return m_accounted_bytes; }
+
 	// reset the buffer content to its initial value
 	virtual void clobber() = 0;
 
@@ -517,6 +585,13 @@ public:
 		m_keys = 0;
 	}
 
+	// account the allocations of all buffers currently in the list
+	// under prefix/<buffer name> (see memory_accounting.h)
+	void set_memory_tag_prefix(std::string const& prefix) {
+		for (auto& kb : m_map)
+			kb.second->set_memory_tag(prefix + "/" + kb.second->get_buffer_name());
+	}
+
 	void clear_pending_state() {
 		m_has_pending_state = NOT_PENDING;
 		m_pending_state.clear();
@@ -0,0 +1,109 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the BufferArena
+ */
+
+#include <stdexcept>
+
+#include "buffer_arena.h"
+
+using namespace std;
+
+const size_t BufferArena::block_alignment;
+const size_t BufferArena::slice_alignment;
+
+BufferArena::Block& BufferArena::add_block(size_t bytes)
+{
+	Block block;
+	block.size = (bytes + block_alignment - 1)/block_alignment*block_alignment;
+	block.used = 0;
+	block.base = static_cast<char*>(allocate_block(block.size));
+	if (!block.base)
+		throw runtime_error("failed to allocate buffer arena block of " +
+			to_string(block.size) + " bytes");
+	m_blocks.push_back(block);
+	return m_blocks.back();
+}
+
+void BufferArena::reserve(size_t bytes)
+{
+	for (auto const& block : m_blocks)
+		if (block.size - block.used >= bytes)
+			return;
+	add_block(bytes);
+}
+
+void *BufferArena::take(size_t bytes)
+{
+	const size_t size = slice_size(bytes);
+
+	// first fit: the arena only grows, and blocks are few,
+	// so there's no point in anything smarter
+	for (auto& block : m_blocks) {
+		if (block.size - block.used >= size) {
+			void *ptr = block.base + block.used;
+			block.used += size;
+			return ptr;
+		}
+	}
+
+	Block& block = add_block(size);
+	block.used = size;
+	return block.base;
+}
+
+void BufferArena::rewind()
+{
+	for (auto& block : m_blocks)
+		block.used = 0;
+}
+
+void BufferArena::release()
+{
+	for (auto const& block : m_blocks)
+		free_block(block.base, block.size);
+	m_blocks.clear();
+}
+
+size_t BufferArena::capacity() const
+{
+	size_t total = 0;
+	for (auto const& block : m_blocks)
+		total += block.size;
+	return total;
+}
+
+size_t BufferArena::used() const
+{
+	size_t total = 0;
+	for (auto const& block : m_blocks)
+		total += block.used;
+	return total;
+}
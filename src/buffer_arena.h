@@ -0,0 +1,133 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Arena allocator for particle system buffers
+ *
+ * Instead of allocating each array of each buffer separately, the buffers
+ * of a ParticleSystem (or of any other set of buffers) can be carved out
+ * of a few large blocks, aligned to 2MB so that they can be backed by huge pages.
+ * Memory is only returned to the system when the arena itself is released,
+ * so that buffers moving between states never hit the system allocator.
+ *
+ * The actual allocation of the blocks is delegated to the subclasses
+ * (see HostBufferArena in hostbuffer.h and CUDABufferArena in cuda/cudabuffer.h).
+ */
+
+#ifndef _BUFFER_ARENA_H
+#define _BUFFER_ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+class BufferArena
+{
+	struct Block {
+		char *base;
+		size_t size;
+		size_t used;
+	};
+
+	std::vector<Block> m_blocks;
+
+	BufferArena(BufferArena const&); // NOT implemented
+	void operator=(BufferArena const&); // NOT implemented
+
+	//! Add a new block of at least the given size
+	Block& add_block(size_t bytes);
+
+protected:
+	//! Allocate a block of the given size, aligned to block_alignment
+	virtual void *allocate_block(size_t bytes) = 0;
+	//! Release a block obtained from allocate_block
+	virtual void free_block(void *ptr, size_t bytes) = 0;
+
+public:
+	//! Set the given memory from the arena to value (as memset)
+	/*! This is where the pages of a slice are first touched, so host arenas
+	 * can use it to control their placement
+	 */
+	virtual void fill(void *ptr, int value, size_t bytes) = 0;
+
+protected:
+
+	BufferArena() : m_blocks() {}
+
+public:
+	//! Alignment (and granularity) of the arena blocks: 2MB, the size of huge pages
+	static const size_t block_alignment = size_t(2) << 20;
+	//! Alignment of each slice handed out by the arena
+	/*! This matches the alignment guaranteed by cudaMalloc, and is a multiple
+	 * of the cache line size on all supported hosts
+	 */
+	static const size_t slice_alignment = 256;
+
+	//! Size actually taken from the arena by a slice of the given size
+	static size_t slice_size(size_t bytes)
+	{ return (bytes + slice_alignment - 1)/slice_alignment*slice_alignment; }
+
+	//! The destructor of the subclasses must call release()
+	virtual ~BufferArena() {}
+
+	//! Make sure a contiguous free region of the given size is available
+	/*! This should be used before a sequence of take() calls, so that
+	 * all of them are satisfied by a single block
+	 */
+	void reserve(size_t bytes);
+
+	//! Take a slice of the given size from the arena
+	/*! A new block is added if none of the existing ones has enough
+	 * free space left. The returned memory is not initialized.
+	 */
+	void *take(size_t bytes);
+
+	//! Make all the memory of the arena available again
+	/*! The blocks are kept, so that the following take() calls do not
+	 * allocate, up to the current capacity.
+	 * \note as release(), this invalidates all the memory handed out by the arena
+	 */
+	void rewind();
+
+	//! Return all the blocks to the system
+	/*! \note this invalidates all the memory handed out by the arena,
+	 * so it should only be called when none of it is in use anymore
+	 */
+	void release();
+
+	//! Total size of the blocks allocated so far
+	size_t capacity() const;
+
+	//! Total size of the slices handed out so far
+	size_t used() const;
+
+	//! Number of blocks allocated so far
+	size_t num_blocks() const
+	{ return m_blocks.size(); }
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Host access to buffers stored in reduced precision
+ */
+
+#ifndef _BUFFER_PRECISION_H
+#define _BUFFER_PRECISION_H
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "define_buffers.h"
+#include "parallel_jobs.h"
+
+//! Host view of a buffer in its compute type
+/*! Buffers stored in full precision are accessed directly, reduced-precision
+ * buffers are decoded (in parallel) into a temporary copy.
+ * A NULL data pointer gives a NULL view, so that this can be used
+ * directly on the result of BufferList::getData() for optional buffers.
+ */
+template<flag_t Key>
+class DecodedBuffer
+{
+public:
+	typedef typename BufferTraits<Key>::element_type element_type;
+	typedef typename BufferPrecision<Key>::compute_type compute_type;
+
+private:
+	std::vector<compute_type>	m_decoded;
+	const compute_type			*m_data;
+
+	//! Number of elements decoded by each parallel job
+	enum { chunk = 64*1024 };
+
+	void decode(const element_type *data, size_t /* count */, std::true_type)
+	{ m_data = data; }
+
+	void decode(const element_type *data, size_t count, std::false_type)
+	{
+		m_decoded.resize(count);
+		parallel_jobs((count + chunk - 1)/chunk, [&](size_t j) {
+			const size_t first = j*chunk;
+			const size_t last = std::min(first + chunk, count);
+			for (size_t i = first; i < last; ++i)
+				m_decoded[i] = load_element<Key>(data[i]);
+		});
+		m_data = m_decoded.data();
+	}
+
+public:
+	DecodedBuffer(const element_type *data, size_t count) :
+		m_decoded(), m_data(NULL)
+	{
+		if (data)
+			decode(data, count, std::is_same<element_type, compute_type>());
+	}
+
+	operator const compute_type*() const
+	{ return m_data; }
+};
+
+#endif
@@ -35,6 +35,10 @@
 
 #include "GlobalData.h"
 
+// the buffer precisions only need to be declared once
+#undef SET_BUFFER_PRECISION
+#define SET_BUFFER_PRECISION(code, _compute, _precision, _scale)
+
 // re-include define-buffers to set the printable name
 #undef DEFINED_BUFFERS
 #undef SET_BUFFER_TRAITS
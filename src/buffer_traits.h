@@ -34,6 +34,8 @@
 
 // flag_t
 #include "common_types.h"
+// StoragePrecision, precision_convert
+#include "reduced_precision.h"
 
 /*! BufferTraits: traits struct used to associate a buffer key
  * with the respective buffer type, number of arrays,
@@ -72,5 +74,54 @@ template<> struct BufferTraits<code> \
 	static const char name[]; \
 }
 
+/*! BufferPrecision: traits struct describing the storage precision
+ * of a buffer, and the type its elements are used as in computations.
+ * Buffers stored in reduced precision have an element_type that differs
+ * from their compute_type: use load_element and store_element
+ * to access them. See reduced_precision.h.
+ * By default, buffers are stored as they are computed.
+ */
+template<flag_t Key>
+struct BufferPrecision
+{
+	typedef typename BufferTraits<Key>::element_type compute_type;
+	static constexpr StoragePrecision precision = PRECISION_FP32;
+	static constexpr float scale = 1.0f;
+};
+
+/*! Macro to declare the storage precision of a buffer:
+ *  * compute type
+ *  * storage precision
+ *  * scale (only used by PRECISION_FIXED16)
+ */
+#define SET_BUFFER_PRECISION(code, _compute, _precision, _scale) \
+template<> struct BufferPrecision<code> \
+{ \
+	typedef _compute compute_type; \
+	static constexpr StoragePrecision precision = _precision; \
+	static constexpr float scale = _scale; \
+}
+
+//! Load an element of a buffer, converting it to its compute type
+template<flag_t Key>
+inline __host__ __device__ typename BufferPrecision<Key>::compute_type
+load_element(typename BufferTraits<Key>::element_type const& v)
+{
+	typedef BufferPrecision<Key> BP;
+	typename BP::compute_type ret;
+	precision_convert<BP::precision>::decode(ret, v, BP::scale);
+	return ret;
+}
+
+//! Store an element of a buffer, converting it from its compute type
+template<flag_t Key>
+inline __host__ __device__ void
+store_element(typename BufferTraits<Key>::element_type &dst,
+	typename BufferPrecision<Key>::compute_type const& v)
+{
+	typedef BufferPrecision<Key> BP;
+	precision_convert<BP::precision>::encode(dst, v, BP::scale);
+}
+
 #endif
 
@@ -0,0 +1,120 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the CRC32C checksum
+ */
+
+#include "crc32c.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_HAVE_SSE42_PATH 1
+#include <cstring>
+#include <nmmintrin.h>
+#endif
+
+// reversed Castagnoli polynomial
+#define CRC32C_POLY 0x82f63b78u
+
+namespace {
+
+//! Lookup tables for the slicing-by-8 software implementation
+struct crc32c_tables
+{
+	uint32_t t[8][256];
+
+	crc32c_tables()
+	{
+		for (uint32_t n = 0; n < 256; ++n) {
+			uint32_t crc = n;
+			for (int k = 0; k < 8; ++k)
+				crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+			t[0][n] = crc;
+		}
+		for (uint32_t n = 0; n < 256; ++n)
+			for (int s = 1; s < 8; ++s)
+				t[s][n] = (t[s-1][n] >> 8) ^ t[0][t[s-1][n] & 0xff];
+	}
+};
+
+uint32_t crc32c_sw(const unsigned char *p, size_t bytes, uint32_t crc)
+{
+	static const crc32c_tables tables;
+	const uint32_t (&t)[8][256] = tables.t;
+
+	// the 8-byte steps assume little-endian data, which is all we run on
+	while (bytes >= 8) {
+		const uint32_t lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24));
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+			t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+			t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+		p += 8;
+		bytes -= 8;
+	}
+	while (bytes--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+	return crc;
+}
+
+#ifdef CRC32C_HAVE_SSE42_PATH
+__attribute__((target("sse4.2")))
+uint32_t crc32c_hw(const unsigned char *p, size_t bytes, uint32_t crc)
+{
+	uint64_t crc64 = crc;
+	while (bytes >= 8) {
+		uint64_t word;
+		memcpy(&word, p, 8);
+		crc64 = _mm_crc32_u64(crc64, word);
+		p += 8;
+		bytes -= 8;
+	}
+	crc = uint32_t(crc64);
+	while (bytes--)
+		crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+
+bool have_sse42()
+{
+	static const bool supported = __builtin_cpu_supports("sse4.2");
+	return supported;
+}
+#endif
+
+}
+
+uint32_t crc32c(const void *data, size_t bytes, uint32_t crc)
+{
+	const unsigned char *p = static_cast<const unsigned char*>(data);
+	crc = ~crc;
+#ifdef CRC32C_HAVE_SSE42_PATH
+	if (have_sse42())
+		return ~crc32c_hw(p, bytes, crc);
+#endif
+	return ~crc32c_sw(p, bytes, crc);
+}
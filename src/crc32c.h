@@ -0,0 +1,48 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * CRC32C (Castagnoli) checksum
+ *
+ * Used to validate the data stored in HotFiles. The SSE4.2 crc32 instruction
+ * is used when the CPU supports it, with a table-driven fallback otherwise.
+ */
+
+#ifndef _CRC32C_H
+#define _CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+//! Compute the CRC32C of the given data, continuing from the given crc
+/*! The crc of a sequence of blocks can be computed incrementally by passing
+ * the crc of the previous blocks as the last argument
+ */
+uint32_t crc32c(const void *data, size_t bytes, uint32_t crc = 0);
+
+#endif
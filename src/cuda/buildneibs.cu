@@ -34,12 +34,18 @@
 #include <stdio.h>
 
 #include <thrust/sort.h>
+#include <thrust/merge.h>
+#include <thrust/partition.h>
 #include <thrust/device_vector.h>
 #include <thrust/tuple.h>
 #include <thrust/iterator/zip_iterator.h>
+#include <thrust/transform_reduce.h>
+#include <thrust/functional.h>
+#include <thrust/execution_policy.h>
 
 #include "define_buffers.h"
 #include "engine_neibs.h"
+#include "cudabuffer.h"
 #include "utils.h"
 
 #include "textures.cuh"
@@ -50,6 +56,72 @@
 #include "vector_math.h"
 
 
+/// Scratch device memory for the particle sort
+/*! The temporary storage of the thrust algorithms used by the sort, and the
+ * destination of the merge, are handed out by a CUDABufferArena that is kept
+ * across neighbors list constructions, so that sorting does not allocate
+ * device memory at every construction. Memory is returned to the arena
+ * at the beginning of each sort; if the arena had to grow during the
+ * previous one, its blocks are coalesced into a single one.
+ * Since all the algorithms of the sort run on the same stream, the memory
+ * is also recycled between them, so that the scratch never exceeds the
+ * largest single request: about a copy of the hash, info and index arrays
+ * (see GPUWorker::computeMemoryPerParticle()).
+ * This can be passed as allocator to thrust::cuda::par.
+ */
+class sort_scratch
+{
+	CUDABufferArena m_arena;
+
+public:
+	typedef char value_type;
+
+	//! Make the whole scratch available for a new sort
+	void reset()
+	{
+		if (m_arena.num_blocks() > 1) {
+			const size_t total = m_arena.capacity();
+			m_arena.release();
+			m_arena.reserve(total);
+		} else
+			m_arena.rewind();
+	}
+
+	//! Make the memory available to the next algorithm of the same sort
+	/*! \note this invalidates the memory handed out so far,
+	 * so it must not be called while the merged arrays are still in use
+	 */
+	void recycle()
+	{ m_arena.rewind(); }
+
+	//! Return the scratch memory to the device
+	void release()
+	{ m_arena.release(); }
+
+	//! Device memory currently held by the scratch
+	size_t capacity() const
+	{ return m_arena.capacity(); }
+
+	char *allocate(std::ptrdiff_t bytes)
+	{ return static_cast<char*>(m_arena.take(bytes > 0 ? bytes : 1)); }
+
+	//! Memory is only returned to the arena by the next reset()
+	void deallocate(char *, size_t)
+	{}
+
+	//! Typed array from the scratch
+	template<typename T>
+	thrust::device_ptr<T> take(size_t count)
+	{ return thrust::device_pointer_cast(reinterpret_cast<T*>(allocate(count*sizeof(T)))); }
+};
+
+//! The sort scratch of the calling worker thread, i.e. of its device
+static sort_scratch& worker_sort_scratch()
+{
+	static thread_local sort_scratch scratch;
+	return scratch;
+}
+
 /// Neighbor engine class
 /*!	CUDANeibsEngine is an implementation of the abstract class AbstractNeibsEngine
  *	and is providing :
@@ -382,6 +454,26 @@ struct ptype_hash_compare :
 	}
 };
 
+/// Functor to select the static particles, see cuneibs::static_particle()
+struct is_static :
+	public thrust::unary_function<thrust::tuple<hashKey, particleinfo, uint>, bool>
+{
+	__host__ __device__
+	bool operator()(const thrust::tuple<hashKey, particleinfo, uint>& t) const
+	{ return cuneibs::static_particle(thrust::get<1>(t)); }
+};
+
+/// Sort the particle indices by cell, particle type and id
+/*! Static particles do not change hash between neighbors list constructions,
+ * so when the particle arrays were sorted by the previous construction,
+ * the static particles are already in order. We then only sort the other
+ * particles, and merge the two sequences, instead of sorting everything.
+ * This saves a fraction of the sort cost proportional to the fraction of static
+ * particles, which is large in problems with a fixed container.
+ * If the static particles turn out not to be in order (first construction,
+ * change of the device map, particles imported from other devices),
+ * they are sorted too.
+ */
 void
 sort(	BufferList const& bufread,
 		BufferList& bufwrite,
@@ -396,21 +488,72 @@ sort(	BufferList const& bufread,
 
 	ptype_hash_compare comp;
 
-	if (numParticles > 0) {
-		// Sort of the particle indices by cell, fluid number, id and
-		// particle type (PT_FLUID < PT_BOUNDARY < PT_VERTEX)
-		// There is no need for a stable sort due to the id sort
-		thrust::sort_by_key(
-			thrust::make_zip_iterator(thrust::make_tuple(particleHash, particleInfo)),
-			thrust::make_zip_iterator(thrust::make_tuple(
-				particleHash + numParticles,
-				particleInfo + numParticles)),
-			particleIndex, comp);
+	if (numParticles == 0) {
+		KERNEL_CHECK_ERROR;
+		return;
+	}
+
+	sort_scratch& scratch = worker_sort_scratch();
+	scratch.reset();
+	auto policy = thrust::cuda::par(scratch);
+
+	auto keys = thrust::make_zip_iterator(thrust::make_tuple(particleHash, particleInfo));
+	auto all = thrust::make_zip_iterator(thrust::make_tuple(particleHash, particleInfo, particleIndex));
+
+	// Move the static particles first, preserving their order
+	const uint numStatic = thrust::stable_partition(policy, all, all + numParticles, is_static()) - all;
+	scratch.recycle();
+
+	// Sort of the particle indices by cell, fluid number, id and
+	// particle type (PT_FLUID < PT_BOUNDARY < PT_VERTEX)
+	// There is no need for a stable sort due to the id sort
+	if (numStatic < numParticles)
+		thrust::sort_by_key(policy, keys + numStatic, keys + numParticles,
+			particleIndex + numStatic, comp);
+	scratch.recycle();
+
+	if (numStatic > 0 && !thrust::is_sorted(policy, keys, keys + numStatic, comp))
+		thrust::sort_by_key(policy, keys, keys + numStatic, particleIndex, comp);
+	scratch.recycle();
+
+	// Merge the two sorted sequences
+	if (numStatic > 0 && numStatic < numParticles) {
+		thrust::device_ptr<hashKey> mergedHash = scratch.take<hashKey>(numParticles);
+		thrust::device_ptr<particleinfo> mergedInfo = scratch.take<particleinfo>(numParticles);
+		thrust::device_ptr<uint> mergedIndex = scratch.take<uint>(numParticles);
+
+		thrust::merge_by_key(policy,
+			keys, keys + numStatic,
+			keys + numStatic, keys + numParticles,
+			particleIndex, particleIndex + numStatic,
+			thrust::make_zip_iterator(thrust::make_tuple(mergedHash, mergedInfo)),
+			mergedIndex, comp);
+
+		thrust::copy(policy, mergedHash, mergedHash + numParticles, particleHash);
+		thrust::copy(policy, mergedInfo, mergedInfo + numParticles, particleInfo);
+		thrust::copy(policy, mergedIndex, mergedIndex + numParticles, particleIndex);
 	}
 
 	KERNEL_CHECK_ERROR;
 }
 
+size_t
+sortScratchSize() const
+{ return worker_sort_scratch().capacity(); }
+
+void
+releaseSortScratch()
+{ worker_sort_scratch().release(); }
+
+
+/// Functor to get the speed of a particle from its velocity
+struct vel_length :
+	public thrust::unary_function<float4, float>
+{
+	__host__ __device__
+	float operator()(const float4& vel) const
+	{ return length(as_float3(vel)); }
+};
 
 /** @} */
 
@@ -491,6 +634,22 @@ const	float		boundNlSqInflRad)
 	CUDA_SAFE_CALL(cudaUnbindTexture(cellEndTex));
 }
 
+/// Find the maximum particle speed
+float
+maxSpeed(	const BufferList&	bufread,
+			const uint			numParticles)
+{
+	thrust::device_ptr<const float4> vel =
+		thrust::device_pointer_cast(bufread.getData<BUFFER_VEL>());
+
+	const float ret = thrust::transform_reduce(vel, vel + numParticles,
+		vel_length(), 0.0f, thrust::maximum<float>());
+
+	KERNEL_CHECK_ERROR;
+
+	return ret;
+}
+
 /** @} */
 
 };
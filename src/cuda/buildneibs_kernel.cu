@@ -643,6 +643,21 @@ neibsInCell(
 
 	return;
 }
+
+/// Check if a particle is static
+/*! Static particles (fixed boundaries, testpoints) never move, so their hash
+ * is not updated by calcHashDevice, and they keep their relative order in the
+ * sorted particle arrays from one neighbors list construction to the next
+ * (see sort()).
+ */
+__host__ __device__ __forceinline__
+bool
+static_particle(particleinfo const& info)
+{
+	// We compute new hash only for fluid and moving not fluid particles (object, moving boundaries),
+	// and surface boundaries in case of repacking
+	return !(FLUID(info) || MOVING(info) || (SURFACE(info) && !FLUID(info)));
+}
 /** @} */
 
 
@@ -680,9 +695,8 @@ calcHashDevice(	float4*				posArray,			///< [in,out] particle's positions
 	// Get the old grid hash
 	uint gridHash = cellHashFromParticleHash( particleHash[index] );
 
-	// We compute new hash only for fluid and moving not fluid particles (object, moving boundaries),
-	// and surface boundaries in case of repacking
-	if (FLUID(info) || MOVING(info) || (SURFACE(info) && !FLUID(info))) {
+	// We compute new hash only for non-static particles
+	if (!static_particle(info)) {
 		// Getting new pos relative to old cell
 		float4 pos = posArray[index];
 
@@ -41,6 +41,44 @@
 // CUDA_SAFE_CALL etc
 #include "cuda_call.h"
 
+/*! Arena for CUDA device buffers
+ * (on the current device at the time of the allocation)
+ */
+class CUDABufferArena : public BufferArena
+{
+protected:
+	virtual void *allocate_block(size_t bytes)
+	{
+		void *ptr = NULL;
+		// see CUDABuffer::alloc() for INSPECT_DEVICE_MEMORY
+#ifdef INSPECT_DEVICE_MEMORY
+		CUDA_SAFE_CALL(cudaMallocManaged(&ptr, bytes));
+#else
+		CUDA_SAFE_CALL(cudaMalloc(&ptr, bytes));
+#endif
+		return ptr;
+	}
+
+	virtual void free_block(void *ptr, size_t)
+	{
+		try {
+			CUDA_SAFE_CALL(cudaFree(ptr));
+		} catch (std::exception const& e) {
+			// we may be called from a destructor, don't throw
+#if _DEBUG_
+			std::cerr << e.what() << " [while freeing buffer arena block]" << std::endl;
+#endif
+		}
+	}
+
+public:
+	virtual ~CUDABufferArena()
+	{ release(); }
+
+	virtual void fill(void *ptr, int value, size_t bytes)
+	{ CUDA_SAFE_CALL(cudaMemset(ptr, value, bytes)); }
+};
+
 /*! Specialize the Buffer class in the case of CUDA device allocations
  * (i.e. using cudaMalloc/cudaFree/cudaMemset/etc)
  */
@@ -58,6 +96,13 @@ public:
 	virtual ~CUDABuffer() {
 		const int N = baseclass::array_count;
 		element_type **bufs = baseclass::get_raw_ptr();
+		AbstractBuffer::account_free();
+		// arrays taken from an arena are released with it
+		if (this->arena()) {
+			for (int i = 0; i < N; ++i)
+				bufs[i] = NULL;
+			return;
+		}
 		for (int i = 0; i < N; ++i) {
 #if _DEBUG_
 			//printf("\tfreeing buffer %d\n", i);
@@ -94,7 +139,13 @@ public:
 		const size_t bufmem = elems*sizeof(element_type);
 		const int N = baseclass::array_count;
 		element_type **bufs = baseclass::get_raw_ptr();
+		BufferArena *arena = this->arena();
 		for (int i = 0; i < N; ++i) {
+			if (arena) {
+				bufs[i] = (element_type*)arena->take(bufmem);
+				arena->fill(bufs[i], baseclass::get_init_value(), bufmem);
+				continue;
+			}
 #ifdef INSPECT_DEVICE_MEMORY
 			// If device memory inspection (from host) is enabled,
 			// the device buffers are allocated in managed mode,
@@ -109,6 +160,7 @@ public:
 #endif
 			CUDA_SAFE_CALL(cudaMemset(bufs[i], baseclass::get_init_value(), bufmem));
 		}
+		AbstractBuffer::account_alloc(bufmem*N);
 		return bufmem*N;
 	}
 
@@ -80,3 +80,11 @@ cudaDeviceProp checkCUDA(const GlobalData* gdata, uint devidx)
 
 	return deviceProp;
 }
+
+int cudaDeviceNumaNode(int cudaDevNum)
+{
+	char busId[32];
+	if (cudaDeviceGetPCIBusId(busId, sizeof(busId), cudaDevNum) != cudaSuccess)
+		return -1;
+	return numa_node_of_pci_device(busId);
+}
@@ -33,4 +33,7 @@
 
 cudaDeviceProp checkCUDA(const GlobalData* gdata, uint devnum);
 
+//! NUMA node the given CUDA device is attached to, -1 if unknown
+int cudaDeviceNumaNode(int cudaDevNum);
+
 #endif
@@ -116,7 +116,7 @@ struct CUDAPostProcessEngineHelper<VORTICITY, kerneltype, boundarytype, simflags
 		const uint *cellStart = bufread.getData<BUFFER_CELLSTART>();
 		const neibdata *neibsList = bufread.getData<BUFFER_NEIBSLIST>();
 
-		float3 *vort = bufwrite.getData<BUFFER_VORTICITY>();
+		BufferTraits<BUFFER_VORTICITY>::element_type *vort = bufwrite.getData<BUFFER_VORTICITY>();
 
 		#if !PREFER_L1
 		CUDA_SAFE_CALL(cudaBindTexture(0, posTex, pos, numParticles*sizeof(float4)));
@@ -252,7 +252,7 @@ struct CUDAPostProcessEngineHelper<SURFACE_DETECTION, kerneltype, boundarytype,
 		particleinfo *newInfo = bufwrite.getData<BUFFER_INFO,
 			BufferList::AccessSafety::MULTISTATE_SAFE>();
 
-		float4 *normals = bufwrite.getData<BUFFER_NORMALS>();
+		BufferTraits<BUFFER_NORMALS>::element_type *normals = bufwrite.getData<BUFFER_NORMALS>();
 
 		#if !PREFER_L1
 		CUDA_SAFE_CALL(cudaBindTexture(0, posTex, pos, numParticles*sizeof(float4)));
@@ -334,7 +334,7 @@ struct CUDAPostProcessEngineHelper<INTERFACE_DETECTION, kerneltype, boundarytype
 		particleinfo *newInfo = bufwrite.getData<BUFFER_INFO,
 			BufferList::AccessSafety::MULTISTATE_SAFE>();
 
-		float4 *normals = bufwrite.getData<BUFFER_NORMALS>();
+		BufferTraits<BUFFER_NORMALS>::element_type *normals = bufwrite.getData<BUFFER_NORMALS>();
 
 		#if !PREFER_L1
 		CUDA_SAFE_CALL(cudaBindTexture(0, posTex, pos, numParticles*sizeof(float4)));
@@ -427,7 +427,7 @@ struct CUDAPostProcessEngineHelper<INTERFACE_DETECTION, kerneltype, SA_BOUNDARY,
 		particleinfo *newInfo = bufwrite.getData<BUFFER_INFO,
 			BufferList::AccessSafety::MULTISTATE_SAFE>();
 
-		float4 *normals = bufwrite.getData<BUFFER_NORMALS>();
+		BufferTraits<BUFFER_NORMALS>::element_type *normals = bufwrite.getData<BUFFER_NORMALS>();
 
 		#if !PREFER_L1
 		CUDA_SAFE_CALL(cudaBindTexture(0, posTex, pos, numParticles*sizeof(float4)));
@@ -58,7 +58,7 @@ using namespace cubounds;
 template<KernelType kerneltype>
 __global__ void
 calcVortDevice(	const	float4*		posArray,
-						float3*		vorticity,
+			BufferTraits<BUFFER_VORTICITY>::element_type*	vorticity,
 				const	hashKey*		particleHash,
 				const	uint*		cellStart,
 				const	neibdata*	neibsList,
@@ -81,7 +81,7 @@ calcVortDevice(	const	float4*		posArray,
 	#endif
 
 	if (NOT_FLUID(info) || INACTIVE(pos)) {
-		vorticity[index] = make_float3(NAN);
+		store_element<BUFFER_VORTICITY>(vorticity[index], make_float3(NAN));
 		return;
 	}
 
@@ -127,7 +127,7 @@ calcVortDevice(	const	float4*		posArray,
 		}
 	} // end of loop trough neighbors
 
-	vorticity[index] = vort;
+	store_element<BUFFER_VORTICITY>(vorticity[index], vort);
 }
 
 
@@ -244,7 +244,7 @@ calcTestpointsVelocityDevice(	const float4*	oldPos,
 template<KernelType kerneltype, BoundaryType boundarytype, flag_t simflags, bool savenormals>
 __global__ void
 calcSurfaceparticleDevice(	const	float4*			posArray,
-									float4*			normals,
+				BufferTraits<BUFFER_NORMALS>::element_type*	normals,
 									particleinfo*	newInfo,
 							const	hashKey*		particleHash,
 							const	uint*			cellStart,
@@ -270,7 +270,7 @@ calcSurfaceparticleDevice(	const	float4*			posArray,
 
 	if (NOT_FLUID(info) || INACTIVE(pos)) {
 		if (savenormals)
-			normals[index] = make_float4(NAN);
+			store_element<BUFFER_NORMALS>(normals[index], make_float4(NAN));
 		return;
 	}
 
@@ -381,7 +381,7 @@ calcSurfaceparticleDevice(	const	float4*			posArray,
 		normal.x /= normal_length;
 		normal.y /= normal_length;
 		normal.z /= normal_length;
-		normals[index] = normal;
+		store_element<BUFFER_NORMALS>(normals[index], normal);
 		}
 
 }
@@ -390,7 +390,7 @@ calcSurfaceparticleDevice(	const	float4*			posArray,
 template<KernelType kerneltype, BoundaryType boundarytype, flag_t simflags, bool savenormals>
 __global__ void
 calcInterfaceparticleDevice(	const	float4*			posArray,
-									float4*			normals,
+				BufferTraits<BUFFER_NORMALS>::element_type*	normals,
 									particleinfo*	newInfo,
 							const	hashKey*		particleHash,
 							const	uint*			cellStart,
@@ -420,7 +420,7 @@ calcInterfaceparticleDevice(	const	float4*			posArray,
 		// NOTE: inactive particles will keep their last surface flag status
 		newInfo[index] = info;
 		if (savenormals)
-			normals[index] = make_float4(NAN);
+			store_element<BUFFER_NORMALS>(normals[index], make_float4(NAN));
 		return;
 	}
 
@@ -564,9 +564,9 @@ calcInterfaceparticleDevice(	const	float4*			posArray,
 		normal_if.z /= normal_if_length;
 
 		if (!nc_if && nc_fs) {
-			normals[index] = normal_if;
+			store_element<BUFFER_NORMALS>(normals[index], normal_if);
 		} else {
-			normals[index] = normal_fs;
+			store_element<BUFFER_NORMALS>(normals[index], normal_fs);
 		}
 	}
 }
@@ -575,7 +575,7 @@ calcInterfaceparticleDevice(	const	float4*			posArray,
 template<KernelType kerneltype, BoundaryType boundarytype, flag_t simflags, bool savenormals>
 __global__ void
 calcInterfaceparticleDevice(	const	float4*			posArray,
-									float4*			normals,
+				BufferTraits<BUFFER_NORMALS>::element_type*	normals,
 									particleinfo*	newInfo,
 							const	float2 *		vertPos0,
 							const	float2 *		vertPos1,
@@ -608,7 +608,7 @@ calcInterfaceparticleDevice(	const	float4*			posArray,
 		// NOTE: inactive particles will keep their last surface flag status
 		newInfo[index] = info;
 		if (savenormals)
-			normals[index] = make_float4(NAN);
+			store_element<BUFFER_NORMALS>(normals[index], make_float4(NAN));
 		return;
 	}
 
@@ -811,9 +811,9 @@ calcInterfaceparticleDevice(	const	float4*			posArray,
 		normal_if.z /= normal_if_length;
 
 		if (!nc_if && nc_fs) {
-			normals[index] = normal_if;
+			store_element<BUFFER_NORMALS>(normals[index], normal_if);
 		} else {
-			normals[index] = normal_fs;
+			store_element<BUFFER_NORMALS>(normals[index], normal_fs);
 		}
 	}
 }
@@ -106,10 +106,31 @@ SET_BUFFER_TRAITS(BUFFER_XSPH, float4, 1, "XSPH");
 #define BUFFER_TAU			(BUFFER_XSPH << 1)
 SET_BUFFER_TRAITS(BUFFER_TAU, float2, 3, "Tau");
 
+/* Storage precision of the post-processing buffers, which are only
+ * consumed by the writers. They can be stored in reduced precision
+ * (PRECISION_FP16, PRECISION_BF16, or PRECISION_FIXED16 with the given
+ * scale) by defining VORTICITY_PRECISION and NORMALS_PRECISION
+ * (and the corresponding _SCALE) at compile time.
+ */
+#ifndef VORTICITY_PRECISION
+#define VORTICITY_PRECISION PRECISION_FP32
+#endif
+#ifndef VORTICITY_SCALE
+#define VORTICITY_SCALE 1.0f
+#endif
+#ifndef NORMALS_PRECISION
+#define NORMALS_PRECISION PRECISION_FP32
+#endif
+#ifndef NORMALS_SCALE
+#define NORMALS_SCALE 1.0f
+#endif
+
 #define BUFFER_VORTICITY	(BUFFER_TAU << 1)
-SET_BUFFER_TRAITS(BUFFER_VORTICITY, float3, 1, "Vorticity");
+SET_BUFFER_TRAITS(BUFFER_VORTICITY, STORED_TYPE(float3, VORTICITY_PRECISION), 1, "Vorticity");
+SET_BUFFER_PRECISION(BUFFER_VORTICITY, float3, VORTICITY_PRECISION, VORTICITY_SCALE);
 #define BUFFER_NORMALS		(BUFFER_VORTICITY << 1)
-SET_BUFFER_TRAITS(BUFFER_NORMALS, float4, 1, "Normals");
+SET_BUFFER_TRAITS(BUFFER_NORMALS, STORED_TYPE(float4, NORMALS_PRECISION), 1, "Normals");
+SET_BUFFER_PRECISION(BUFFER_NORMALS, float4, NORMALS_PRECISION, NORMALS_SCALE);
 
 /** Boundary elements buffer.
  *
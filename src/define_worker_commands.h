@@ -178,6 +178,10 @@ DEFINE_COMMAND_BUF(SORT, false)
 DEFINE_COMMAND_BUF(REORDER, false)
 /// Build the neighbors list
 DEFINE_COMMAND_BUF(BUILDNEIBS, true)
+/// Find the maximum particle speed, to decide when to rebuild the neighbors list
+/*! Only used with adaptive neighbors list construction (buildneibsfreq = 0)
+ */
+DEFINE_COMMAND_BUF(FIND_MAX_SPEED, true)
 
 /** @} */
 
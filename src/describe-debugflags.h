@@ -16,3 +16,4 @@ cout << "\tcheck_buffer_consistency\t:\tcheck buffer consistency\n";
 cout << "\tclobber_invalid_buffers\t:\tclobber invalid buffers\n";
 cout << "\tvalidate_init_positions\t:\tThrow (instead of just warn) if a particle is out of bounds during init\n";
 cout << "\tbenchmark_command_runtimes\t:\tMeasure (and show) command runtimes\n";
+cout << "\tbenchmark_host_counters\t:\tMeasure (and show) hardware counters for host commands and regions\n";
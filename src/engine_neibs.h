@@ -95,6 +95,14 @@ public:
 			BufferList& bufwrite,
 			uint	numParticles) = 0;
 
+	/// Device memory held by the sort scratch of the calling worker thread
+	virtual size_t
+	sortScratchSize() const = 0;
+
+	/// Return the sort scratch of the calling worker thread to the device
+	virtual void
+	releaseSortScratch() = 0;
+
 	/// Build the neighbors list
 	virtual void
 	buildNeibsList( const BufferList&	bufread,
@@ -104,5 +112,11 @@ public:
 					const uint			gridCells,
 					const float			sqinfluenceradius,
 					const float			boundNlSqInflRad) = 0;
+
+	/// Find the maximum particle speed, used to bound the particle displacement
+	/// since the last neighbors list construction
+	virtual float
+	maxSpeed(		const BufferList&	bufread,
+					const uint			numParticles) = 0;
 };
 #endif
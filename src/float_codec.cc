@@ -0,0 +1,194 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the lossless float codec
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "float_codec.h"
+
+using namespace std;
+
+namespace {
+
+/* Run-length encoding of the zero runs: each run starts with a control byte c:
+ * c < 0x80: c + 1 literal bytes follow
+ * 0x80 <= c < 0xff: c - 0x80 + 2 zero bytes
+ * c == 0xff: the number of zero bytes follows, as 4 little-endian bytes
+ */
+const unsigned char max_literal = 0x80;
+const unsigned char zero_run = 0x80;
+const unsigned char long_zero_run = 0xff;
+const size_t max_short_zeros = long_zero_run - zero_run + 1;
+
+// XOR with the previous element and shuffle
+void xor_shuffle(const unsigned char *src, size_t bytes, size_t es, unsigned char *dst)
+{
+	const size_t n = bytes/es;
+	for (size_t j = 0; j < es; ++j) {
+		unsigned char prev = 0;
+		const unsigned char *in = src + j;
+		unsigned char *out = dst + j*n;
+		for (size_t k = 0; k < n; ++k, in += es) {
+			out[k] = *in ^ prev;
+			prev = *in;
+		}
+	}
+	// trailing bytes that do not make a full element are stored as-is
+	memcpy(dst + n*es, src + n*es, bytes - n*es);
+}
+
+// inverse of xor_shuffle
+void unshuffle_xor(const unsigned char *src, size_t bytes, size_t es, unsigned char *dst)
+{
+	const size_t n = bytes/es;
+	for (size_t j = 0; j < es; ++j) {
+		unsigned char prev = 0;
+		const unsigned char *in = src + j*n;
+		unsigned char *out = dst + j;
+		for (size_t k = 0; k < n; ++k, out += es) {
+			prev ^= in[k];
+			*out = prev;
+		}
+	}
+	memcpy(dst + n*es, src + n*es, bytes - n*es);
+}
+
+void corrupted()
+{
+	throw runtime_error("corrupted compressed data");
+}
+
+}
+
+size_t float_codec_encode(const void *src, size_t bytes, size_t element_size,
+	vector<char>& dst)
+{
+	if (element_size == 0)
+		element_size = 1;
+
+	vector<unsigned char> shuffled(bytes);
+	xor_shuffle(static_cast<const unsigned char*>(src), bytes, element_size, shuffled.data());
+
+	const size_t start = dst.size();
+	// we give up as soon as the encoded data gets as large as the input
+	dst.resize(start + bytes);
+	unsigned char *out = reinterpret_cast<unsigned char*>(dst.data() + start);
+	const unsigned char *in = shuffled.data();
+	size_t o = 0;
+
+	size_t i = 0;
+	while (i < bytes) {
+		size_t zeros = 0;
+		while (i + zeros < bytes && zeros < UINT32_MAX && in[i + zeros] == 0)
+			++zeros;
+
+		if (zeros >= 2) {
+			if (zeros <= max_short_zeros) {
+				if (o + 1 >= bytes) break;
+				out[o++] = zero_run + (zeros - 2);
+			} else {
+				if (o + 5 >= bytes) break;
+				const uint32_t count = zeros;
+				out[o++] = long_zero_run;
+				for (int b = 0; b < 4; ++b)
+					out[o++] = (count >> (8*b)) & 0xff;
+			}
+			i += zeros;
+			continue;
+		}
+
+		// literal run, up to the next pair of zeros
+		size_t len = 0;
+		while (i + len < bytes && len < max_literal &&
+			!(in[i + len] == 0 && i + len + 1 < bytes && in[i + len + 1] == 0))
+			++len;
+		if (o + 1 + len >= bytes) {
+			o = bytes;
+			break;
+		}
+		out[o++] = len - 1;
+		memcpy(out + o, in + i, len);
+		o += len;
+		i += len;
+	}
+
+	if (i < bytes || o >= bytes) {
+		dst.resize(start);
+		return 0;
+	}
+	dst.resize(start + o);
+	return o;
+}
+
+void float_codec_decode(const void *src, size_t src_bytes,
+	void *dst, size_t bytes, size_t element_size)
+{
+	if (element_size == 0)
+		element_size = 1;
+
+	vector<unsigned char> shuffled(bytes);
+	unsigned char *out = shuffled.data();
+	const unsigned char *in = static_cast<const unsigned char*>(src);
+	const unsigned char *end = in + src_bytes;
+
+	size_t o = 0;
+	while (in < end) {
+		const unsigned char c = *in++;
+		size_t len;
+		if (c < zero_run) {
+			len = size_t(c) + 1;
+			if (size_t(end - in) < len || o + len > bytes)
+				corrupted();
+			memcpy(out + o, in, len);
+			in += len;
+		} else {
+			if (c < long_zero_run) {
+				len = c - zero_run + 2;
+			} else {
+				if (end - in < 4)
+					corrupted();
+				len = 0;
+				for (int b = 0; b < 4; ++b)
+					len |= size_t(*in++) << (8*b);
+			}
+			if (o + len > bytes)
+				corrupted();
+			memset(out + o, 0, len);
+		}
+		o += len;
+	}
+	if (o != bytes)
+		corrupted();
+
+	unshuffle_xor(shuffled.data(), bytes, element_size, static_cast<unsigned char*>(dst));
+}
@@ -0,0 +1,62 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Lossless codec for arrays of floating-point (and integer) structures
+ *
+ * Each element is XORed with the previous one, so that the bytes the two
+ * share (sign, exponent and high mantissa of nearby positions, constant
+ * masses and particle info fields) become zero, the bytes are then shuffled
+ * so that byte k of all elements comes together, and the resulting zero runs
+ * are run-length encoded. This works well on the particle arrays, since
+ * particles are sorted by cell hash and neighbouring particles have similar
+ * values. Decoding gives back the exact same bytes.
+ */
+
+#ifndef _FLOAT_CODEC_H
+#define _FLOAT_CODEC_H
+
+#include <cstddef>
+#include <vector>
+
+//! Encode the given data, made of elements of element_size bytes
+/*! The encoded data is appended to dst.
+ * \return the size of the encoded data, or 0 (with dst left unchanged)
+ * if it would not be smaller than the input
+ */
+size_t float_codec_encode(const void *src, size_t bytes, size_t element_size,
+	std::vector<char>& dst);
+
+//! Decode data encoded by float_codec_encode
+/*! bytes and element_size must be the same that were used to encode.
+ * Throws if the encoded data is corrupted.
+ */
+void float_codec_decode(const void *src, size_t src_bytes,
+	void *dst, size_t bytes, size_t element_size);
+
+#endif
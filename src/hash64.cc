@@ -0,0 +1,134 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the XXH64 hash
+ */
+
+#include <cstring>
+
+#include "hash64.h"
+
+namespace {
+
+const uint64_t prime1 = 11400714785074694791ULL;
+const uint64_t prime2 = 14029467366897019727ULL;
+const uint64_t prime3 =  1609587929392839161ULL;
+const uint64_t prime4 =  9650029242287828579ULL;
+const uint64_t prime5 =  2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x, int r)
+{ return (x << r) | (x >> (64 - r)); }
+
+// unaligned little-endian reads
+inline uint64_t read64(const unsigned char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint32_t read32(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+	acc += input*prime2;
+	acc = rotl(acc, 31);
+	return acc*prime1;
+}
+
+inline uint64_t merge_round(uint64_t acc, uint64_t val)
+{
+	acc ^= xxh_round(0, val);
+	return acc*prime1 + prime4;
+}
+
+}
+
+uint64_t hash64(const void *data, size_t bytes, uint64_t seed)
+{
+	const unsigned char *p = static_cast<const unsigned char*>(data);
+	const unsigned char * const end = p + bytes;
+	uint64_t h;
+
+	if (bytes >= 32) {
+		const unsigned char * const limit = end - 32;
+		uint64_t v1 = seed + prime1 + prime2;
+		uint64_t v2 = seed + prime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - prime1;
+
+		do {
+			v1 = xxh_round(v1, read64(p)); p += 8;
+			v2 = xxh_round(v2, read64(p)); p += 8;
+			v3 = xxh_round(v3, read64(p)); p += 8;
+			v4 = xxh_round(v4, read64(p)); p += 8;
+		} while (p <= limit);
+
+		h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		h = merge_round(h, v1);
+		h = merge_round(h, v2);
+		h = merge_round(h, v3);
+		h = merge_round(h, v4);
+	} else {
+		h = seed + prime5;
+	}
+
+	h += bytes;
+
+	while (p + 8 <= end) {
+		h ^= xxh_round(0, read64(p));
+		h = rotl(h, 27)*prime1 + prime4;
+		p += 8;
+	}
+
+	if (p + 4 <= end) {
+		h ^= uint64_t(read32(p))*prime1;
+		h = rotl(h, 23)*prime2 + prime3;
+		p += 4;
+	}
+
+	while (p < end) {
+		h ^= (*p)*prime5;
+		h = rotl(h, 11)*prime1;
+		++p;
+	}
+
+	h ^= h >> 33;
+	h *= prime2;
+	h ^= h >> 29;
+	h *= prime3;
+	h ^= h >> 32;
+
+	return h;
+}
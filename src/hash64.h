@@ -0,0 +1,46 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * 64-bit content hash (XXH64)
+ *
+ * A fast non-cryptographic hash, used to detect which parts of the
+ * simulation data changed between checkpoints. This is an implementation
+ * of the XXH64 algorithm by Yann Collet, and gives the same results.
+ */
+
+#ifndef _HASH64_H
+#define _HASH64_H
+
+#include <cstddef>
+#include <cstdint>
+
+//! Compute the XXH64 hash of the given data with the given seed
+uint64_t hash64(const void *data, size_t bytes, uint64_t seed = 0);
+
+#endif
@@ -0,0 +1,115 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the host time-step reduction
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "host_dtreduce.h"
+#include "define_buffers.h"
+#include "parallel_jobs.h"
+#include "utils.h"
+
+using namespace std;
+
+/*! Number of elements reduced by each parallel job. Smaller arrays
+ * (such as the device-style per-block CFL arrays) are reduced serially
+ */
+#define HOST_DTREDUCE_CHUNK (64*1024)
+
+/*! Maximum of the elements in [first, last), with independent partial
+ * maxima so that the loop can be vectorized. The comparison
+ * is written so that NaNs are skipped, as with fmaxf on device.
+ */
+static float
+chunk_max(const float *cfl, size_t first, size_t last)
+{
+	enum { lanes = 8 };
+	float partial[lanes] = { 0 };
+
+	size_t i = first;
+	for (; i + lanes <= last; i += lanes)
+		for (uint l = 0; l < lanes; ++l) {
+			const float v = cfl[i + l];
+			partial[l] = v > partial[l] ? v : partial[l];
+		}
+	for (; i < last; ++i) {
+		const float v = cfl[i];
+		partial[0] = v > partial[0] ? v : partial[0];
+	}
+
+	float max = partial[0];
+	for (uint l = 1; l < lanes; ++l)
+		max = partial[l] > max ? partial[l] : max;
+	return max;
+}
+
+float
+HostDtReduce::cflmax(const float *cfl, size_t n)
+{
+	const size_t numChunks = div_up<size_t>(n, HOST_DTREDUCE_CHUNK);
+	if (numChunks < 2)
+		return chunk_max(cfl, 0, n);
+
+	vector<float> chunk_maxima(numChunks);
+	parallel_jobs(numChunks, [&](size_t chunk) {
+		const size_t first = chunk*HOST_DTREDUCE_CHUNK;
+		chunk_maxima[chunk] = chunk_max(cfl, first, min(first + HOST_DTREDUCE_CHUNK, n));
+	});
+
+	return chunk_max(chunk_maxima.data(), 0, numChunks);
+}
+
+float
+HostDtReduce::dtreduce(	float	sspeed_cfl,
+						BufferList const& bufread,
+						uint	numElements,
+						uint	numParticles) const
+{
+	const float slength = m_simparams->slength;
+	const float *cfl_forces = bufread.getData<BUFFER_CFL>();
+	const float *cfl_gamma = bufread.getData<BUFFER_CFL_GAMMA>();
+
+	float maxcfl = cflmax(cfl_forces, numElements);
+	float dt = m_simparams->dtadaptfactor*fminf(sqrtf(slength/maxcfl), slength/sspeed_cfl);
+
+	if (m_simparams->boundarytype == SA_BOUNDARY && USING_DYNAMIC_GAMMA(m_simparams->simflags)) {
+		// as on device, the gamma CFL values are found after the first numParticles elements
+		const size_t cfl_gamma_offset = round_up(numParticles, 4U);
+		maxcfl = fmaxf(cflmax(cfl_gamma + cfl_gamma_offset, numElements), 1e-5f/dt);
+		const float dt_gam = 0.001f/maxcfl;
+		if (dt_gam < dt)
+			dt = dt_gam;
+	}
+
+	return dt;
+}
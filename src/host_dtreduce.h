@@ -0,0 +1,79 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Time-step reduction on host
+ */
+
+#ifndef _HOST_DTREDUCE_H
+#define _HOST_DTREDUCE_H
+
+#include <cstddef>
+
+#include "buffer.h"
+#include "simparams.h"
+
+//! Host implementation of the adaptive time-step reduction
+/*! This is the host counterpart of AbstractForcesEngine::dtreduce():
+ * it finds the maximum of the CFL arrays (BUFFER_CFL, and BUFFER_CFL_GAMMA
+ * with SA boundaries and dynamic gamma) with a parallel reduction,
+ * and derives the maximum allowed time-step with the same conditions
+ * as the device, so that the result can be used in place of the one
+ * returned by the forces engine (e.g. to fill GlobalData::dts).
+ *
+ * On host the CFL arrays need not be pre-reduced per block: any number
+ * of elements can be reduced, e.g. one per particle.
+ */
+class HostDtReduce
+{
+	const SimParams	*m_simparams;
+
+public:
+	HostDtReduce(const SimParams *simparams) :
+		m_simparams(simparams)
+	{}
+
+	//! Maximum of the n values in cfl, computed in parallel
+	/*! NaNs are ignored. Returns 0 for an empty array.
+	 */
+	static float cflmax(const float *cfl, size_t n);
+
+	//! Find the maximum allowed time-step
+	/*! numElements is the number of elements to reduce in the CFL arrays;
+	 * as on device, the gamma CFL values start after the first
+	 * numParticles (rounded up to a multiple of 4) elements of BUFFER_CFL_GAMMA.
+	 * As on device, there is no viscous (h²/ν) condition, so unlike
+	 * AbstractForcesEngine::dtreduce() this takes no maximum kinematic viscosity.
+	 */
+	float dtreduce(	float	sspeed_cfl,
+					BufferList const& bufread,
+					uint	numElements,
+					uint	numParticles) const;
+};
+
+#endif
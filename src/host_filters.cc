@@ -0,0 +1,348 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the host density filters
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "host_filters.h"
+#include "kernel_table.h"
+#include "parallel_jobs.h"
+#include "ProblemCore.h"
+#include "vector_math.h"
+
+using namespace std;
+
+//! Number of particles processed together by each parallel job
+#define HOST_FILTER_BATCH 128
+
+//! Maximum number of conjugate residual steps in the MLS solution, as on device
+#define HOST_MLS_CR_STEPS 32
+
+namespace {
+
+//! MLS matrices and solutions of a batch of particles, in SoA form
+struct mls_batch
+{
+	enum { XX, XY, XZ, XW, YY, YZ, YW, ZZ, ZW, WW, COMPONENTS };
+
+	float	m[COMPONENTS][HOST_FILTER_BATCH];
+	float	b[4][HOST_FILTER_BATCH];
+	//! lanes whose solution has converged
+	uint8_t	done[HOST_FILTER_BATCH];
+};
+
+//! First row of the adjugate of a symmetric 4x4 matrix, as in tensor.cu
+/*! The first row of the adjugate does not depend on the first diagonal element */
+static inline float4
+adjugate_row1(float xy, float xz, float xw,
+	float yy, float yz, float yw, float zz, float zw, float ww)
+{
+	return make_float4(
+		yy*zz*ww + yz*zw*yw + yw*yz*zw - yy*zw*zw - yz*yz*ww - yw*zz*yw,
+		xy*zw*zw + yz*xz*ww + yw*zz*xw - xy*zz*ww - yz*zw*xw - yw*xz*zw,
+		xy*yz*ww + yy*zw*xw + yw*xz*yw - xy*zw*yw - yy*xz*ww - yw*yz*xw,
+		xy*zz*yw + yy*xz*zw + yz*yz*xw - xy*yz*zw - yy*zz*xw - yz*xz*yw);
+}
+
+//! Solve M B = (1, 0, 0, 0) for the count particles of the batch
+/*! The initial solution is found from the adjugate, regularizing
+ * (nearly) singular matrices as on device, and then refined with the
+ * conjugate residual method. All the loops run over the particles
+ * of the batch, without branches, so that they can be vectorized;
+ * the refinement stops when all the particles of the batch have converged.
+ */
+static void
+mls_solve(mls_batch &batch, uint count)
+{
+	typedef mls_batch B;
+	float (&m)[B::COMPONENTS][HOST_FILTER_BATCH] = batch.m;
+	float (&b)[4][HOST_FILTER_BATCH] = batch.b;
+
+	for (uint l = 0; l < count; ++l) {
+		const float xx = m[B::XX][l], xy = m[B::XY][l], xz = m[B::XZ][l], xw = m[B::XW][l];
+		const float yy = m[B::YY][l], yz = m[B::YZ][l], yw = m[B::YW][l];
+		const float zz = m[B::ZZ][l], zw = m[B::ZW][l], ww = m[B::WW][l];
+
+		float4 a = adjugate_row1(xy, xz, xw, yy, yz, yw, zz, zw, ww);
+		const float D = xx*a.x + xy*a.y + xz*a.z + xw*a.w;
+
+		// regularize the matrix if it is (nearly) singular
+		const float eps = fabsf(D) < FLT_EPSILON ? fabsf(D) + FLT_EPSILON : 0.0f;
+		a = adjugate_row1(xy, xz, xw, yy + eps, yz, yw, zz + eps, zw, ww + eps);
+		const float D_eps = (xx + eps)*a.x + xy*a.y + xz*a.z + xw*a.w;
+
+		b[0][l] = a.x/D_eps;
+		b[1][l] = a.y/D_eps;
+		b[2][l] = a.z/D_eps;
+		b[3][l] = a.w/D_eps;
+		batch.done[l] = 0;
+	}
+
+	for (uint step = 0; step < HOST_MLS_CR_STEPS; ++step) {
+		uint pending = 0;
+		for (uint l = 0; l < count; ++l) {
+			const float xx = m[B::XX][l], xy = m[B::XY][l], xz = m[B::XZ][l], xw = m[B::XW][l];
+			const float yy = m[B::YY][l], yz = m[B::YZ][l], yw = m[B::YW][l];
+			const float zz = m[B::ZZ][l], zw = m[B::ZW][l], ww = m[B::WW][l];
+			const float b0 = b[0][l], b1 = b[1][l], b2 = b[2][l], b3 = b[3][l];
+
+			const float lenB = sqrtf(b0*b0 + b1*b1 + b2*b2 + b3*b3);
+
+			// residual E - M.B
+			const float r0 = 1 - (xx*b0 + xy*b1 + xz*b2 + xw*b3);
+			const float r1 = -(xy*b0 + yy*b1 + yz*b2 + yw*b3);
+			const float r2 = -(xz*b0 + yz*b1 + zz*b2 + zw*b3);
+			const float r3 = -(xw*b0 + yw*b1 + zw*b2 + ww*b3);
+
+			// M.r, r.M.r and (M.r).(M.r)
+			const float p0 = xx*r0 + xy*r1 + xz*r2 + xw*r3;
+			const float p1 = xy*r0 + yy*r1 + yz*r2 + yw*r3;
+			const float p2 = xz*r0 + yz*r1 + zz*r2 + zw*r3;
+			const float p3 = xw*r0 + yw*r1 + zw*r2 + ww*r3;
+			const float num = r0*p0 + r1*p1 + r2*p2 + r3*p3;
+			const float den = p0*p0 + p1*p1 + p2*p2 + p3*p3;
+
+			const float c = num/den;
+			const float lenres = sqrtf(r0*r0 + r1*r1 + r2*r2 + r3*r3);
+			const float lencorr = fabsf(c)*lenres;
+
+			// as on device, plus the case where no progress can be made
+			const bool converged = batch.done[l] || !(den > 0) ||
+				lenres < lenB*FLT_EPSILON || lencorr < 2*lenB*FLT_EPSILON;
+
+			b[0][l] = converged ? b0 : b0 + c*r0;
+			b[1][l] = converged ? b1 : b1 + c*r1;
+			b[2][l] = converged ? b2 : b2 + c*r2;
+			b[3][l] = converged ? b3 : b3 + c*r3;
+			batch.done[l] = converged;
+			pending += !converged;
+		}
+		if (!pending)
+			break;
+	}
+}
+
+}
+
+HostFilterEngine::HostFilterEngine(FilterType filtertype, uint frequency, const ProblemCore *problem) :
+	AbstractFilterEngine(frequency),
+	m_problem(problem),
+	m_filtertype(filtertype),
+	m_list(HostNeibsList::FULL_LIST)
+{
+	if (filtertype != SHEPARD_FILTER && filtertype != MLS_FILTER)
+		throw invalid_argument("unsupported filter for host filtering");
+}
+
+template<KernelType kerneltype>
+void
+HostFilterEngine::process_kernel(
+	const	double4			*gpos,
+	const	float4			*vel,
+	const	particleinfo	*info,
+			float4			*newVel,
+			uint			particleRangeEnd,
+			float			slength,
+			float			influenceradius) const
+{
+	const AnalyticKernel<kerneltype> kernel(slength, influenceradius/slength);
+	const float W0 = kernel.W(0);
+	const float r2max = influenceradius*influenceradius;
+	const bool dyn_boundary = (m_problem->simparams()->boundarytype == DYN_BOUNDARY);
+	const bool mls = (m_filtertype == MLS_FILTER);
+	const size_t numBatches = (particleRangeEnd + HOST_FILTER_BATCH - 1)/HOST_FILTER_BATCH;
+
+	// physical density of all the particles that can be neighbors
+	const uint numParticles = m_list.num_particles();
+	vector<float> rho(numParticles);
+	parallel_jobs((numParticles + HOST_FILTER_BATCH - 1)/HOST_FILTER_BATCH, [&](size_t batch) {
+		const uint first = batch*HOST_FILTER_BATCH;
+		const uint last = min(first + HOST_FILTER_BATCH, numParticles);
+		for (uint i = first; i < last; ++i)
+			rho[i] = m_problem->physical_density(vel[i].w, fluid_num(info[i]));
+	});
+
+	// neighbors contributing to the filter, as on device
+	auto contributes = [&](uint j) {
+		return FLUID(info[j]) || (dyn_boundary && BOUNDARY(info[j]));
+	};
+
+	auto relpos = [&](uint i, uint j) {
+		return make_float3(gpos[i].x - gpos[j].x, gpos[i].y - gpos[j].y, gpos[i].z - gpos[j].z);
+	};
+
+	auto shepard = [&](uint i) {
+		float4 v = vel[i];
+		if (INACTIVE(gpos[i]) || NOT_FLUID(info[i])) {
+			newVel[i] = v;
+			return;
+		}
+
+		// self contribution
+		float temp1 = gpos[i].w*W0;
+		float temp2 = temp1/rho[i];
+		for (const uint j : m_list.neibs(i)) {
+			if (!contributes(j))
+				continue;
+			const float r2 = sqlength(relpos(i, j));
+			if (r2 >= r2max)
+				continue;
+			const float w = kernel.W(r2)*gpos[j].w;
+			temp1 += w;
+			temp2 += w/rho[j];
+		}
+
+		v.w = m_problem->numerical_density(temp1/temp2, fluid_num(info[i]));
+		newVel[i] = v;
+	};
+
+	parallel_jobs(numBatches, [&](size_t batch_index) {
+		const uint first = batch_index*HOST_FILTER_BATCH;
+		const uint count = min<uint>(HOST_FILTER_BATCH, particleRangeEnd - first);
+
+		if (!mls) {
+			for (uint i = first; i < first + count; ++i)
+				shepard(i);
+			return;
+		}
+
+		mls_batch batch;
+		typedef mls_batch B;
+
+		// MLS matrices of the batch, with relative positions scaled
+		// by slength for stability and resolution independence
+		for (uint l = 0; l < count; ++l) {
+			const uint i = first + l;
+			float mm[B::COMPONENTS] = { 0 };
+			if (INACTIVE(gpos[i])) {
+				// solved but unused
+				mm[B::XX] = mm[B::YY] = mm[B::ZZ] = mm[B::WW] = 1;
+			} else {
+				// self contribution
+				mm[B::XX] = W0*gpos[i].w/rho[i];
+				for (const uint j : m_list.neibs(i)) {
+					if (!contributes(j))
+						continue;
+					const float3 relPos = relpos(i, j);
+					const float r2 = sqlength(relPos);
+					if (r2 >= r2max)
+						continue;
+					const float w = kernel.W(r2)*gpos[j].w/rho[j];
+					const float3 s = relPos/slength;
+					mm[B::XX] += w;
+					mm[B::XY] += s.x*w;
+					mm[B::XZ] += s.y*w;
+					mm[B::XW] += s.z*w;
+					mm[B::YY] += s.x*s.x*w;
+					mm[B::YZ] += s.x*s.y*w;
+					mm[B::YW] += s.x*s.z*w;
+					mm[B::ZZ] += s.y*s.y*w;
+					mm[B::ZW] += s.y*s.z*w;
+					mm[B::WW] += s.z*s.z*w;
+				}
+			}
+			for (uint c = 0; c < B::COMPONENTS; ++c)
+				batch.m[c][l] = mm[c];
+		}
+
+		mls_solve(batch, count);
+
+		// corrected density
+		for (uint l = 0; l < count; ++l) {
+			const uint i = first + l;
+			float4 v = vel[i];
+			if (INACTIVE(gpos[i])) {
+				newVel[i] = v;
+				continue;
+			}
+
+			// scale back for resolution independence
+			const float b0 = batch.b[0][l];
+			const float b1 = batch.b[1][l]/slength;
+			const float b2 = batch.b[2][l]/slength;
+			const float b3 = batch.b[3][l]/slength;
+
+			// self contribution
+			float dens = b0*W0*gpos[i].w;
+			for (const uint j : m_list.neibs(i)) {
+				if (!contributes(j))
+					continue;
+				const float3 relPos = relpos(i, j);
+				const float r2 = sqlength(relPos);
+				if (r2 >= r2max)
+					continue;
+				const float w = kernel.W(r2)*gpos[j].w;
+				dens += (b0 + b1*relPos.x + b2*relPos.y + b3*relPos.z)*w;
+			}
+
+			v.w = m_problem->numerical_density(dens, fluid_num(info[i]));
+			newVel[i] = v;
+		}
+	});
+}
+
+void
+HostFilterEngine::process(
+	const	BufferList& bufread,
+			BufferList& bufwrite,
+			uint	numParticles,
+			uint	particleRangeEnd,
+			float	slength,
+			float	influenceradius)
+{
+	const double4 *gpos = bufread.getData<BUFFER_POS_GLOBAL>();
+	const float4 *vel = bufread.getData<BUFFER_VEL>();
+	const particleinfo *info = bufread.getData<BUFFER_INFO>();
+	float4 *newVel = bufwrite.getData<BUFFER_VEL>();
+
+	m_list.build(gpos, info, numParticles, influenceradius);
+
+	switch (m_problem->simparams()->kerneltype) {
+	case CUBICSPLINE:
+		process_kernel<CUBICSPLINE>(gpos, vel, info, newVel, particleRangeEnd, slength, influenceradius);
+		break;
+	case QUADRATIC:
+		process_kernel<QUADRATIC>(gpos, vel, info, newVel, particleRangeEnd, slength, influenceradius);
+		break;
+	case WENDLAND:
+		process_kernel<WENDLAND>(gpos, vel, info, newVel, particleRangeEnd, slength, influenceradius);
+		break;
+	case GAUSSIAN:
+		process_kernel<GAUSSIAN>(gpos, vel, info, newVel, particleRangeEnd, slength, influenceradius);
+		break;
+	default:
+		throw invalid_argument("unsupported kernel for host filtering");
+	}
+}
@@ -0,0 +1,87 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Density filters (Shepard, MLS) on host
+ */
+
+#ifndef _HOST_FILTERS_H
+#define _HOST_FILTERS_H
+
+#include "engine_filter.h"
+#include "host_neibs.h"
+
+class ProblemCore;
+
+//! Host implementation of the Shepard and MLS density filters
+/*! This is the host counterpart of the CUDA filter engines, with the same
+ * treatment of the particle types: only fluid particles are filtered
+ * by Shepard, all particles by MLS, and boundary particles only contribute
+ * with DYN_BOUNDARY.
+ *
+ * The filter reads BUFFER_POS_GLOBAL, BUFFER_VEL and BUFFER_INFO,
+ * and writes BUFFER_VEL. The neighbors are searched by the engine itself,
+ * with a HostNeibsList that is kept across calls.
+ *
+ * MLS is processed in batches of particles: the moment matrices of a batch
+ * are accumulated in structure-of-arrays form, and then solved together,
+ * so that the solution is vectorized across the particles of the batch.
+ */
+class HostFilterEngine : public AbstractFilterEngine
+{
+	const ProblemCore	*m_problem;
+	FilterType			m_filtertype;
+	HostNeibsList		m_list;
+
+	template<KernelType kerneltype>
+	void process_kernel(
+		const	double4			*gpos,
+		const	float4			*vel,
+		const	particleinfo	*info,
+				float4			*newVel,
+				uint			particleRangeEnd,
+				float			slength,
+				float			influenceradius) const;
+
+public:
+	HostFilterEngine(FilterType filtertype, uint frequency, const ProblemCore *problem);
+
+	void setconstants() {} // nothing to do on host
+	void getconstants() {} // nothing to do on host
+
+	void
+	process(
+		const	BufferList& bufread,
+				BufferList& bufwrite,
+				uint	numParticles,
+				uint	particleRangeEnd,
+				float	slength,
+				float	influenceradius);
+};
+
+#endif
@@ -0,0 +1,213 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the host SPH forces
+ */
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "host_forces.h"
+#include "ProblemCore.h"
+#include "vector_math.h"
+
+using namespace std;
+
+HostForces::HostForces(const ProblemCore *problem, bool tabulated) :
+	m_problem(problem),
+	m_kerneltype(problem->simparams()->kerneltype),
+	m_slength(problem->simparams()->slength),
+	m_influenceradius(problem->simparams()->influenceRadius),
+	m_kernelradius(problem->simparams()->kernelradius),
+	m_visccoeff(problem->physparams()->artvisccoeff),
+	m_epsartvisc(problem->physparams()->epsartvisc),
+	m_gravity(problem->physparams()->gravity),
+	m_table()
+{
+	// the kernel table, unless the analytic kernel was requested
+	switch (m_kerneltype) {
+#define TABULATE(kerneltype) case kerneltype: \
+		if (tabulated) \
+			m_table.reset(new KernelTable<kerneltype>(m_slength, m_influenceradius, m_kernelradius)); \
+		break
+	TABULATE(CUBICSPLINE);
+	TABULATE(QUADRATIC);
+	TABULATE(WENDLAND);
+	TABULATE(GAUSSIAN);
+#undef TABULATE
+	default:
+		throw invalid_argument("unsupported kernel for host forces");
+	}
+
+	if (isnan(m_epsartvisc))
+		m_epsartvisc = 0.01f*m_slength*m_slength;
+}
+
+template<typename Kernel>
+void
+HostForces::compute(Kernel const& kernel, HostNeibsList const& list,
+	const	double4			*gpos,
+	const	float4			*vel,
+	const	particleinfo	*info,
+			float4			*forces,
+			float4			*xsph,
+			float			*cfl) const
+{
+	const float r2max = m_influenceradius*m_influenceradius;
+	const uint numParticles = list.num_particles();
+	const PhysParams *pp = m_problem->physparams();
+
+	// per-particle physical density, pressure term P/rho^2 and sound speed
+	vector<float> rho(numParticles), prho2(numParticles), csound(numParticles);
+	for (uint i = 0; i < numParticles; ++i) {
+		const int fnum = fluid_num(info[i]);
+		rho[i] = m_problem->physical_density(vel[i].w, fnum);
+		prho2[i] = m_problem->pressure(vel[i].w, fnum)/(rho[i]*rho[i]);
+		csound[i] = m_problem->soundspeed(vel[i].w, fnum);
+		forces[i] = make_float4(0.0f);
+		if (xsph)
+			xsph[i] = make_float4(0.0f);
+	}
+
+	const bool half = (list.mode() == HostNeibsList::HALF_LIST);
+
+	auto interact = [&](uint a) {
+		const float4 va = vel[a];
+		const bool fluid_a = FLUID(info[a]);
+		const float ma = gpos[a].w;
+		const float rho0a = pp->rho0[fluid_num(info[a])];
+
+		for (const uint b : list.neibs(a)) {
+			const bool fluid_b = FLUID(info[b]);
+			if (!fluid_a && !fluid_b)
+				continue;
+
+			const float3 relPos = make_float3(
+				gpos[a].x - gpos[b].x, gpos[a].y - gpos[b].y, gpos[a].z - gpos[b].z);
+			const float r2 = sqlength(relPos);
+			if (r2 >= r2max || r2 == 0)
+				continue;
+
+			const float4 vb = vel[b];
+			const float mb = gpos[b].w;
+			const float3 relVel = as_float3(va) - as_float3(vb);
+			const float vdotr = dot(relVel, relPos);
+			const float f = kernel.F(r2);
+
+			// pressure and artificial viscosity
+			float pterm = prho2[a] + prho2[b];
+			if (vdotr < 0) {
+				const float mu = m_slength*vdotr/(r2 + m_epsartvisc);
+				pterm -= m_visccoeff*(csound[a] + csound[b])*mu/(rho[a] + rho[b]);
+			}
+			const float3 grad = pterm*f*relPos;
+
+			if (fluid_a)
+				as_float3(forces[a]) -= mb*grad;
+			forces[a].w += mb*vdotr*f/rho0a;
+
+			float w = 0;
+			if (xsph) {
+				w = kernel.W(r2)*2/(rho[a] + rho[b]);
+				if (fluid_a)
+					as_float3(xsph[a]) -= mb*w*relVel;
+			}
+
+			if (!half)
+				continue;
+
+			// accumulate the symmetric contribution to the neighbor
+			if (fluid_b)
+				as_float3(forces[b]) += ma*grad;
+			forces[b].w += ma*vdotr*f/pp->rho0[fluid_num(info[b])];
+			if (xsph && fluid_b)
+				as_float3(xsph[b]) += ma*w*relVel;
+		}
+	};
+
+	if (half)
+		list.for_each_colored(interact);
+	else
+		list.for_each(interact);
+
+	for (uint i = 0; i < numParticles; ++i)
+		if (FLUID(info[i]) && ACTIVE(gpos[i]))
+			as_float3(forces[i]) += m_gravity;
+
+	// CFL condition, as stored by the device forces kernel
+	if (cfl)
+		for (uint i = 0; i < numParticles; ++i)
+			cfl[i] = fmaxf(length(as_float3(forces[i])), csound[i]*csound[i]/m_slength);
+}
+
+template<KernelType kerneltype>
+void
+HostForces::compute_kernel(HostNeibsList const& list,
+	const	double4			*gpos,
+	const	float4			*vel,
+	const	particleinfo	*info,
+			float4			*forces,
+			float4			*xsph,
+			float			*cfl) const
+{
+	if (m_table)
+		compute(static_cast<const KernelTable<kerneltype>&>(*m_table),
+			list, gpos, vel, info, forces, xsph, cfl);
+	else
+		compute(AnalyticKernel<kerneltype>(m_slength, m_kernelradius),
+			list, gpos, vel, info, forces, xsph, cfl);
+}
+
+void
+HostForces::compute(HostNeibsList const& list,
+	const	double4			*gpos,
+	const	float4			*vel,
+	const	particleinfo	*info,
+			float4			*forces,
+			float4			*xsph,
+			float			*cfl) const
+{
+	switch (m_kerneltype) {
+	case CUBICSPLINE:
+		compute_kernel<CUBICSPLINE>(list, gpos, vel, info, forces, xsph, cfl);
+		break;
+	case QUADRATIC:
+		compute_kernel<QUADRATIC>(list, gpos, vel, info, forces, xsph, cfl);
+		break;
+	case WENDLAND:
+		compute_kernel<WENDLAND>(list, gpos, vel, info, forces, xsph, cfl);
+		break;
+	case GAUSSIAN:
+		compute_kernel<GAUSSIAN>(list, gpos, vel, info, forces, xsph, cfl);
+		break;
+	default:
+		break;
+	}
+}
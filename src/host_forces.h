@@ -0,0 +1,118 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * SPH forces computation on host
+ */
+
+#ifndef _HOST_FORCES_H
+#define _HOST_FORCES_H
+
+#include <memory>
+
+#include "particledefine.h"
+#include "host_neibs.h"
+#include "kernel_table.h"
+
+class ProblemCore;
+
+//! Weakly-compressible SPH interaction on host
+/*! Computes, for each fluid particle, the acceleration due to the pressure
+ * gradient, artificial viscosity and gravity, the density derivative
+ * for all particles, and optionally the XSPH velocity correction,
+ * on a HostNeibsList.
+ *
+ * With a HALF_LIST each pair is evaluated once and its contribution
+ * is accumulated to both particles, traversing the particles by cell color;
+ * with a FULL_LIST each particle only accumulates its own contribution,
+ * as on device. Both give the same result up to the summation order.
+ *
+ * As on device with dynamic boundaries, boundary particles do not
+ * interact with each other, and are not accelerated.
+ *
+ * Buffer data is as on device, except for the positions, which are the
+ * global ones (BUFFER_POS_GLOBAL).
+ *
+ * The kernel is evaluated from a KernelTable, unless the analytic kernel
+ * is requested at construction.
+ */
+class HostForces
+{
+	const ProblemCore	*m_problem;
+
+	KernelType	m_kerneltype;
+	float		m_slength;
+	float		m_influenceradius;
+	float		m_kernelradius;
+	float		m_visccoeff;
+	float		m_epsartvisc;
+	float3		m_gravity;
+
+	//! Kernel table (of type KernelTable<m_kerneltype>), NULL for the analytic kernel
+	std::unique_ptr<KernelTableBase>	m_table;
+
+	//! Compute with the given kernel type, tabulated or analytic
+	template<KernelType kerneltype>
+	void compute_kernel(HostNeibsList const& list,
+		const	double4			*gpos,
+		const	float4			*vel,
+		const	particleinfo	*info,
+				float4			*forces,
+				float4			*xsph,
+				float			*cfl) const;
+
+	//! Compute with the given kernel, providing W(r2) and F(r2)
+	template<typename Kernel>
+	void compute(Kernel const& kernel, HostNeibsList const& list,
+		const	double4			*gpos,
+		const	float4			*vel,
+		const	particleinfo	*info,
+				float4			*forces,
+				float4			*xsph,
+				float			*cfl) const;
+
+public:
+	HostForces(const ProblemCore *problem, bool tabulated = true);
+
+	//! Compute the forces and density derivatives
+	/*! forces is (acceleration, density derivative), with the density derivative
+	 * of the numerical density (as stored in vel.w); xsph can be NULL.
+	 * If cfl is not NULL, it is filled with the per-particle CFL values,
+	 * as used by the time-step reduction (see HostDtReduce).
+	 * forces, xsph and cfl are overwritten for all numParticles particles.
+	 */
+	void compute(HostNeibsList const& list,
+		const	double4			*gpos,
+		const	float4			*vel,
+		const	particleinfo	*info,
+				float4			*forces,
+				float4			*xsph,
+				float			*cfl = NULL) const;
+};
+
+#endif
@@ -0,0 +1,352 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the host-side neighbors search
+ */
+
+#include <cmath>
+#include <stdexcept>
+
+#include "host_neibs.h"
+#include "parallel_jobs.h"
+
+using namespace std;
+
+//! Number of slots (or cells) handed to each parallel job
+#define HOST_NEIBS_CHUNK 1024
+
+HostNeibsList::HostNeibsList(Mode mode, Storage storage) :
+	m_mode(mode),
+	m_storage(storage),
+	m_radius(0),
+	m_origin(make_double3(0, 0, 0)),
+	m_gridSize(make_int3(0, 0, 0)),
+	m_cellSize(0),
+	m_cellStart(),
+	m_slotPart(),
+	m_partSlot(),
+	m_rowStart(),
+	m_neibs(),
+	m_packed(),
+	m_numEntries(0)
+{}
+
+void
+HostNeibsList::build(const double4 *gpos, const particleinfo *info, uint numParticles, double radius)
+{
+	if (!(radius > 0))
+		throw invalid_argument("host neighbors search radius must be positive");
+
+	m_radius = radius;
+	bin_particles(gpos, info, numParticles);
+	search(gpos);
+}
+
+void
+HostNeibsList::bin_particles(const double4 *gpos, const particleinfo *info, uint numParticles)
+{
+	m_partSlot.assign(numParticles, UINT_MAX);
+
+	// bounding box of the particles in the search
+	double3 bmin = make_double3(INFINITY, INFINITY, INFINITY);
+	double3 bmax = make_double3(-INFINITY, -INFINITY, -INFINITY);
+	uint numSearch = 0;
+	for (uint i = 0; i < numParticles; ++i) {
+		if (INACTIVE(gpos[i]) || TESTPOINT(info[i]))
+			continue;
+		bmin.x = fmin(bmin.x, gpos[i].x); bmax.x = fmax(bmax.x, gpos[i].x);
+		bmin.y = fmin(bmin.y, gpos[i].y); bmax.y = fmax(bmax.y, gpos[i].y);
+		bmin.z = fmin(bmin.z, gpos[i].z); bmax.z = fmax(bmax.z, gpos[i].z);
+		++numSearch;
+	}
+
+	if (numSearch == 0)
+		bmin = bmax = make_double3(0, 0, 0);
+
+	m_cellSize = m_radius;
+	m_origin = bmin;
+	m_gridSize.x = int(floor((bmax.x - bmin.x)/m_cellSize)) + 1;
+	m_gridSize.y = int(floor((bmax.y - bmin.y)/m_cellSize)) + 1;
+	m_gridSize.z = int(floor((bmax.z - bmin.z)/m_cellSize)) + 1;
+
+	const double numCells = double(m_gridSize.x)*m_gridSize.y*m_gridSize.z;
+	if (numCells > (1U << 28))
+		throw runtime_error("host neighbors search grid too large, search radius too small?");
+
+	const uint nCells = uint(numCells);
+
+	// counting sort of the particles by cell
+	vector<uint> cell(numParticles, UINT_MAX);
+	m_cellStart.assign(nCells + 1, 0);
+	for (uint i = 0; i < numParticles; ++i) {
+		if (INACTIVE(gpos[i]) || TESTPOINT(info[i]))
+			continue;
+		int cx = min(int((gpos[i].x - m_origin.x)/m_cellSize), m_gridSize.x - 1);
+		int cy = min(int((gpos[i].y - m_origin.y)/m_cellSize), m_gridSize.y - 1);
+		int cz = min(int((gpos[i].z - m_origin.z)/m_cellSize), m_gridSize.z - 1);
+		cell[i] = cx + m_gridSize.x*(cy + m_gridSize.y*cz);
+		++m_cellStart[cell[i] + 1];
+	}
+	for (uint c = 0; c < nCells; ++c)
+		m_cellStart[c + 1] += m_cellStart[c];
+
+	m_slotPart.resize(numSearch);
+	vector<uint> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (uint i = 0; i < numParticles; ++i) {
+		if (cell[i] == UINT_MAX)
+			continue;
+		const uint slot = fill[cell[i]]++;
+		m_slotPart[slot] = i;
+		m_partSlot[i] = slot;
+	}
+
+	// cells of the same color are at least three cells apart along some direction
+	for (uint color = 0; color < 27; ++color)
+		m_colorCells[color].clear();
+	for (uint c = 0; c < nCells; ++c) {
+		if (m_cellStart[c] == m_cellStart[c + 1])
+			continue;
+		const int cx = c % m_gridSize.x;
+		const int cy = (c / m_gridSize.x) % m_gridSize.y;
+		const int cz = c / (m_gridSize.x*m_gridSize.y);
+		m_colorCells[cx % 3 + 3*(cy % 3) + 9*(cz % 3)].push_back(c);
+	}
+}
+
+void
+HostNeibsList::search(const double4 *gpos)
+{
+	const uint numSlots = m_slotPart.size();
+	const size_t numChunks = (numSlots + HOST_NEIBS_CHUNK - 1)/HOST_NEIBS_CHUNK;
+	const double sqradius = m_radius*m_radius;
+	const bool half = (m_mode == HALF_LIST);
+
+	// each chunk collects the neighbor slots of its slots independently,
+	// the rows are then encoded and concatenated
+	vector<vector<uint>> chunk_neibs(numChunks);
+	vector<size_t> chunk_entries(numChunks + 1, 0);
+	m_rowStart.assign(numSlots + 1, 0);
+
+	parallel_jobs(numChunks, [&](size_t chunk) {
+		const uint first = chunk*HOST_NEIBS_CHUNK;
+		const uint last = min(first + HOST_NEIBS_CHUNK, numSlots);
+		vector<uint> &neibs = chunk_neibs[chunk];
+
+		for (uint slot = first; slot < last; ++slot) {
+			const uint i = m_slotPart[slot];
+			const double4 pi = gpos[i];
+			const int cx = min(int((pi.x - m_origin.x)/m_cellSize), m_gridSize.x - 1);
+			const int cy = min(int((pi.y - m_origin.y)/m_cellSize), m_gridSize.y - 1);
+			const int cz = min(int((pi.z - m_origin.z)/m_cellSize), m_gridSize.z - 1);
+			const uint cell = cx + m_gridSize.x*(cy + m_gridSize.y*cz);
+			const size_t row = neibs.size();
+
+			for (int z = max(cz - 1, 0); z <= min(cz + 1, m_gridSize.z - 1); ++z)
+			for (int y = max(cy - 1, 0); y <= min(cy + 1, m_gridSize.y - 1); ++y)
+			for (int x = max(cx - 1, 0); x <= min(cx + 1, m_gridSize.x - 1); ++x) {
+				const uint neib_cell = x + m_gridSize.x*(y + m_gridSize.y*z);
+				// in half mode, pairs are stored under the particle with the lower slot,
+				// and the slots of the previous cells all come before ours
+				if (half && neib_cell < cell)
+					continue;
+				for (uint nslot = m_cellStart[neib_cell]; nslot < m_cellStart[neib_cell + 1]; ++nslot) {
+					if (half ? nslot <= slot : nslot == slot)
+						continue;
+					const uint j = m_slotPart[nslot];
+					const double dx = pi.x - gpos[j].x;
+					const double dy = pi.y - gpos[j].y;
+					const double dz = pi.z - gpos[j].z;
+					if (dx*dx + dy*dy + dz*dz < sqradius)
+						neibs.push_back(nslot);
+				}
+			}
+			m_rowStart[slot + 1] = neibs.size() - row;
+		}
+		chunk_entries[chunk + 1] = neibs.size();
+	});
+
+	for (size_t chunk = 0; chunk < numChunks; ++chunk)
+		chunk_entries[chunk + 1] += chunk_entries[chunk];
+	m_numEntries = chunk_entries[numChunks];
+
+	if (m_storage == PLAIN_STORAGE) {
+		m_packed.clear();
+		m_packed.shrink_to_fit();
+
+		for (uint slot = 0; slot < numSlots; ++slot)
+			m_rowStart[slot + 1] += m_rowStart[slot];
+
+		m_neibs.resize(m_numEntries);
+		parallel_jobs(numChunks, [&](size_t chunk) {
+			uint *dst = m_neibs.data() + chunk_entries[chunk];
+			for (uint nslot : chunk_neibs[chunk])
+				*dst++ = m_slotPart[nslot];
+		});
+		return;
+	}
+
+	m_neibs.clear();
+	m_neibs.shrink_to_fit();
+
+	// encode the rows of each chunk, turning the entry counts into byte counts
+	vector<vector<uint8_t>> chunk_packed(numChunks);
+	vector<size_t> chunk_bytes(numChunks + 1, 0);
+	parallel_jobs(numChunks, [&](size_t chunk) {
+		const uint first = chunk*HOST_NEIBS_CHUNK;
+		const uint last = min(first + HOST_NEIBS_CHUNK, numSlots);
+		vector<uint> &neibs = chunk_neibs[chunk];
+		vector<uint8_t> &packed = chunk_packed[chunk];
+		packed.reserve(neibs.size() + neibs.size()/4);
+
+		size_t entry = 0;
+		for (uint slot = first; slot < last; ++slot) {
+			const size_t row_entries = m_rowStart[slot + 1];
+			const size_t row_start = packed.size();
+			uint prev = slot;
+			for (size_t n = 0; n < row_entries; ++n, ++entry) {
+				const int diff = int(neibs[entry] - prev);
+				uint delta = (uint(diff) << 1) ^ uint(diff >> 31);
+				prev = neibs[entry];
+				while (delta >= 0x80) {
+					packed.push_back(uint8_t(delta | 0x80));
+					delta >>= 7;
+				}
+				packed.push_back(uint8_t(delta));
+			}
+			m_rowStart[slot + 1] = packed.size() - row_start;
+		}
+		chunk_bytes[chunk + 1] = packed.size();
+		vector<uint>().swap(neibs);
+	});
+
+	for (uint slot = 0; slot < numSlots; ++slot)
+		m_rowStart[slot + 1] += m_rowStart[slot];
+	for (size_t chunk = 0; chunk < numChunks; ++chunk)
+		chunk_bytes[chunk + 1] += chunk_bytes[chunk];
+
+	m_packed.resize(chunk_bytes[numChunks]);
+	parallel_jobs(numChunks, [&](size_t chunk) {
+		copy(chunk_packed[chunk].begin(), chunk_packed[chunk].end(),
+			m_packed.begin() + chunk_bytes[chunk]);
+	});
+}
+
+uint
+HostNeibsList::num_neibs(uint i) const
+{
+	const uint slot = m_partSlot[i];
+	if (slot == UINT_MAX)
+		return 0;
+	if (m_storage == PLAIN_STORAGE)
+		return m_rowStart[slot + 1] - m_rowStart[slot];
+
+	// every byte without the continuation bit ends an entry
+	uint count = 0;
+	for (size_t b = m_rowStart[slot]; b < m_rowStart[slot + 1]; ++b)
+		count += !(m_packed[b] & 0x80);
+	return count;
+}
+
+void
+HostNeibsList::find_near(const double4 *gpos, double3 const& point, vector<uint> &result) const
+{
+	result.clear();
+	if (m_slotPart.empty())
+		return;
+
+	const double sqradius = m_radius*m_radius;
+
+	// the point may lie outside of the grid, only the cells within
+	// one cell from it can hold particles within the radius
+	const double cx = floor((point.x - m_origin.x)/m_cellSize);
+	const double cy = floor((point.y - m_origin.y)/m_cellSize);
+	const double cz = floor((point.z - m_origin.z)/m_cellSize);
+	const int xmin = int(fmax(cx - 1, 0)), xmax = int(fmin(cx + 1, m_gridSize.x - 1));
+	const int ymin = int(fmax(cy - 1, 0)), ymax = int(fmin(cy + 1, m_gridSize.y - 1));
+	const int zmin = int(fmax(cz - 1, 0)), zmax = int(fmin(cz + 1, m_gridSize.z - 1));
+
+	for (int z = zmin; z <= zmax; ++z)
+	for (int y = ymin; y <= ymax; ++y)
+	for (int x = xmin; x <= xmax; ++x) {
+		const uint cell = x + m_gridSize.x*(y + m_gridSize.y*z);
+		for (uint slot = m_cellStart[cell]; slot < m_cellStart[cell + 1]; ++slot) {
+			const uint j = m_slotPart[slot];
+			const double dx = point.x - gpos[j].x;
+			const double dy = point.y - gpos[j].y;
+			const double dz = point.z - gpos[j].z;
+			if (dx*dx + dy*dy + dz*dz < sqradius)
+				result.push_back(j);
+		}
+	}
+}
+
+size_t
+HostNeibsList::memory() const
+{
+	size_t bytes = (m_cellStart.capacity() + m_slotPart.capacity() +
+		m_partSlot.capacity() + m_neibs.capacity())*sizeof(uint) +
+		m_rowStart.capacity()*sizeof(size_t) + m_packed.capacity();
+	for (uint color = 0; color < 27; ++color)
+		bytes += m_colorCells[color].capacity()*sizeof(uint);
+	return bytes;
+}
+
+void
+HostNeibsList::for_each(function<void(uint)> const& job) const
+{
+	const uint numSlots = m_slotPart.size();
+	const size_t numChunks = (numSlots + HOST_NEIBS_CHUNK - 1)/HOST_NEIBS_CHUNK;
+
+	parallel_jobs(numChunks, [&](size_t chunk) {
+		const uint first = chunk*HOST_NEIBS_CHUNK;
+		const uint last = min(first + HOST_NEIBS_CHUNK, numSlots);
+		for (uint slot = first; slot < last; ++slot)
+			job(m_slotPart[slot]);
+	});
+}
+
+void
+HostNeibsList::for_each_colored(function<void(uint)> const& job) const
+{
+	// cells are much smaller work units than slots
+	static const uint cells_per_job = HOST_NEIBS_CHUNK/64;
+
+	for (uint color = 0; color < 27; ++color) {
+		vector<uint> const& cells = m_colorCells[color];
+		const size_t numJobs = (cells.size() + cells_per_job - 1)/cells_per_job;
+
+		parallel_jobs(numJobs, [&](size_t j) {
+			const size_t first = j*cells_per_job;
+			const size_t last = min(first + cells_per_job, cells.size());
+			for (size_t c = first; c < last; ++c)
+				for (uint slot = m_cellStart[cells[c]]; slot < m_cellStart[cells[c] + 1]; ++slot)
+					job(m_slotPart[slot]);
+		});
+	}
+}
@@ -0,0 +1,247 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Neighbors search for host-side computations
+ */
+
+#ifndef _HOST_NEIBS_H
+#define _HOST_NEIBS_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "particleinfo.h"
+
+//! Neighbors list for host-side computations
+/*! The list is built from the global particle positions, on a cell grid
+ * with cells as large as the search radius. It is stored in compressed rows:
+ * the neighbors of each particle are contiguous, with the rows in cell order.
+ *
+ * In FULL mode each interaction is stored twice (i→j and j→i), as in the
+ * device neighbors list. In HALF mode each pair is stored once, under the
+ * particle that comes first in cell order, which halves both the list
+ * memory and the number of pair evaluations, at the cost of having to
+ * accumulate the result of each evaluation to both particles. To do this
+ * without locks, for_each_colored() processes the cells in 27 colors, such
+ * that cells of the same color never share a neighboring cell.
+ *
+ * Rows can be stored either as plain particle indices, or packed: the
+ * neighbors in each row are found in increasing cell order, and within each
+ * cell in increasing slot order, so each row is stored as the variable-length
+ * (7 bits per byte) encoding of the differences between consecutive slots,
+ * the first one relative to the slot of the particle itself. Most differences
+ * are between particles in the same cell and take a single byte.
+ * Rows are traversed with neibs() in both cases.
+ *
+ * Inactive particles and testpoints are not included in the search,
+ * and have no neighbors; the particles around them (or around any other
+ * point) can be found with find_near(). Periodic boundaries are not supported.
+ */
+class HostNeibsList
+{
+public:
+	enum Mode {
+		FULL_LIST, ///< each interaction is stored for both particles
+		HALF_LIST ///< each pair is stored once
+	};
+
+	enum Storage {
+		PLAIN_STORAGE, ///< rows of particle indices
+		PACKED_STORAGE ///< rows of variable-length slot differences
+	};
+
+	//! Iterator over the neighbors of a particle
+	class neib_iterator
+	{
+		const uint		*m_plain; ///< current entry, plain storage
+		const uint8_t	*m_packed; ///< encoding of the current entry, packed storage
+		const uint8_t	*m_next; ///< encoding of the next entry
+		const uint8_t	*m_end; ///< end of the row encoding
+		const uint		*m_slotPart;
+		uint			m_slot; ///< slot of the current entry
+
+		//! Decode the entry at m_packed
+		void decode()
+		{
+			if (m_packed == m_end)
+				return;
+			uint delta = 0;
+			uint shift = 0;
+			m_next = m_packed;
+			uint8_t byte;
+			do {
+				byte = *m_next++;
+				delta |= uint(byte & 0x7f) << shift;
+				shift += 7;
+			} while (byte & 0x80);
+			// zig-zag, only the first difference of a row can be negative
+			m_slot += (delta >> 1) ^ -(delta & 1);
+		}
+
+	public:
+		//! Iterator on plain storage
+		neib_iterator(const uint *plain) :
+			m_plain(plain), m_packed(NULL), m_next(NULL), m_end(NULL),
+			m_slotPart(NULL), m_slot(0)
+		{}
+
+		//! Iterator on packed storage, for the row of the given slot
+		neib_iterator(const uint8_t *packed, const uint8_t *end,
+			const uint *slotPart, uint slot) :
+			m_plain(NULL), m_packed(packed), m_next(packed), m_end(end),
+			m_slotPart(slotPart), m_slot(slot)
+		{ decode(); }
+
+		uint operator*() const
+		{ return m_plain ? *m_plain : m_slotPart[m_slot]; }
+
+		neib_iterator& operator++()
+		{
+			if (m_plain)
+				++m_plain;
+			else {
+				m_packed = m_next;
+				decode();
+			}
+			return *this;
+		}
+
+		bool operator!=(neib_iterator const& other) const
+		{ return m_plain ? m_plain != other.m_plain : m_packed != other.m_packed; }
+	};
+
+	//! Range of the neighbors of a particle, for range-based for loops
+	struct neib_range
+	{
+		neib_iterator	m_begin, m_end;
+
+		neib_iterator begin() const { return m_begin; }
+		neib_iterator end() const { return m_end; }
+	};
+
+private:
+	Mode				m_mode;
+	Storage				m_storage;
+	double				m_radius;
+
+	// search grid
+	double3				m_origin;
+	int3				m_gridSize;
+	double				m_cellSize;
+	//! first slot of each cell, in cell order
+	std::vector<uint>	m_cellStart;
+	//! particle in each slot
+	std::vector<uint>	m_slotPart;
+	//! slot of each particle, UINT_MAX for particles not in the search
+	std::vector<uint>	m_partSlot;
+	//! cells of each color, for for_each_colored()
+	std::vector<uint>	m_colorCells[27];
+
+	//! first neighbor of each slot (first byte, for packed storage)
+	std::vector<size_t>	m_rowStart;
+	//! neighbors (particle indices)
+	std::vector<uint>	m_neibs;
+	//! neighbors (packed storage)
+	std::vector<uint8_t>	m_packed;
+	//! number of stored neighbors
+	size_t				m_numEntries;
+
+	void bin_particles(const double4 *gpos, const particleinfo *info, uint numParticles);
+	void search(const double4 *gpos);
+
+public:
+	HostNeibsList(Mode mode = HALF_LIST, Storage storage = PLAIN_STORAGE);
+
+	//! Build the list of particles closer than radius
+	/*! gpos are the global positions, as in BUFFER_POS_GLOBAL
+	 */
+	void build(const double4 *gpos, const particleinfo *info, uint numParticles, double radius);
+
+	Mode mode() const
+	{ return m_mode; }
+
+	Storage storage() const
+	{ return m_storage; }
+
+	double radius() const
+	{ return m_radius; }
+
+	uint num_particles() const
+	{ return m_partSlot.size(); }
+
+	//! Number of stored neighbors, i.e. of pair evaluations needed to traverse the list
+	size_t num_entries() const
+	{ return m_numEntries; }
+
+	//! Number of neighbors of particle i
+	uint num_neibs(uint i) const;
+
+	//! Neighbors of particle i
+	neib_range neibs(uint i) const
+	{
+		const uint slot = m_partSlot[i];
+		if (m_storage == PLAIN_STORAGE) {
+			const uint *row = m_neibs.data() + (slot == UINT_MAX ? 0 : m_rowStart[slot]);
+			const uint *row_end = m_neibs.data() + (slot == UINT_MAX ? 0 : m_rowStart[slot + 1]);
+			return neib_range{ neib_iterator(row), neib_iterator(row_end) };
+		}
+		const uint8_t *row = m_packed.data() + (slot == UINT_MAX ? 0 : m_rowStart[slot]);
+		const uint8_t *row_end = m_packed.data() + (slot == UINT_MAX ? 0 : m_rowStart[slot + 1]);
+		return neib_range{
+			neib_iterator(row, row_end, m_slotPart.data(), slot),
+			neib_iterator(row_end, row_end, NULL, slot) };
+	}
+
+	//! Find the particles in the search closer than the radius to the given point
+	/*! The point need not be a particle in the search (e.g. it can be a testpoint).
+	 * The particle indices are stored in result, which is cleared first.
+	 * gpos must be the global positions the list was built from
+	 */
+	void find_near(const double4 *gpos, double3 const& point, std::vector<uint> &result) const;
+
+	//! Host memory used by the list, in bytes
+	size_t memory() const;
+
+	//! Run job on all the particles in the search, in parallel
+	/*! job is called at most once per particle, possibly concurrently
+	 */
+	void for_each(std::function<void(uint)> const& job) const;
+
+	//! Run job on all the particles in the search, in parallel, by cell color
+	/*! job is called at most once per particle, and two concurrent calls
+	 * never have neighbors in common, so job can safely update both the
+	 * particle and its neighbors
+	 */
+	void for_each_colored(std::function<void(uint)> const& job) const;
+};
+
+#endif
@@ -0,0 +1,485 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the host post-processing engines
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "host_post_process.h"
+#include "kernel_table.h"
+#include "parallel_jobs.h"
+#include "GlobalData.h"
+
+using namespace std;
+
+//! Number of particles processed by each parallel job
+#define HOST_POST_PROCESS_CHUNK 1024
+
+namespace {
+
+//! Run job(first, last) over the particles in [0, count), in parallel chunks
+template<typename Job>
+static void
+for_each_chunk(uint count, Job const& job)
+{
+	parallel_jobs((count + HOST_POST_PROCESS_CHUNK - 1)/HOST_POST_PROCESS_CHUNK, [&](size_t chunk) {
+		const uint first = chunk*HOST_POST_PROCESS_CHUNK;
+		job(first, min<uint>(first + HOST_POST_PROCESS_CHUNK, count));
+	});
+}
+
+//! Volume (mass over physical density) of the given particles
+static vector<float>
+volumes(const ProblemCore *problem, const double4 *gpos, const float4 *vel,
+	const particleinfo *info, uint count)
+{
+	vector<float> vol(count);
+	for_each_chunk(count, [&](uint first, uint last) {
+		for (uint i = first; i < last; ++i)
+			vol[i] = gpos[i].w/problem->physical_density(vel[i].w, fluid_num(info[i]));
+	});
+	return vol;
+}
+
+static inline float3
+relpos(double4 const& pi, double4 const& pj)
+{
+	return make_float3(pi.x - pj.x, pi.y - pj.y, pi.z - pj.z);
+}
+
+}
+
+HostPostProcessEngine::HostPostProcessEngine(PostProcessType pptype, flag_t options,
+	const ProblemCore *problem) :
+	AbstractPostProcessEngine(options),
+	m_problem(problem),
+	m_pptype(pptype),
+	m_list(HostNeibsList::FULL_LIST),
+	m_flux()
+{
+	const SimParams *simparams = problem->simparams();
+
+	switch (pptype) {
+	case VORTICITY:
+	case TESTPOINTS:
+	case FLUX_COMPUTATION:
+		break;
+	case SURFACE_DETECTION:
+	case INTERFACE_DETECTION:
+		if (simparams->boundarytype == SA_BOUNDARY)
+			throw invalid_argument("host surface detection does not support SA_BOUNDARY");
+		if (simparams->simflags & ENABLE_PLANES)
+			throw invalid_argument("host surface detection does not support planes");
+		break;
+	default:
+		throw invalid_argument("unsupported post-processing for host processing");
+	}
+}
+
+flag_t
+HostPostProcessEngine::get_written_buffers() const
+{
+	switch (m_pptype) {
+	case VORTICITY:
+		return BUFFER_VORTICITY;
+	case SURFACE_DETECTION:
+	case INTERFACE_DETECTION:
+		return (m_options & BUFFER_NORMALS);
+	default:
+		return NO_FLAGS;
+	}
+}
+
+flag_t
+HostPostProcessEngine::get_updated_buffers() const
+{
+	switch (m_pptype) {
+	case TESTPOINTS:
+		return BUFFER_VEL | BUFFER_TKE | BUFFER_EPSILON;
+	case SURFACE_DETECTION:
+	case INTERFACE_DETECTION:
+		return BUFFER_INFO;
+	default:
+		return NO_FLAGS;
+	}
+}
+
+template<KernelType kerneltype>
+void
+HostPostProcessEngine::vorticity(
+	const	BufferList&	bufread,
+			BufferList&	bufwrite,
+			uint		particleRangeEnd) const
+{
+	const double4 *gpos = bufread.getData<BUFFER_POS_GLOBAL>();
+	const float4 *vel = bufread.getData<BUFFER_VEL>();
+	const particleinfo *info = bufread.getData<BUFFER_INFO>();
+	BufferTraits<BUFFER_VORTICITY>::element_type *vort = bufwrite.getData<BUFFER_VORTICITY>();
+
+	const SimParams *simparams = m_problem->simparams();
+	const AnalyticKernel<kerneltype> kernel(simparams->slength, simparams->kernelradius);
+	const float r2max = simparams->influenceRadius*simparams->influenceRadius;
+	const vector<float> vol = volumes(m_problem, gpos, vel, info, m_list.num_particles());
+
+	for_each_chunk(particleRangeEnd, [&](uint first, uint last) {
+		for (uint i = first; i < last; ++i) {
+			// computing vorticity only for active fluid particles
+			if (NOT_FLUID(info[i]) || INACTIVE(gpos[i])) {
+				store_element<BUFFER_VORTICITY>(vort[i], make_float3(NAN));
+				continue;
+			}
+
+			float3 v = make_float3(0.0f);
+			for (const uint j : m_list.neibs(i)) {
+				if (NOT_FLUID(info[j]))
+					continue;
+				const float3 relPos = relpos(gpos[i], gpos[j]);
+				const float r2 = sqlength(relPos);
+				if (r2 >= r2max)
+					continue;
+				const float3 relVel = as_float3(vel[i]) - as_float3(vel[j]);
+				// ∂Wij/∂r*Vj
+				const float f = kernel.F(r2)*vol[j];
+				v += f*cross(relVel, relPos);
+			}
+			store_element<BUFFER_VORTICITY>(vort[i], v);
+		}
+	});
+}
+
+template<KernelType kerneltype>
+void
+HostPostProcessEngine::surface_detection(
+	const	BufferList&	bufread,
+			BufferList&	bufwrite,
+			uint		particleRangeEnd) const
+{
+	const double4 *gpos = bufread.getData<BUFFER_POS_GLOBAL>();
+	const float4 *vel = bufread.getData<BUFFER_VEL>();
+	const particleinfo *info = bufread.getData<BUFFER_INFO>();
+	// updated in-place on device, so the write list may hold the same buffer
+	particleinfo *newInfo = bufwrite.getData<BUFFER_INFO,
+		BufferList::AccessSafety::MULTISTATE_SAFE>();
+	const bool savenormals = (m_options & BUFFER_NORMALS);
+	BufferTraits<BUFFER_NORMALS>::element_type *normals = savenormals ?
+		bufwrite.getData<BUFFER_NORMALS>() : NULL;
+
+	const SimParams *simparams = m_problem->simparams();
+	const PhysParams *physparams = m_problem->physparams();
+	const AnalyticKernel<kerneltype> kernel(simparams->slength, simparams->kernelradius);
+	const float W0 = kernel.W(0);
+	const float r2max = simparams->influenceRadius*simparams->influenceRadius;
+	const bool interface = (m_pptype == INTERFACE_DETECTION);
+
+	// the particle types are read while the flags are being updated
+	const uint numParticles = m_list.num_particles();
+	const vector<particleinfo> oldInfo(info, info + numParticles);
+	const vector<float> vol = volumes(m_problem, gpos, vel, info, numParticles);
+
+	// neighbors counting against the normal, as on device
+	auto cone_count = [&](uint i, float4 const& normal, bool same_phase_only) {
+		const float normal_length = length3(normal);
+		uint nc = 0;
+		for (const uint j : m_list.neibs(i)) {
+			if (same_phase_only && FLUID(oldInfo[j]) &&
+				fluid_num(oldInfo[j]) != fluid_num(oldInfo[i]))
+				continue;
+			const float3 relPos = relpos(gpos[i], gpos[j]);
+			const float r2 = sqlength(relPos);
+			if (r2 >= r2max)
+				continue;
+			const float cosconeangle = FLUID(oldInfo[j]) ?
+				physparams->cosconeanglefluid : physparams->cosconeanglenonfluid;
+			if (-dot3(normal, relPos) > sqrtf(r2)*normal_length*cosconeangle)
+				++nc;
+		}
+		return nc;
+	};
+
+	for_each_chunk(particleRangeEnd, [&](uint first, uint last) {
+		for (uint i = first; i < last; ++i) {
+			particleinfo pinfo = oldInfo[i];
+
+			if (NOT_FLUID(pinfo) || INACTIVE(gpos[i])) {
+				newInfo[i] = pinfo;
+				if (savenormals)
+					store_element<BUFFER_NORMALS>(normals[i], make_float4(NAN));
+				continue;
+			}
+
+			CLEAR_FLAG(pinfo, FG_SURFACE);
+			if (interface)
+				CLEAR_FLAG(pinfo, FG_INTERFACE);
+
+			// self contribution to normalization: W(0)*vol
+			float4 normal_fs = make_float4(0, 0, 0, W0*vol[i]);
+			float4 normal_if = normal_fs;
+
+			for (const uint j : m_list.neibs(i)) {
+				const float3 relPos = relpos(gpos[i], gpos[j]);
+				const float r2 = sqlength(relPos);
+				if (r2 >= r2max)
+					continue;
+				const float w = kernel.W(r2)*vol[j];
+				if (!interface) {
+					// 1/r ∂Wij/∂r Vj
+					as_float3(normal_fs) -= kernel.F(r2)*vol[j]*relPos;
+					normal_fs.w += w;
+					continue;
+				}
+				// as on device, the interface normals are scaled by the particle
+				// volume rather than the neighbor one
+				const float f = kernel.F(r2);
+				as_float3(normal_fs) -= f*relPos;
+				normal_fs.w += w;
+				if (fluid_num(pinfo) == fluid_num(oldInfo[j]) || NOT_FLUID(oldInfo[j])) {
+					as_float3(normal_if) -= f*relPos;
+					normal_if.w += w;
+				}
+			}
+
+			if (!interface) {
+				if (!cone_count(i, normal_fs, false))
+					SET_FLAG(pinfo, FG_SURFACE);
+				newInfo[i] = pinfo;
+				if (savenormals) {
+					as_float3(normal_fs) /= length3(normal_fs);
+					store_element<BUFFER_NORMALS>(normals[i], normal_fs);
+				}
+				continue;
+			}
+
+			as_float3(normal_fs) *= vol[i];
+			as_float3(normal_if) *= vol[i];
+
+			const uint nc_fs = cone_count(i, normal_fs, false);
+			const uint nc_if = cone_count(i, normal_if, true);
+			const bool at_interface = (!nc_if && nc_fs);
+
+			if (!nc_fs)
+				SET_FLAG(pinfo, FG_SURFACE);
+			if (at_interface)
+				SET_FLAG(pinfo, FG_INTERFACE);
+			newInfo[i] = pinfo;
+
+			if (savenormals) {
+				float4 &normal = at_interface ? normal_if : normal_fs;
+				as_float3(normal) /= length3(normal);
+				store_element<BUFFER_NORMALS>(normals[i], normal);
+			}
+		}
+	});
+}
+
+template<KernelType kerneltype>
+void
+HostPostProcessEngine::testpoints(
+	const	BufferList&	bufread,
+			BufferList&	bufwrite,
+			uint		particleRangeEnd) const
+{
+	const double4 *gpos = bufread.getData<BUFFER_POS_GLOBAL>();
+	const float4 *vel = bufread.getData<BUFFER_VEL>();
+	const particleinfo *info = bufread.getData<BUFFER_INFO>();
+	const float *tke = bufread.getData<BUFFER_TKE>();
+	const float *eps = bufread.getData<BUFFER_EPSILON>();
+	float4 *newVel = bufwrite.getData<BUFFER_VEL>();
+	float *newTke = bufwrite.getData<BUFFER_TKE>();
+	float *newEpsilon = bufwrite.getData<BUFFER_EPSILON>();
+
+	const SimParams *simparams = m_problem->simparams();
+	const AnalyticKernel<kerneltype> kernel(simparams->slength, simparams->kernelradius);
+	const bool sa_boundary = (simparams->boundarytype == SA_BOUNDARY);
+	const vector<float> vol = volumes(m_problem, gpos, vel, info, m_list.num_particles());
+
+	for_each_chunk(particleRangeEnd, [&](uint first, uint last) {
+		// testpoints are not in the neighbors list, so their neighbors are searched here
+		vector<uint> neibs;
+		for (uint i = first; i < last; ++i) {
+			if (!TESTPOINT(info[i]))
+				continue;
+
+			m_list.find_near(gpos, make_double3(gpos[i].x, gpos[i].y, gpos[i].z), neibs);
+
+			// velocity (x,y,z) and pressure (w)
+			float4 velavg = make_float4(0.0f);
+			float tkeavg = 0.0f;
+			float epsavg = 0.0f;
+			// Shepard filter sum(w_b w_{ab})
+			float alpha = 0.0f;
+
+			// FLUID and VERTEX neighbors (VERTEX only in SA case)
+			for (const uint j : neibs) {
+				if (!(FLUID(info[j]) || (sa_boundary && VERTEX(info[j]))))
+					continue;
+				const float r2 = sqlength(relpos(gpos[i], gpos[j]));
+				const float w = kernel.W(r2)*vol[j];
+				as_float3(velavg) += w*as_float3(vel[j]);
+				velavg.w += w*m_problem->pressure(vel[j].w, fluid_num(info[j]));
+				if (newTke)
+					tkeavg += w*tke[j];
+				if (newEpsilon)
+					epsavg += w*eps[j];
+				alpha += w;
+			}
+
+			// renormalization by the Shepard filter
+			if (alpha > 1e-5f) {
+				velavg /= alpha;
+				tkeavg /= alpha;
+				epsavg /= alpha;
+			} else {
+				velavg = make_float4(0.0f);
+				tkeavg = epsavg = 0.0f;
+			}
+
+			newVel[i] = velavg;
+			if (newTke)
+				newTke[i] = tkeavg;
+			if (newEpsilon)
+				newEpsilon[i] = epsavg;
+		}
+	});
+}
+
+void
+HostPostProcessEngine::flux_computation(
+	const	BufferList&	bufread,
+			uint		particleRangeEnd)
+{
+	const particleinfo *info = bufread.getData<BUFFER_INFO>();
+	const float4 *eulerVel = bufread.getData<BUFFER_EULERVEL>();
+	const float4 *boundElement = bufread.getData<BUFFER_BOUNDELEMENTS>();
+
+	const uint numOpenBoundaries = m_flux.size();
+	const size_t numChunks = (particleRangeEnd + HOST_POST_PROCESS_CHUNK - 1)/HOST_POST_PROCESS_CHUNK;
+
+	// per-chunk partial fluxes, summed in chunk order so that
+	// the result does not depend on the number of threads
+	vector<float> partial(numChunks*numOpenBoundaries, 0.0f);
+	for_each_chunk(particleRangeEnd, [&](uint first, uint last) {
+		float *chunk_flux = partial.data() + (first/HOST_POST_PROCESS_CHUNK)*numOpenBoundaries;
+		for (uint i = first; i < last; ++i) {
+			if (!(IO_BOUNDARY(info[i]) && BOUNDARY(info[i])))
+				continue;
+			const float4 normal = boundElement[i];
+			chunk_flux[object(info[i])] += normal.w*dot3(eulerVel[i], normal);
+		}
+	});
+
+	fill(m_flux.begin(), m_flux.end(), 0.0f);
+	for (size_t chunk = 0; chunk < numChunks; ++chunk)
+		for (uint ob = 0; ob < numOpenBoundaries; ++ob)
+			m_flux[ob] += partial[chunk*numOpenBoundaries + ob];
+}
+
+template<KernelType kerneltype>
+void
+HostPostProcessEngine::process_kernel(
+	const	BufferList&	bufread,
+			BufferList&	bufwrite,
+			uint		particleRangeEnd)
+{
+	switch (m_pptype) {
+	case VORTICITY:
+		vorticity<kerneltype>(bufread, bufwrite, particleRangeEnd);
+		break;
+	case SURFACE_DETECTION:
+	case INTERFACE_DETECTION:
+		surface_detection<kerneltype>(bufread, bufwrite, particleRangeEnd);
+		break;
+	case TESTPOINTS:
+		testpoints<kerneltype>(bufread, bufwrite, particleRangeEnd);
+		break;
+	default:
+		throw invalid_argument("unsupported post-processing for host processing");
+	}
+}
+
+void
+HostPostProcessEngine::process(
+	const	BufferList&	bufread,
+			BufferList&	bufwrite,
+			uint		numParticles,
+			uint		particleRangeEnd,
+			uint		/* deviceIndex */,
+	const	GlobalData	* const /* gdata */)
+{
+	if (m_pptype == FLUX_COMPUTATION) {
+		flux_computation(bufread, particleRangeEnd);
+		return;
+	}
+
+	m_list.build(bufread.getData<BUFFER_POS_GLOBAL>(), bufread.getData<BUFFER_INFO>(),
+		numParticles, m_problem->simparams()->influenceRadius);
+
+	switch (m_problem->simparams()->kerneltype) {
+	case CUBICSPLINE:
+		process_kernel<CUBICSPLINE>(bufread, bufwrite, particleRangeEnd);
+		break;
+	case QUADRATIC:
+		process_kernel<QUADRATIC>(bufread, bufwrite, particleRangeEnd);
+		break;
+	case WENDLAND:
+		process_kernel<WENDLAND>(bufread, bufwrite, particleRangeEnd);
+		break;
+	case GAUSSIAN:
+		process_kernel<GAUSSIAN>(bufread, bufwrite, particleRangeEnd);
+		break;
+	default:
+		throw invalid_argument("unsupported kernel for host post-processing");
+	}
+}
+
+void
+HostPostProcessEngine::hostAllocate(const GlobalData * const /* gdata */)
+{
+	if (m_pptype == FLUX_COMPUTATION)
+		m_flux.assign(m_problem->simparams()->numOpenBoundaries, 0.0f);
+}
+
+void
+HostPostProcessEngine::hostProcess(const GlobalData * const gdata)
+{
+	// the host engine processes all the particles of the node at once,
+	// so only the nodes need to be reduced
+	if (m_pptype == FLUX_COMPUTATION && gdata->mpi_nodes > 1 && !m_flux.empty())
+		gdata->networkManager->networkFloatReduction(m_flux.data(), m_flux.size(), SUM_REDUCTION);
+}
+
+void
+HostPostProcessEngine::write(WriterMap writers, double t)
+{
+	if (m_pptype == FLUX_COMPUTATION)
+		Writer::WriteFlux(writers, t, m_flux.data());
+}
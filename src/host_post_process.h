@@ -0,0 +1,127 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Post-processing (vorticity, surface detection, testpoints) on host
+ */
+
+#ifndef _HOST_POST_PROCESS_H
+#define _HOST_POST_PROCESS_H
+
+#include <vector>
+
+#include "simparams.h"
+#include "physparams.h"
+#include "engine_postprocess.h"
+#include "host_neibs.h"
+
+class ProblemCore;
+
+//! Host implementation of the post-processing engines
+/*! This is the host counterpart of the CUDA post-processing engines,
+ * meant to be run on the buffers downloaded for a write, so that
+ * the devices can go on with the simulation while the host computes
+ * the additional fields. The work is spread over the host threads
+ * with parallel_jobs(). They replace the device engines when GPUSPH
+ * is run with --host-postprocess.
+ *
+ * All engines read BUFFER_POS_GLOBAL and BUFFER_INFO, and the others they
+ * need (BUFFER_VEL, BUFFER_TKE, BUFFER_EPSILON, BUFFER_EULERVEL,
+ * BUFFER_BOUNDELEMENTS), from the read list, and write into the write list
+ * the same buffers as their device counterpart: BUFFER_VORTICITY for
+ * VORTICITY; BUFFER_INFO (and BUFFER_NORMALS, if requested) for
+ * SURFACE_DETECTION and INTERFACE_DETECTION; BUFFER_VEL (and BUFFER_TKE,
+ * BUFFER_EPSILON if present) of the testpoints for TESTPOINTS.
+ * FLUX_COMPUTATION collects the open boundaries fluxes, that are written
+ * by write() as on device. The neighbors are searched by the engine itself,
+ * with a HostNeibsList that is kept across calls.
+ *
+ * CALC_PRIVATE is problem-defined, and not supported; neither is surface
+ * or interface detection with SA_BOUNDARY or with ENABLE_PLANES.
+ */
+class HostPostProcessEngine : public AbstractPostProcessEngine
+{
+	const ProblemCore	*m_problem;
+	PostProcessType		m_pptype;
+	HostNeibsList		m_list;
+	//! open boundaries fluxes, for FLUX_COMPUTATION
+	std::vector<float>	m_flux;
+
+	template<KernelType kerneltype>
+	void vorticity(
+		const	BufferList&	bufread,
+				BufferList&	bufwrite,
+				uint		particleRangeEnd) const;
+
+	template<KernelType kerneltype>
+	void surface_detection(
+		const	BufferList&	bufread,
+				BufferList&	bufwrite,
+				uint		particleRangeEnd) const;
+
+	template<KernelType kerneltype>
+	void testpoints(
+		const	BufferList&	bufread,
+				BufferList&	bufwrite,
+				uint		particleRangeEnd) const;
+
+	void flux_computation(
+		const	BufferList&	bufread,
+				uint		particleRangeEnd);
+
+	template<KernelType kerneltype>
+	void process_kernel(
+		const	BufferList&	bufread,
+				BufferList&	bufwrite,
+				uint		particleRangeEnd);
+
+public:
+	HostPostProcessEngine(PostProcessType pptype, flag_t options, const ProblemCore *problem);
+
+	void setconstants(const SimParams *, const PhysParams *, idx_t const&) const
+	{} // nothing to do on host
+	void getconstants() {} // nothing to do on host
+
+	flag_t get_written_buffers() const;
+	flag_t get_updated_buffers() const;
+
+	void
+	process(
+		const	BufferList&	bufread,
+				BufferList&	bufwrite,
+				uint		numParticles,
+				uint		particleRangeEnd,
+				uint		deviceIndex,
+		const	GlobalData	* const gdata);
+
+	void hostAllocate(const GlobalData * const gdata);
+	void hostProcess(const GlobalData * const gdata);
+	void write(WriterMap writers, double t);
+};
+
+#endif
@@ -40,7 +40,60 @@
 // swap
 #include <algorithm>
 
+// madvise
+#include <sys/mman.h>
+
 #include "buffer.h"
+#include "numa_placement.h"
+
+/*! Arena for host buffers, with blocks aligned to (and backed by, if the
+ * system allows it) huge pages.
+ * The pages can be interleaved across the NUMA nodes, or first-touched
+ * according to a partition of each buffer (see numa_placement.h)
+ */
+class HostBufferArena : public BufferArena
+{
+	const NumaPolicy m_numa_policy;
+	const NumaPartition m_numa_partition;
+
+protected:
+	virtual void *allocate_block(size_t bytes)
+	{
+		void *ptr = NULL;
+		if (posix_memalign(&ptr, block_alignment, bytes))
+			return NULL;
+#ifdef MADV_HUGEPAGE
+		// this is just a hint, failure is harmless
+		madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+		// nothing has touched the block yet, so the policy will apply to all of it
+		if (m_numa_policy == NUMA_INTERLEAVE)
+			numa_interleave(ptr, bytes);
+		return ptr;
+	}
+
+	virtual void free_block(void *ptr, size_t)
+	{ free(ptr); }
+
+public:
+	HostBufferArena(NumaPolicy numa_policy = NUMA_NONE,
+		NumaPartition const& numa_partition = NumaPartition()) :
+		BufferArena(),
+		m_numa_policy(numa_policy),
+		m_numa_partition(numa_partition)
+	{}
+
+	virtual ~HostBufferArena()
+	{ release(); }
+
+	virtual void fill(void *ptr, int value, size_t bytes)
+	{
+		if (m_numa_policy == NUMA_FIRST_TOUCH)
+			numa_first_touch(ptr, value, bytes, m_numa_partition);
+		else
+			memset(ptr, value, bytes);
+	}
+};
 
 /*! Specialize the Buffer class in the case of host allocations
  * (i.e. using malloc/free/memset/etc)
@@ -59,12 +112,16 @@ public:
 	virtual ~HostBuffer() {
 		const int N = baseclass::array_count; // see NOTE for this class
 		element_type **bufs = baseclass::get_raw_ptr();
+		// arrays taken from an arena are released with it
+		const bool owned = !this->arena();
+		AbstractBuffer::account_free();
 		for (int i = 0; i < N; ++i) {
 #if _DEBUG_
 			//printf("\tfreeing buffer %d\n", i);
 #endif
 			if (bufs[i]) {
-				free(bufs[i]);
+				if (owned)
+					free(bufs[i]);
 				bufs[i] = NULL;
 			}
 		}
@@ -85,12 +142,17 @@ public:
 		const size_t bufmem = elems*sizeof(element_type);
 		const int N = baseclass::array_count; // see NOTE for this class
 		element_type **bufs = baseclass::get_raw_ptr();
+		BufferArena *arena = this->arena();
 		for (int i = 0; i < N; ++i) {
 			// malloc instead of calloc since the init
 			// value might be nonzero
-			bufs[i] = (element_type*)malloc(bufmem);
-			memset(bufs[i], baseclass::get_init_value(), bufmem);
+			bufs[i] = (element_type*)(arena ? arena->take(bufmem) : malloc(bufmem));
+			if (arena)
+				arena->fill(bufs[i], baseclass::get_init_value(), bufmem);
+			else
+				memset(bufs[i], baseclass::get_init_value(), bufmem);
 		}
+		AbstractBuffer::account_alloc(bufmem*N);
 		return bufmem*N;
 	}
 
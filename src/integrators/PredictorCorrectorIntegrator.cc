@@ -374,6 +374,10 @@ PredictorCorrector::initializeNextStepSequence(StepInfo const& step)
 		this_phase->add_command(RENAME_STATE)
 			.set_src("step n+1")
 			.set_dst("step n");
+		// adaptive neighbors list construction needs the particle speed
+		if (sp->buildneibsfreq == 0)
+			this_phase->add_command(FIND_MAX_SPEED)
+				.reading("step n", BUFFER_VEL);
 		this_phase->add_command(TIME_STEP_EPILOGUE);
 	}
 
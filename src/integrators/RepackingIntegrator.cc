@@ -415,6 +415,11 @@ RepackingIntegrator::initializeRepackingSequence(StepInfo const& step)
 
 	// TODO compute kinetic energy to allow stop criteria based on its decrease
 
+	// adaptive neighbors list construction needs the particle speed
+	if (gdata->problem->simparams()->buildneibsfreq == 0)
+		this_phase->add_command(FIND_MAX_SPEED)
+			.reading("step n", BUFFER_VEL);
+
 	this_phase->add_command(TIME_STEP_EPILOGUE);
 
 	return this_phase;
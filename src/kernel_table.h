@@ -0,0 +1,273 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Analytic and tabulated SPH kernels for host-side computations
+ *
+ * AnalyticKernel evaluates the kernel W and F = (dW/dr)/r, with the same
+ * normalization as the device forces engine, as functions of the squared
+ * distance. KernelTable holds both functions sampled at uniformly spaced
+ * values of (r/h)^2 over the influence radius, and evaluates them
+ * by linear interpolation, which avoids the square root, divisions and
+ * transcendental functions of the analytic forms in the pair loop.
+ */
+
+#ifndef _KERNEL_TABLE_H
+#define _KERNEL_TABLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "particledefine.h"
+#include "vector_math.h"
+
+//! Default number of intervals of the kernel tables
+#define KERNEL_TABLE_INTERVALS 4096
+
+/*! Number of intervals near the origin where the kernels are evaluated
+ * analytically: the kernels have odd powers of r, whose interpolation over r^2
+ * is inaccurate close to the origin, where particles are seldom found anyway
+ */
+#define KERNEL_TABLE_NEAR_INTERVALS 16
+
+//! Analytic SPH kernel
+/*! Specialized for each KernelType. The specializations provide
+ * W(r2) and F(r2) as functions of the squared distance r2 (which must be
+ * within the influence radius), and set singular_gradient if F diverges
+ * at the origin (in which case the tables hold r*F instead).
+ */
+template<KernelType kerneltype>
+struct AnalyticKernel;
+
+template<>
+struct AnalyticKernel<CUBICSPLINE>
+{
+	enum { singular_gradient = false };
+
+	float	slength;
+	float	wcoeff;
+	float	fcoeff;
+
+	AnalyticKernel(double h, double) :
+		slength(h),
+		wcoeff(1.0/(M_PI*h*h*h)),
+		fcoeff(3.0/(4.0*M_PI*h*h*h*h))
+	{}
+
+	float W(float r2) const
+	{
+		const float R = sqrtf(r2)/slength;
+		const float val = R < 1.0f ?
+			1.0f - 1.5f*R*R + 0.75f*R*R*R :
+			0.25f*(2.0f - R)*(2.0f - R)*(2.0f - R);
+		return val*wcoeff;
+	}
+
+	float F(float r2) const
+	{
+		const float r = sqrtf(r2);
+		const float R = r/slength;
+		const float val = R < 1.0f ?
+			(-4.0f + 3.0f*R)/slength :
+			-(-2.0f + R)*(-2.0f + R)/r;
+		return val*fcoeff;
+	}
+};
+
+template<>
+struct AnalyticKernel<QUADRATIC>
+{
+	enum { singular_gradient = true };
+
+	float	slength;
+	float	wcoeff;
+	float	fcoeff;
+
+	AnalyticKernel(double h, double) :
+		slength(h),
+		wcoeff(15.0/(16.0*M_PI*h*h*h)),
+		fcoeff(15.0/(32.0*M_PI*h*h*h*h))
+	{}
+
+	float W(float r2) const
+	{
+		const float R = sqrtf(r2)/slength;
+		return (0.25f*R*R - R + 1.0f)*wcoeff;
+	}
+
+	float F(float r2) const
+	{
+		const float r = sqrtf(r2);
+		return (-2.0f + r/slength)/r*fcoeff;
+	}
+};
+
+template<>
+struct AnalyticKernel<WENDLAND>
+{
+	enum { singular_gradient = false };
+
+	float	slength;
+	float	wcoeff;
+	float	fcoeff;
+
+	AnalyticKernel(double h, double) :
+		slength(h),
+		wcoeff(21.0/(16.0*M_PI*h*h*h)),
+		fcoeff(105.0/(128.0*M_PI*h*h*h*h*h))
+	{}
+
+	float W(float r2) const
+	{
+		const float R = sqrtf(r2)/slength;
+		float val = 1.0f - 0.5f*R;
+		val *= val;
+		val *= val;
+		val *= 1.0f + 2.0f*R;
+		return val*wcoeff;
+	}
+
+	float F(float r2) const
+	{
+		const float qm2 = sqrtf(r2)/slength - 2.0f;
+		return qm2*qm2*qm2*fcoeff;
+	}
+};
+
+template<>
+struct AnalyticKernel<GAUSSIAN>
+{
+	enum { singular_gradient = false };
+
+	float	slength;
+	float	wcoeff;
+	float	fcoeff;
+	float	wsub; ///< kernel offset, so that W vanishes at the kernel radius
+
+	AnalyticKernel(double h, double R) :
+		slength(h),
+		wsub(exp(-R*R))
+	{
+		const double h3 = h*h*h;
+		wcoeff = 1/(-2*wsub/3*h3*M_PI*R*(3 + 2*R*R) + h3*pow(M_PI, 1.5)*erf(R));
+		fcoeff = wcoeff*2/(h*h);
+	}
+
+	float W(float r2) const
+	{ return (expf(-r2/(slength*slength)) - wsub)*wcoeff; }
+
+	float F(float r2) const
+	{ return -expf(-r2/(slength*slength))*fcoeff; }
+};
+
+//! Common base of the kernel tables, to hold them independently of the kernel
+class KernelTableBase
+{
+public:
+	virtual ~KernelTableBase() {}
+};
+
+//! Tabulated SPH kernel
+/*! W and F (or r*F, for kernels with a singular gradient) are sampled
+ * at intervals+1 values of r^2 uniformly spaced between 0 and the square
+ * of the influence radius, and stored interleaved, so that a single
+ * table fetch gives both. Both functions are zero beyond the influence radius,
+ * and evaluated analytically in the first KERNEL_TABLE_NEAR_INTERVALS intervals.
+ */
+template<KernelType kerneltype>
+class KernelTable : public KernelTableBase
+{
+public:
+	typedef AnalyticKernel<kerneltype> analytic_type;
+
+private:
+	analytic_type		m_analytic;
+	std::vector<float2>	m_nodes;
+	float				m_r2near; ///< squared distance below which the analytic kernel is used
+	float				m_r2max;
+	float				m_scale; ///< intervals per unit of r^2
+
+	//! Interpolated (W, F) (or (W, r*F)) at squared distance r2
+	float2 lookup(float r2) const
+	{
+		if (r2 >= m_r2max)
+			return make_float2(0.0f);
+		const float x = r2*m_scale;
+		// x can round up to the number of intervals for r2 just below m_r2max
+		const uint i = std::min(uint(x), uint(m_nodes.size() - 2));
+		const float t = x - i;
+		const float2 a = m_nodes[i];
+		const float2 b = m_nodes[i + 1];
+		return make_float2(a.x + t*(b.x - a.x), a.y + t*(b.y - a.y));
+	}
+
+public:
+	KernelTable(double slength, double influenceradius, double kernelradius,
+		uint intervals = KERNEL_TABLE_INTERVALS) :
+		m_analytic(slength, kernelradius),
+		m_nodes(intervals + 1),
+		m_r2near(influenceradius*influenceradius*KERNEL_TABLE_NEAR_INTERVALS/intervals),
+		m_r2max(influenceradius*influenceradius),
+		m_scale(intervals/(influenceradius*influenceradius))
+	{
+		const double r2step = influenceradius*influenceradius/intervals;
+		for (uint i = 0; i <= intervals; ++i) {
+			const float r2 = i*r2step;
+			float f;
+			if (analytic_type::singular_gradient)
+				f = i ? m_analytic.F(r2)*sqrtf(r2) : -2.0f*m_analytic.fcoeff;
+			else
+				f = m_analytic.F(r2);
+			m_nodes[i] = make_float2(m_analytic.W(r2), f);
+		}
+	}
+
+	analytic_type const& analytic() const
+	{ return m_analytic; }
+
+	size_t memory() const
+	{ return m_nodes.size()*sizeof(float2); }
+
+	float W(float r2) const
+	{
+		if (r2 < m_r2near)
+			return m_analytic.W(r2);
+		return lookup(r2).x;
+	}
+
+	float F(float r2) const
+	{
+		if (r2 < m_r2near)
+			return m_analytic.F(r2);
+		const float f = lookup(r2).y;
+		return analytic_type::singular_gradient ? f/sqrtf(r2) : f;
+	}
+};
+
+#endif
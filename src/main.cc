@@ -49,6 +49,7 @@
 #include "fastmath_select.opt"
 #include "gpusph_version.opt"
 #include "hdf5_select.opt"
+#include "zlib_select.opt"
 #include "mpi_select.opt"
 #include "catalyst_select.opt"
 
@@ -70,6 +71,7 @@ void show_version()
 		COMPUTE/10, COMPUTE%10);
 	printf("Chrono : %s\n", USE_CHRONO ? "enabled" : "disabled");
 	printf("HDF5   : %s\n", USE_HDF5 ? "enabled" : "disabled");
+	printf("zlib   : %s\n", USE_ZLIB ? "enabled" : "disabled");
 	printf("MPI    : %s\n", USE_MPI ? "enabled" : "disabled");
 	printf("Catalyst : %s\n", USE_CATALYST ? "enabled" : "disabled");
 	printf("Compiled for problem \"%s\"\n", selected_problem.name);
@@ -82,8 +84,11 @@ void print_usage() {
 	cout << "Syntax: " << endl;
 	cout << "\tGPUSPH [--device n[,n...]] [--dem dem_file] [--deltap VAL] [--tend VAL] [--dt VAL]\n";
 	cout << "\t       [--resume fname] [--checkpoint-every VAL] [--checkpoints VAL]\n";
-	cout << "\t       [--dir directory] [--nosave] [--striping] [--gpudirect [--asyncmpi]]\n";
-	cout << "\t       [--num-hosts VAL [--byslot-scheduling]]\n";
+	cout << "\t       [--checkpoint-full-every VAL] [--checkpoint-compress]\n";
+	cout << "\t       [--dir directory] [--nosave] [--binary-series] [--vtk-legacy-format FORMAT]\n";
+	cout << "\t       [--host-postprocess]\n";
+	cout << "\t       [--striping] [--gpudirect [--asyncmpi]]\n";
+	cout << "\t       [--num-hosts VAL [--byslot-scheduling]] [--numa POLICY]\n";
 	cout << "\t       [--display [--display-every VAL] --display-script VAL]\n";
 	cout << "\t       [--debug FLAGS]\n";
 	cout << "\tGPUSPH --help\n\n";
@@ -91,6 +96,9 @@ void print_usage() {
 	cout << " --checkpoint-every : HotStart checkpoints will be created every VAL seconds\n";
 	cout << "                      of simulated time (float VAL, 0 disables)\n";
 	cout << " --checkpoints : number of HotStart checkpoints to keep (integer VAL)\n";
+	cout << " --checkpoint-full-every : write a full HotStart file every VAL checkpoints,\n";
+	cout << "                           and delta files with the changed data in between (integer VAL)\n";
+	cout << " --checkpoint-compress : compress the HotStart files (lossless)\n";
 	cout << " --device n[,n...] : Use device number n; runs multi-gpu if multiple n are given\n";
 	cout << " --dem : Use given DEM (if problem supports it)\n";
 	cout << " --deltap : Use given deltap (VAL is cast to float)\n";
@@ -99,12 +107,19 @@ void print_usage() {
 	cout << " --maxiter : Break after this many iterations (integer VAL)\n";
 	cout << " --dir : Use given directory for dumps instead of date-based one\n";
 	cout << " --nosave : Disable all file dumps but the last\n";
+	cout << " --binary-series : Write energy, gages, body data, fluxes and testpoints as\n";
+	cout << "                   columnar binary time series (.series) instead of text\n";
+	cout << " --vtk-legacy-format : Encoding of the legacy VTK files: binary (default) or ascii\n";
+	cout << " --host-postprocess : Run vorticity, testpoints and flux computation on the host at write time,\n";
+	cout << "                      while the devices go on with the simulation (single-node only)\n";
 	cout << " --gpudirect: Enable GPUDirect for RDMA (requires a CUDA-aware MPI library)\n";
 	cout << " --striping : Enable computation/transfer overlap  in multi-GPU (usually convenient for 3+ devices)\n";
 	cout << " --asyncmpi : Enable asynchronous network transfers (requires GPUDirect and 1 process per device)\n";
 	cout << " --num-hosts : Specify number of hosts. To be used if #processes > #hosts (VAL is cast to uint)\n";
 	cout << " --byslot-scheduling : MPI scheduler is filling hosts first, as opposite to round robin scheduling\n";
 	cout << " --no-leak-warning : do not warn if #particles decreases without outlets (e.g. overtopping, leaking)\n";
+	cout << " --numa : NUMA placement of the host buffers: none (default), first-touch (on the node\n";
+	cout << "          of the device processing each range) or interleave (across all nodes)\n";
 	//cout << " --nobalance : Disable dynamic load balancing\n";
 	//cout << " --lb-threshold : Set custom LB activation threshold (VAL is cast to float)\n";
 	cout << " --display : Enable co-processing visulaization\n";
@@ -153,6 +168,12 @@ int parse_options(int argc, char **argv, GlobalData *gdata)
 			sscanf(*argv, "%d", &(_clOptions->checkpoints));
 			argv++;
 			argc--;
+		} else if (!strcmp(arg, "--checkpoint-full-every")) {
+			sscanf(*argv, "%d", &(_clOptions->checkpoint_full_every));
+			argv++;
+			argc--;
+		} else if (!strcmp(arg, "--checkpoint-compress")) {
+			_clOptions->checkpoint_compress = true;
 		} else if (!strcmp(arg, "--device")) {
 			/* parse the argument as a device list, and append it to any previously
 			 * added devices */
@@ -193,6 +214,10 @@ int parse_options(int argc, char **argv, GlobalData *gdata)
 			argc--;
 		} else if (!strcmp(arg, "--nosave")) {
 			_clOptions->nosave = true;
+		} else if (!strcmp(arg, "--binary-series")) {
+			_clOptions->binary_series = true;
+		} else if (!strcmp(arg, "--host-postprocess")) {
+			_clOptions->host_postprocess = true;
 		} else if (!strcmp(arg, "--gpudirect")) {
 			_clOptions->gpudirect = true;
 		} else if (!strcmp(arg, "--striping")) {
@@ -204,6 +229,10 @@ int parse_options(int argc, char **argv, GlobalData *gdata)
 			sscanf(*argv, "%u", &(_clOptions->num_hosts));
 			argv++;
 			argc--;
+		} else if (!strcmp(arg, "--numa")) {
+			gdata->numaPolicy = parse_numa_policy(*argv);
+			argv++;
+			argc--;
 		} else if (!strcmp(arg, "--version")) {
 			show_version();
 			return 0;
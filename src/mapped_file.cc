@@ -0,0 +1,70 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the read-only file mapping
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+// open
+#include <fcntl.h>
+// mmap
+#include <sys/mman.h>
+// fstat
+#include <sys/stat.h>
+// close
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+using namespace std;
+
+MappedFile::MappedFile(string const& fname) : m_data(NULL), m_size(0)
+{
+	int fd = open(fname.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw runtime_error("failed to open " + fname + ": " + strerror(errno));
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		m_size = st.st_size;
+		m_data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (!m_data || m_data == MAP_FAILED)
+		throw runtime_error("failed to map " + fname);
+	// we're going to read (almost) all of it
+	madvise(m_data, m_size, MADV_WILLNEED);
+}
+
+MappedFile::~MappedFile()
+{
+	munmap(m_data, m_size);
+}
@@ -0,0 +1,62 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Read-only memory mapping of a whole file
+ */
+
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+//! Read-only memory mapping of a whole file
+/*! The file is mapped on construction, and unmapped on destruction.
+ * Throws if the file cannot be opened or mapped (including empty files).
+ */
+class MappedFile
+{
+	void *m_data;
+	size_t m_size;
+
+	MappedFile(MappedFile const&); // NOT implemented
+	void operator=(MappedFile const&); // NOT implemented
+
+public:
+	MappedFile(std::string const& fname);
+	~MappedFile();
+
+	const char *data() const
+	{ return static_cast<const char*>(m_data); }
+
+	size_t size() const
+	{ return m_size; }
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file
+ * Memory accounting implementation
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "memory_accounting.h"
+
+using namespace std;
+
+// registry of the memory usage by tag, and the mutex protecting it
+static map<string, MemoryUsage> g_memory_usage;
+static mutex g_memory_usage_mutex;
+
+// apply a (signed) change in usage to a single registry entry
+static void account_delta(string const& tag, size_t bytes, bool release)
+{
+	MemoryUsage &usage = g_memory_usage[tag];
+	if (release) {
+		// guard against mismatched releases rather than wrapping around
+		usage.current -= min(bytes, usage.current);
+		++usage.frees;
+	} else {
+		usage.current += bytes;
+		++usage.allocs;
+		if (usage.current > usage.peak)
+			usage.peak = usage.current;
+	}
+}
+
+// apply a change in usage to the tag and all of its ancestors;
+// must be called with the registry lock held
+static void account_tree(string const& tag, size_t bytes, bool release)
+{
+	account_delta(tag, bytes, release);
+	for (size_t sep = tag.rfind('/'); sep != string::npos && sep > 0; sep = tag.rfind('/', sep - 1))
+		account_delta(tag.substr(0, sep), bytes, release);
+}
+
+void memory_account_alloc(string const& tag, size_t bytes)
+{
+	lock_guard<mutex> lock(g_memory_usage_mutex);
+	account_tree(tag, bytes, false);
+}
+
+void memory_account_free(string const& tag, size_t bytes)
+{
+	lock_guard<mutex> lock(g_memory_usage_mutex);
+	account_tree(tag, bytes, true);
+}
+
+void memory_account_set(string const& tag, size_t bytes)
+{
+	lock_guard<mutex> lock(g_memory_usage_mutex);
+	const size_t current = g_memory_usage[tag].current;
+	if (bytes > current)
+		account_tree(tag, bytes - current, false);
+	else if (bytes < current)
+		account_tree(tag, current - bytes, true);
+}
+
+MemoryUsage memory_usage(string const& tag)
+{
+	lock_guard<mutex> lock(g_memory_usage_mutex);
+	auto found = g_memory_usage.find(tag);
+	return found == g_memory_usage.end() ? MemoryUsage() : found->second;
+}
+
+map<string, MemoryUsage> memory_usage_snapshot()
+{
+	lock_guard<mutex> lock(g_memory_usage_mutex);
+	return g_memory_usage;
+}
+
+// pretty-print memory amounts, like GlobalData::memString()
+static string mem_string(size_t memory)
+{
+	static const char *memSuffix[] = {
+		"B", "KiB", "MiB", "GiB", "TiB"
+	};
+	static const size_t memSuffix_els = sizeof(memSuffix)/sizeof(*memSuffix);
+
+	double mem = (double)memory;
+	unsigned int idx = 0;
+	while (mem > 1024 && idx < memSuffix_els - 1) {
+		mem /= 1024;
+		++idx;
+	}
+
+	ostringstream oss;
+	oss.precision(mem < 10 ? 3 : mem < 100 ? 4 : 5);
+	oss << mem << " " << memSuffix[idx];
+	return oss.str();
+}
+
+void print_memory_usage(ostream& out)
+{
+	const map<string, MemoryUsage> snapshot = memory_usage_snapshot();
+
+	out << "Memory usage (current / high-water):\n";
+	// the map is sorted by tag, so children follow their parents,
+	// and we only need to indent by depth
+	for (auto const& entry : snapshot) {
+		string const& tag = entry.first;
+		MemoryUsage const& usage = entry.second;
+
+		const size_t sep = tag.rfind('/');
+		const size_t depth = count(tag.begin(), tag.end(), '/');
+		const string name = (sep == string::npos ? tag : tag.substr(sep + 1));
+
+		out << "  " << string(2*depth, ' ') << left << setw(40 - 2*depth) << name << right
+			<< setw(12) << mem_string(usage.current) << " / "
+			<< setw(12) << mem_string(usage.peak)
+			<< "  (" << usage.allocs << " allocs, " << usage.frees << " frees)\n";
+	}
+}
@@ -0,0 +1,89 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file
+ * Memory accounting for host and device allocations
+ *
+ * Allocations are recorded under hierarchical, '/'-separated tags, such as
+ * "host/s_hBuffers/Position" or "device0/Velocity". Each record also updates
+ * all the ancestors of the tag ("host/s_hBuffers", "host"), so that the
+ * high-water mark of a whole subsystem is the actual peak of the sum of its
+ * components, rather than the sum of the individual peaks.
+ *
+ * The top-level component of a tag identifies an independent tree: the
+ * "host" and "device<N>" trees describe where the memory lives, while
+ * the "states" tree describes which ParticleSystem::State owns the device
+ * buffers at any given time (and is thus a different view of the same memory
+ * already accounted for in the "device<N>" trees).
+ * Buffers that were not assigned a tag are accounted under their
+ * buffer class (e.g. "HostBuffer/Position").
+ */
+
+#ifndef _MEMORY_ACCOUNTING_H
+#define _MEMORY_ACCOUNTING_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <string>
+
+//! Current and high-water usage for a tag
+struct MemoryUsage
+{
+	size_t current; ///< bytes currently allocated
+	size_t peak; ///< maximum value reached by current
+	unsigned long allocs; ///< number of recorded allocations
+	unsigned long frees; ///< number of recorded releases
+
+	MemoryUsage() :
+		current(0), peak(0), allocs(0), frees(0)
+	{}
+};
+
+//! Record the allocation of the given number of bytes under the given tag
+void memory_account_alloc(std::string const& tag, size_t bytes);
+
+//! Record the release of the given number of bytes under the given tag
+void memory_account_free(std::string const& tag, size_t bytes);
+
+//! Set the current usage for the given tag
+/*! This is useful for memory whose size is only known in aggregate, such as
+ * the contents of a std::vector or the buffers owned by a ParticleSystem::State:
+ * the difference with the previous value is recorded as an allocation or release
+ */
+void memory_account_set(std::string const& tag, size_t bytes);
+
+//! Get the usage for the given tag (zero usage if the tag is unknown)
+MemoryUsage memory_usage(std::string const& tag);
+
+//! Get a snapshot of the usage of all the tags
+std::map<std::string, MemoryUsage> memory_usage_snapshot();
+
+//! Print a table with the current and high-water usage of all tags
+void print_memory_usage(std::ostream& out);
+
+#endif
@@ -0,0 +1,282 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of the NUMA placement helpers
+ */
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include "numa_placement.h"
+
+// memory policy constants, from linux/mempolicy.h, which we don't want to depend on
+#define NUMA_MPOL_PREFERRED	1
+#define NUMA_MPOL_INTERLEAVE	3
+#define NUMA_MPOL_MF_MOVE	(1 << 1)
+
+using namespace std;
+
+const char* NumaPolicyName[NUMA_INTERLEAVE+1] = {
+	"none",
+	"first-touch",
+	"interleave",
+};
+
+NumaPolicy parse_numa_policy(string const& name)
+{
+	for (int p = NUMA_NONE; p <= NUMA_INTERLEAVE; ++p)
+		if (name == NumaPolicyName[p])
+			return NumaPolicy(p);
+	throw invalid_argument("unknown NUMA policy " + name);
+}
+
+// path of the sysfs directory of the given node
+static string node_path(int node)
+{ return "/sys/devices/system/node/node" + to_string(node); }
+
+int numa_num_nodes()
+{
+	int nodes = 0;
+	// nodes are numbered consecutively
+	while (ifstream(node_path(nodes) + "/cpulist").good())
+		++nodes;
+	return nodes;
+}
+
+int numa_node_of_pci_device(string const& bus_id)
+{
+	// sysfs uses lowercase hex digits
+	string id(bus_id);
+	for (auto& c : id)
+		c = tolower(c);
+
+	int node = -1;
+	ifstream numa_node("/sys/bus/pci/devices/" + id + "/numa_node");
+	if (!(numa_node >> node))
+		return -1;
+	// the kernel reports -1 when the device has no affinity
+	return node;
+}
+
+// list of the CPUs of the given node, parsed from a list such as 0-3,8-11
+static vector<int> node_cpus(int node)
+{
+	vector<int> cpus;
+	ifstream cpulist(node_path(node) + "/cpulist");
+	string range;
+	while (getline(cpulist, range, ',')) {
+		int first, last;
+		char dash;
+		istringstream parse(range);
+		if (!(parse >> first))
+			break;
+		last = first;
+		if (parse >> dash >> last && dash != '-')
+			break;
+		for (int cpu = first; cpu <= last; ++cpu)
+			cpus.push_back(cpu);
+	}
+	return cpus;
+}
+
+bool numa_bind_thread(int node)
+{
+#ifdef __linux__
+	if (node < 0)
+		return false;
+	vector<int> cpus = node_cpus(node);
+	if (cpus.empty())
+		return false;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int cpu : cpus)
+		if (cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &set);
+	// on Linux, pid 0 refers to the calling thread
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+#ifdef __linux__
+// number of bits in a node mask word
+static const int mask_bits = 8*sizeof(unsigned long);
+
+static size_t page_size()
+{ return sysconf(_SC_PAGESIZE); }
+
+static long do_mbind(void *ptr, size_t bytes, int mode,
+	vector<unsigned long> const& mask, unsigned flags)
+{
+	// maxnode is one more than the number of bits in the mask, due to a
+	// historical off-by-one in the kernel interface
+	return syscall(SYS_mbind, ptr, bytes, mode,
+		mask.data(), mask.size()*mask_bits + 1, flags);
+}
+#endif
+
+bool numa_interleave(void *ptr, size_t bytes)
+{
+#ifdef __linux__
+	const int nodes = numa_num_nodes();
+	if (nodes < 2)
+		return false;
+
+	vector<unsigned long> mask((nodes + mask_bits - 1)/mask_bits, 0);
+	for (int node = 0; node < nodes; ++node)
+		mask[node/mask_bits] |= 1UL << (node % mask_bits);
+
+	// the range must start on a page boundary
+	const size_t page = page_size();
+	char *start = (char*)ptr - (size_t(ptr) % page);
+	return do_mbind(start, bytes + ((char*)ptr - start),
+		NUMA_MPOL_INTERLEAVE, mask, 0) == 0;
+#else
+	return false;
+#endif
+}
+
+bool numa_move(void *ptr, size_t bytes, int node)
+{
+#ifdef __linux__
+	if (node < 0)
+		return false;
+
+	// only move the pages fully contained in the range, since
+	// the ones at the edges are shared with the neighboring ranges
+	const size_t page = page_size();
+	const size_t begin = (size_t(ptr) + page - 1)/page*page;
+	const size_t end = (size_t(ptr) + bytes)/page*page;
+	if (end <= begin)
+		return true;
+
+	vector<unsigned long> mask(node/mask_bits + 1, 0);
+	mask[node/mask_bits] |= 1UL << (node % mask_bits);
+
+	return do_mbind((void*)begin, end - begin,
+		NUMA_MPOL_PREFERRED, mask, NUMA_MPOL_MF_MOVE) == 0;
+#else
+	return false;
+#endif
+}
+
+void numa_first_touch(void *ptr, int value, size_t bytes, NumaPartition const& partition)
+{
+	double total_weight = 0;
+	for (auto const& part : partition)
+		total_weight += part.weight;
+
+	if (partition.size() < 2 || !(total_weight > 0)) {
+		memset(ptr, value, bytes);
+		return;
+	}
+
+#ifdef __linux__
+	const size_t page = page_size();
+#else
+	const size_t page = 4096;
+#endif
+
+	vector<thread> touchers;
+	touchers.reserve(partition.size());
+
+	char *base = (char*)ptr;
+	size_t begin = 0;
+	double cumulative_weight = 0;
+	for (auto const& part : partition) {
+		cumulative_weight += part.weight;
+		// part boundaries are rounded to the page size, so that each page
+		// is touched by a single thread (except for the last part, that
+		// takes whatever is left)
+		size_t end = &part == &partition.back() ? bytes :
+			size_t(bytes*(cumulative_weight/total_weight))/page*page;
+		if (end > bytes)
+			end = bytes;
+		if (end <= begin)
+			continue;
+
+		const int node = part.node;
+		touchers.push_back(thread([=]() {
+			numa_bind_thread(node);
+			memset(base + begin, value, end - begin);
+		}));
+		begin = end;
+	}
+
+	for (auto& toucher : touchers)
+		toucher.join();
+}
+
+vector<size_t> numa_placement(const void *ptr, size_t bytes)
+{
+	vector<size_t> placement;
+#ifdef __linux__
+	const size_t page = page_size();
+	const size_t first = size_t(ptr)/page;
+	const size_t last = (size_t(ptr) + bytes + page - 1)/page;
+	if (last <= first)
+		return placement;
+
+	// query at most this many pages, evenly spaced
+	static const size_t max_samples = 4096;
+	const size_t num_pages = last - first;
+	const size_t stride = (num_pages + max_samples - 1)/max_samples;
+
+	vector<void*> pages;
+	for (size_t p = first; p < last; p += stride)
+		pages.push_back((void*)(p*page));
+	vector<int> status(pages.size(), -1);
+
+	// with a NULL node list, move_pages only reports the node of each page
+	if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), NULL, status.data(), 0) != 0)
+		return placement;
+
+	for (int node : status) {
+		// negative values are errors, e.g. pages not touched yet
+		if (node < 0)
+			continue;
+		if (size_t(node) >= placement.size())
+			placement.resize(node + 1, 0);
+		placement[node] += stride*page;
+	}
+#endif
+	return placement;
+}
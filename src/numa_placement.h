@@ -0,0 +1,98 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * NUMA placement of host memory
+ *
+ * On multi-socket hosts, the pages of a host allocation end up on the memory
+ * node of the thread that first touches them. This module provides the means
+ * to control this: parallel first-touch by threads bound to the node that will
+ * process each part of an allocation, interleaving across all nodes, migration
+ * of already-touched ranges, and a report of the actual placement.
+ *
+ * Everything is implemented on top of the Linux system calls and sysfs, without
+ * depending on libnuma; on other systems (or if the system calls fail) memory
+ * is simply initialized by the calling thread and no placement is reported.
+ */
+
+#ifndef _NUMA_PLACEMENT_H
+#define _NUMA_PLACEMENT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//! Placement policy for the global host buffers
+enum NumaPolicy {
+	NUMA_NONE, ///< no special handling: pages are touched by the allocating thread
+	NUMA_FIRST_TOUCH, ///< pages are touched by threads on the node of the device processing them
+	NUMA_INTERLEAVE, ///< pages are interleaved across all nodes
+};
+
+//! Names of the NUMA policies, as accepted on the command line
+extern const char* NumaPolicyName[NUMA_INTERLEAVE+1];
+
+//! Get the NUMA policy from its name, throws if unknown
+NumaPolicy parse_numa_policy(std::string const& name);
+
+//! A part of a host allocation, and the node it should be placed on
+struct NumaPart {
+	double weight; ///< relative size of the part
+	int node; ///< NUMA node for the part, or -1 if it doesn't matter
+};
+
+//! A subdivision of host allocations in parts, in order
+typedef std::vector<NumaPart> NumaPartition;
+
+//! Number of NUMA nodes on the system, 0 if unknown
+int numa_num_nodes();
+
+//! NUMA node of a PCI device, given its bus ID (e.g. 0000:3b:00.0), -1 if unknown
+int numa_node_of_pci_device(std::string const& bus_id);
+
+//! Bind the calling thread to the CPUs of the given node
+/*! Returns false if the node is unknown or the binding failed */
+bool numa_bind_thread(int node);
+
+//! Interleave the (not yet touched) pages of the given range across all nodes
+bool numa_interleave(void *ptr, size_t bytes);
+
+//! Move the pages fully contained in the given range to the given node
+bool numa_move(void *ptr, size_t bytes, int node);
+
+//! Initialize the given range to value (as memset), touching each part
+//! of the partition from a thread bound to its node
+void numa_first_touch(void *ptr, int value, size_t bytes, NumaPartition const& partition);
+
+//! Amount of memory of the given range placed on each node
+/*! The result is indexed by node, and estimated from a sample of the pages
+ * for large ranges. Empty if the information is not available.
+ */
+std::vector<size_t> numa_placement(const void *ptr, size_t bytes);
+
+#endif
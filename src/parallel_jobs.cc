@@ -0,0 +1,73 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Implementation of parallel_jobs
+ */
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "parallel_jobs.h"
+
+using namespace std;
+
+void parallel_jobs(size_t count, function<void(size_t)> const& job)
+{
+	size_t nthreads = thread::hardware_concurrency();
+	if (nthreads == 0) nthreads = 1;
+	if (nthreads > count) nthreads = count;
+
+	atomic<size_t> next(0);
+	exception_ptr error;
+	atomic_flag error_set = ATOMIC_FLAG_INIT;
+
+	auto worker = [&]() {
+		size_t j;
+		while ((j = next++) < count) {
+			try {
+				job(j);
+			} catch (...) {
+				if (!error_set.test_and_set())
+					error = current_exception();
+			}
+		}
+	};
+
+	vector<thread> threads;
+	for (size_t t = 1; t < nthreads; ++t)
+		threads.push_back(thread(worker));
+	worker();
+	for (auto& t : threads)
+		t.join();
+
+	if (error)
+		rethrow_exception(error);
+}
@@ -0,0 +1,46 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Running independent host jobs on all the available cores
+ */
+
+#ifndef _PARALLEL_JOBS_H
+#define _PARALLEL_JOBS_H
+
+#include <cstddef>
+#include <functional>
+
+//! Run count independent jobs on as many threads as the hardware allows
+/*! job is called with each index in [0, count), in no particular order.
+ * The calling thread takes part in the work. If any job throws, the first
+ * exception is rethrown once all the threads are done.
+ */
+void parallel_jobs(size_t count, std::function<void(size_t)> const& job);
+
+#endif
@@ -16,3 +16,4 @@ if (flag == "check_buffer_consistency") ret.check_buffer_consistency = 1; else
 if (flag == "clobber_invalid_buffers") ret.clobber_invalid_buffers = 1; else 
 if (flag == "validate_init_positions") ret.validate_init_positions = 1; else 
 if (flag == "benchmark_command_runtimes") ret.benchmark_command_runtimes = 1; else 
+if (flag == "benchmark_host_counters") ret.benchmark_host_counters = 1; else 
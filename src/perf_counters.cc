@@ -0,0 +1,262 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file
+ * Hardware performance counters implementation
+ */
+
+#include <iostream>
+#include <mutex>
+
+#ifdef __linux__
+#include <unistd.h> // syscall(), read(), close()
+#include <sys/ioctl.h> // ioctl()
+#include <sys/syscall.h> // __NR_perf_event_open
+#include <linux/perf_event.h>
+#include <cstring> // memset
+#endif
+
+#include "perf_counters.h"
+
+using namespace std;
+
+const char* perf_event_name[NUM_PERF_EVENTS] = {
+	"CYCLES",
+	"INSTR",
+	"LLC_MISS",
+	"BR_MISS"
+};
+
+static bool g_perf_counters_enabled = false;
+
+bool perf_counters_enabled()
+{ return g_perf_counters_enabled; }
+
+void enable_perf_counters(bool enable)
+{
+	g_perf_counters_enabled = enable;
+	if (!enable)
+		return;
+
+	// open the counters for the calling thread right away, so that
+	// we can warn the user early if they are not available
+	if (!PerfCounterGroup::thread_instance().available())
+		cerr << "WARNING: hardware performance counters requested, "
+			"but not available (check /proc/sys/kernel/perf_event_paranoid)" << endl;
+}
+
+#ifdef __linux__
+// glibc does not provide a wrapper for perf_event_open
+static int perf_event_open(perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags)
+{
+	return syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+#endif
+
+PerfCounterGroup::PerfCounterGroup() :
+	m_leader(-1),
+	m_nslots(0)
+{
+	for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+		m_fd[e] = -1;
+		m_slot[e] = -1;
+	}
+
+#ifdef __linux__
+	// The generic PERF_COUNT_HW_CACHE_MISSES maps to last-level cache misses
+	// on the architectures we care about (see perf_event_open(2))
+	static const uint64_t config[NUM_PERF_EVENTS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config[e];
+		attr.read_format = PERF_FORMAT_GROUP |
+			PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		// we only care about user-space host code, and excluding the kernel
+		// allows access with the default perf_event_paranoid setting
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// the leader is created disabled, and enabled when the group is complete
+		attr.disabled = (m_leader < 0);
+
+		// pid 0, cpu -1: the calling thread, on any CPU
+		int fd = perf_event_open(&attr, 0, -1, m_leader, 0);
+		if (fd < 0)
+			continue;
+		m_fd[e] = fd;
+		m_slot[e] = m_nslots++;
+		if (m_leader < 0)
+			m_leader = fd;
+	}
+
+	if (m_leader >= 0) {
+		ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+#endif
+}
+
+PerfCounterGroup::~PerfCounterGroup()
+{
+#ifdef __linux__
+	for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+		if (m_fd[e] >= 0)
+			close(m_fd[e]);
+#endif
+}
+
+PerfCounterGroup& PerfCounterGroup::thread_instance()
+{
+	static thread_local PerfCounterGroup group;
+	return group;
+}
+
+PerfCounterSnapshot PerfCounterGroup::read() const
+{
+	PerfCounterSnapshot ret;
+#ifdef __linux__
+	if (m_leader < 0)
+		return ret;
+
+	// layout of the group read-out with PERF_FORMAT_GROUP and both
+	// PERF_FORMAT_TOTAL_TIME_* flags
+	struct {
+		uint64_t nr;
+		uint64_t time_enabled;
+		uint64_t time_running;
+		uint64_t values[NUM_PERF_EVENTS];
+	} data;
+
+	if (::read(m_leader, &data, sizeof(data)) < 0)
+		return ret;
+
+	ret.time_enabled = data.time_enabled;
+	ret.time_running = data.time_running;
+	for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+		if (m_slot[e] >= 0)
+			ret.count[e] = data.values[m_slot[e]];
+#endif
+	return ret;
+}
+
+PerfCounterValues perf_counters_delta(PerfCounterSnapshot const& start,
+	PerfCounterSnapshot const& stop)
+{
+	PerfCounterValues ret;
+
+	const uint64_t enabled = stop.time_enabled - start.time_enabled;
+	const uint64_t running = stop.time_running - start.time_running;
+	if (!running)
+		return ret;
+
+	// if the PMU was shared with other events, the counters were only running
+	// for part of the time, so scale them up to the whole enabled time
+	const double scale = running < enabled ? double(enabled)/running : 1.0;
+
+	for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+		if (stop.count[e] > start.count[e])
+			ret.count[e] = uint64_t((stop.count[e] - start.count[e])*scale);
+	return ret;
+}
+
+// registry of the named regions, and the mutex protecting it
+static map<string, PerfRegionStats> g_named_regions;
+static mutex g_named_regions_mutex;
+
+PerfRegion::PerfRegion(const char *name) :
+	m_stats(NULL)
+{
+	if (!g_perf_counters_enabled)
+		return;
+
+	{
+		lock_guard<mutex> lock(g_named_regions_mutex);
+		// std::map never invalidates pointers to its elements
+		m_stats = &g_named_regions[name];
+	}
+
+	m_start_counters = PerfCounterGroup::thread_instance().read();
+	m_start = PerfRegionStats::clock::now();
+}
+
+PerfRegion::~PerfRegion()
+{
+	if (!m_stats)
+		return;
+
+	const auto elapsed = PerfRegionStats::clock::now() - m_start;
+	const PerfCounterValues counters = perf_counters_delta(m_start_counters,
+		PerfCounterGroup::thread_instance().read());
+
+	lock_guard<mutex> lock(g_named_regions_mutex);
+	++m_stats->calls;
+	m_stats->tot_time += elapsed;
+	if (elapsed > m_stats->max_time)
+		m_stats->max_time = elapsed;
+	m_stats->counters += counters;
+}
+
+map<string, PerfRegionStats> const& perf_named_regions()
+{ return g_named_regions; }
+
+void reset_perf_named_regions()
+{
+	lock_guard<mutex> lock(g_named_regions_mutex);
+	g_named_regions.clear();
+}
+
+void print_perf_counters_header(ostream& out)
+{
+	for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+		out << "\t" << perf_event_name[e];
+	out << "\tIPC";
+}
+
+void print_perf_counters(ostream& out, PerfCounterValues const& values)
+{
+	PerfCounterGroup const& group = PerfCounterGroup::thread_instance();
+	for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+		out << "\t";
+		if (group.has(PerfEvent(e)))
+			out << values.count[e];
+		else
+			out << "-";
+	}
+	out << "\t";
+	if (group.has(PERF_CYCLES) && group.has(PERF_INSTRUCTIONS))
+		out << values.ipc();
+	else
+		out << "-";
+}
@@ -0,0 +1,212 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*! \file
+ * Hardware performance counters for host-side code
+ *
+ * This is a thin wrapper around the Linux perf_event_open(2) system call,
+ * used to collect hardware counters (cycles, instructions, last-level cache
+ * misses, branch misses) around host commands and named host regions.
+ * Counting is per-thread and only enabled when the benchmark_host_counters
+ * debug flag is set; on other platforms, or when the kernel refuses access
+ * to the counters (see /proc/sys/kernel/perf_event_paranoid), the counters
+ * are simply reported as unavailable.
+ */
+
+#ifndef _PERF_COUNTERS_H
+#define _PERF_COUNTERS_H
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+
+//! Hardware events we track
+enum PerfEvent {
+	PERF_CYCLES, ///< CPU cycles
+	PERF_INSTRUCTIONS, ///< retired instructions
+	PERF_LLC_MISSES, ///< last-level cache misses
+	PERF_BRANCH_MISSES, ///< mispredicted branches
+	NUM_PERF_EVENTS
+};
+
+//! Printable names of the tracked events
+extern const char* perf_event_name[NUM_PERF_EVENTS];
+
+//! A set of counter values
+struct PerfCounterValues
+{
+	uint64_t count[NUM_PERF_EVENTS];
+
+	PerfCounterValues()
+	{ reset(); }
+
+	void reset()
+	{
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+			count[e] = 0;
+	}
+
+	PerfCounterValues& operator+=(PerfCounterValues const& other)
+	{
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+			count[e] += other.count[e];
+		return *this;
+	}
+
+	//! Instructions per cycle
+	double ipc() const
+	{
+		return count[PERF_CYCLES] ?
+			double(count[PERF_INSTRUCTIONS])/count[PERF_CYCLES] : 0;
+	}
+};
+
+//! Raw read-out of the counter group
+/*! The counts are not scaled for multiplexing: since the fraction of time
+ * the counters are actually running changes between read-outs, the scaling
+ * can only be done on the difference between two snapshots, see
+ * perf_counters_delta()
+ */
+struct PerfCounterSnapshot
+{
+	uint64_t count[NUM_PERF_EVENTS];
+	uint64_t time_enabled; ///< time the group has been enabled
+	uint64_t time_running; ///< time the group has actually been counting
+
+	PerfCounterSnapshot() :
+		time_enabled(0), time_running(0)
+	{
+		for (int e = 0; e < NUM_PERF_EVENTS; ++e)
+			count[e] = 0;
+	}
+};
+
+//! Counter values between two snapshots, scaled for multiplexing
+/*! Each delta is scaled by the ratio of the enabled to the running time
+ * between the snapshots; if the counters were not running at all,
+ * the values are zero
+ */
+PerfCounterValues perf_counters_delta(PerfCounterSnapshot const& start,
+	PerfCounterSnapshot const& stop);
+
+//! Per-thread group of hardware counters
+/*! The counters are opened once per thread on first use, and left running;
+ * measurements are obtained as the difference between two snapshots,
+ * so that regions can be nested freely.
+ */
+class PerfCounterGroup
+{
+	int m_fd[NUM_PERF_EVENTS];
+	int m_leader;
+	// position of each event in the group read-out, or -1 if unavailable
+	int m_slot[NUM_PERF_EVENTS];
+	int m_nslots;
+
+	PerfCounterGroup();
+	~PerfCounterGroup();
+
+	PerfCounterGroup(PerfCounterGroup const&); // NOT implemented
+	void operator=(PerfCounterGroup const&); // NOT implemented
+
+public:
+	//! The counter group for the calling thread
+	static PerfCounterGroup& thread_instance();
+
+	//! Are hardware counters available at all?
+	bool available() const
+	{ return m_leader >= 0; }
+
+	//! Is the given event being counted?
+	bool has(PerfEvent e) const
+	{ return m_slot[e] >= 0; }
+
+	//! Take a snapshot of the raw counter values
+	PerfCounterSnapshot read() const;
+};
+
+//! Accumulated statistics for a command or named region
+struct PerfRegionStats
+{
+	using clock = std::chrono::steady_clock;
+	using duration = clock::duration;
+
+	unsigned long calls;
+	duration max_time;
+	duration tot_time;
+	PerfCounterValues counters;
+
+	PerfRegionStats() :
+		calls(0), max_time(0), tot_time(0), counters()
+	{}
+};
+
+//! Check if hardware counter collection is enabled
+bool perf_counters_enabled();
+
+//! Enable or disable hardware counter collection (process-wide)
+void enable_perf_counters(bool enable);
+
+//! Accumulate timing and counters for a named host region
+/*! Named regions are collected in a process-wide registry, so that
+ * they can be used from any translation unit (writers, problem setup, etc)
+ * without depending on the GPUSPH core. Use as:
+ *
+ *     {
+ *         PerfRegion region("VTKWriter::write");
+ *         ...
+ *     }
+ *
+ * When counter collection is disabled, the object does nothing.
+ */
+class PerfRegion
+{
+	PerfRegionStats *m_stats;
+	PerfCounterSnapshot m_start_counters;
+	PerfRegionStats::clock::time_point m_start;
+
+public:
+	//! Time into the region registered under the given name
+	PerfRegion(const char *name);
+
+	~PerfRegion();
+};
+
+//! Get the statistics for all the named regions
+std::map<std::string, PerfRegionStats> const& perf_named_regions();
+
+//! Reset the statistics for all the named regions
+void reset_perf_named_regions();
+
+//! Print the column headers for the hardware counters, tab-separated
+void print_perf_counters_header(std::ostream& out);
+
+//! Print the hardware counters from the given stats, tab-separated
+void print_perf_counters(std::ostream& out, PerfCounterValues const& values);
+
+#endif
@@ -49,6 +49,7 @@
 #include "STLMesh.h"
 #include "TopoCube.h"
 #include "GlobalData.h"
+#include "memory_accounting.h"
 
 #include "catalyst_select.opt"
 
@@ -87,9 +88,13 @@ ProblemAPI<1>::ProblemAPI(GlobalData *_gdata) : ProblemCore(_gdata)
 
 void ProblemAPI<1>::release_memory()
 {
-	m_fluidParts.clear();
-	m_boundaryParts.clear();
-	m_testpointParts.clear();
+	// swap with empty vectors, since clear() would keep the capacity
+	PointVect().swap(m_fluidParts);
+	PointVect().swap(m_boundaryParts);
+	PointVect().swap(m_testpointParts);
+	memory_account_set("host/setup/fluid parts", 0);
+	memory_account_set("host/setup/boundary parts", 0);
+	memory_account_set("host/setup/testpoint parts", 0);
 	// also cleanup object parts
 	for (size_t g = 0, num_geoms = m_geometries.size(); g < num_geoms; g++) {
 		if (m_geometries[g]->enabled)
@@ -1681,6 +1686,11 @@ int ProblemAPI<1>::fill_parts(bool fill)
 	// call user-set filtering routine, if any
 	filterPoints(m_fluidParts, m_boundaryParts);
 
+	// the point vectors are kept around until the problem is destroyed
+	memory_account_set("host/setup/fluid parts", m_fluidParts.capacity()*sizeof(Point));
+	memory_account_set("host/setup/boundary parts", m_boundaryParts.capacity()*sizeof(Point));
+	memory_account_set("host/setup/testpoint parts", m_testpointParts.capacity()*sizeof(Point));
+
 	return m_fluidParts.size() + m_boundaryParts.size() + m_testpointParts.size() +
 		bodies_parts_counter + hdf5file_parts_counter + xyzfile_parts_counter;
 }
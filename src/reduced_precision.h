@@ -0,0 +1,278 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Reduced-precision storage of buffer elements
+ *
+ * Some buffers (e.g. BUFFER_VORTICITY and BUFFER_NORMALS) are only consumed
+ * by the writers or by post-processing, and do not need to be stored in full
+ * single precision. This header provides the conversions between the
+ * (float) compute type and the 16-bit storage formats: IEEE half precision,
+ * bfloat16, and fixed point with a given scale.
+ * The storage precision of each buffer is set with SET_BUFFER_PRECISION
+ * (see buffer_traits.h and define_buffers.h).
+ */
+
+#ifndef _REDUCED_PRECISION_H
+#define _REDUCED_PRECISION_H
+
+#include <cuda_runtime.h>
+
+#include "common_types.h"
+
+//! Storage precision of a buffer
+enum StoragePrecision {
+	PRECISION_FP32, ///< full single precision (no conversion)
+	PRECISION_FP16, ///< IEEE 754 half precision
+	PRECISION_BF16, ///< bfloat16 (single precision truncated to 16 bits)
+	PRECISION_FIXED16 ///< 16-bit signed fixed point, value*scale
+};
+
+//! Bits of a float
+inline __host__ __device__ uint
+float_bits(float v)
+{
+	union { float f; uint u; } c;
+	c.f = v;
+	return c.u;
+}
+
+//! Float from its bits
+inline __host__ __device__ float
+bits_float(uint u)
+{
+	union { float f; uint u; } c;
+	c.u = u;
+	return c.f;
+}
+
+//! Convert a float to half precision, rounding to nearest even
+inline __host__ __device__ ushort
+float_to_half(float v)
+{
+	const uint u = float_bits(v);
+	const ushort sign = (u >> 16) & 0x8000;
+	const uint mag = u & 0x7fffffff;
+
+	// NaN (kept quiet) and infinity
+	if (mag >= 0x7f800000)
+		return sign | 0x7c00 | (mag > 0x7f800000 ? 0x200 : 0);
+	// overflow: anything rounding to 65520 or more
+	if (mag >= 0x477ff000)
+		return sign | 0x7c00;
+	// subnormal halfs (and zero)
+	if (mag < 0x38800000) {
+		// below half of the smallest subnormal
+		if (mag < 0x33000000)
+			return sign;
+		const uint exp = mag >> 23;
+		const uint mant = (mag & 0x7fffff) | 0x800000;
+		const uint shift = 126 - exp;
+		uint h = mant >> shift;
+		const uint rem = mant & ((1u << shift) - 1);
+		const uint halfway = 1u << (shift - 1);
+		if (rem > halfway || (rem == halfway && (h & 1)))
+			++h;
+		return sign | h;
+	}
+	// normal: rebias the exponent and round the mantissa
+	const uint h = (mag - 0x38000000) >> 13;
+	const uint rem = mag & 0x1fff;
+	return sign | (h + (rem > 0x1000 || (rem == 0x1000 && (h & 1))));
+}
+
+//! Convert a half precision value to float
+inline __host__ __device__ float
+half_to_float(ushort h)
+{
+	const uint sign = uint(h & 0x8000) << 16;
+	const uint exp = (h >> 10) & 0x1f;
+	uint mant = h & 0x3ff;
+
+	if (exp == 0x1f)
+		return bits_float(sign | 0x7f800000 | (mant << 13));
+	if (exp == 0) {
+		if (mant == 0)
+			return bits_float(sign);
+		// subnormal: normalize
+		int e = -1;
+		do {
+			++e;
+			mant <<= 1;
+		} while (!(mant & 0x400));
+		return bits_float(sign | ((112 - e) << 23) | ((mant & 0x3ff) << 13));
+	}
+	return bits_float(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+//! Convert a float to bfloat16, rounding to nearest even
+inline __host__ __device__ ushort
+float_to_bf16(float v)
+{
+	const uint u = float_bits(v);
+	// NaN: keep it quiet, rounding could turn it into an infinity
+	if ((u & 0x7fffffff) > 0x7f800000)
+		return (u >> 16) | 0x40;
+	return (u + 0x7fff + ((u >> 16) & 1)) >> 16;
+}
+
+//! Convert a bfloat16 value to float
+inline __host__ __device__ float
+bf16_to_float(ushort b)
+{
+	return bits_float(uint(b) << 16);
+}
+
+//! Conversion of a single component between float and its storage
+template<StoragePrecision P>
+struct precision_codec;
+
+template<>
+struct precision_codec<PRECISION_FP16>
+{
+	typedef ushort stored;
+	static __host__ __device__ stored encode(float v, float)
+	{ return float_to_half(v); }
+	static __host__ __device__ float decode(stored v, float)
+	{ return half_to_float(v); }
+};
+
+template<>
+struct precision_codec<PRECISION_BF16>
+{
+	typedef ushort stored;
+	static __host__ __device__ stored encode(float v, float)
+	{ return float_to_bf16(v); }
+	static __host__ __device__ float decode(stored v, float)
+	{ return bf16_to_float(v); }
+};
+
+/*! Values out of range are clamped, so that e.g. unit normals stored
+ * with scale 32767 saturate instead of wrapping around
+ */
+template<>
+struct precision_codec<PRECISION_FIXED16>
+{
+	typedef short stored;
+	static __host__ __device__ stored encode(float v, float scale)
+	{
+		const float s = rintf(v*scale);
+		return s >= 32767.0f ? 32767 : s <= -32767.0f ? -32767 :
+			s == s ? short(s) : 0;
+	}
+	static __host__ __device__ float decode(stored v, float scale)
+	{ return v/scale; }
+};
+
+//! Storage type of a float, float3 or float4 with the given precision
+template<typename T, StoragePrecision P>
+struct stored_type
+{ typedef T type; };
+
+template<StoragePrecision P>
+struct stored_type<float, P>
+{ typedef typename precision_codec<P>::stored type; };
+
+#define _STORED_VECTOR_TYPE(_vec, _precision, _stored) \
+template<> struct stored_type<_vec, _precision> \
+{ typedef _stored type; }
+
+_STORED_VECTOR_TYPE(float3, PRECISION_FP16, ushort3);
+_STORED_VECTOR_TYPE(float4, PRECISION_FP16, ushort4);
+_STORED_VECTOR_TYPE(float3, PRECISION_BF16, ushort3);
+_STORED_VECTOR_TYPE(float4, PRECISION_BF16, ushort4);
+_STORED_VECTOR_TYPE(float3, PRECISION_FIXED16, short3);
+_STORED_VECTOR_TYPE(float4, PRECISION_FIXED16, short4);
+
+#undef _STORED_VECTOR_TYPE
+
+template<>
+struct stored_type<float, PRECISION_FP32>
+{ typedef float type; };
+
+//! Storage type of T with precision P, for use in SET_BUFFER_TRAITS
+#define STORED_TYPE(T, P) stored_type<T, P>::type
+
+//! Conversion between the compute type and the storage type
+template<StoragePrecision P>
+struct precision_convert
+{
+	typedef precision_codec<P> codec;
+
+	template<typename S>
+	static __host__ __device__ void encode(S &dst, float v, float scale)
+	{ dst = codec::encode(v, scale); }
+	template<typename S>
+	static __host__ __device__ void encode(S &dst, float3 const& v, float scale)
+	{
+		dst.x = codec::encode(v.x, scale);
+		dst.y = codec::encode(v.y, scale);
+		dst.z = codec::encode(v.z, scale);
+	}
+	template<typename S>
+	static __host__ __device__ void encode(S &dst, float4 const& v, float scale)
+	{
+		dst.x = codec::encode(v.x, scale);
+		dst.y = codec::encode(v.y, scale);
+		dst.z = codec::encode(v.z, scale);
+		dst.w = codec::encode(v.w, scale);
+	}
+
+	template<typename S>
+	static __host__ __device__ void decode(float &dst, S const& v, float scale)
+	{ dst = codec::decode(v, scale); }
+	template<typename S>
+	static __host__ __device__ void decode(float3 &dst, S const& v, float scale)
+	{
+		dst.x = codec::decode(v.x, scale);
+		dst.y = codec::decode(v.y, scale);
+		dst.z = codec::decode(v.z, scale);
+	}
+	template<typename S>
+	static __host__ __device__ void decode(float4 &dst, S const& v, float scale)
+	{
+		dst.x = codec::decode(v.x, scale);
+		dst.y = codec::decode(v.y, scale);
+		dst.z = codec::decode(v.z, scale);
+		dst.w = codec::decode(v.w, scale);
+	}
+};
+
+//! Full precision: storage and compute types are the same
+template<>
+struct precision_convert<PRECISION_FP32>
+{
+	template<typename T>
+	static __host__ __device__ void encode(T &dst, T const& v, float)
+	{ dst = v; }
+	template<typename T>
+	static __host__ __device__ void decode(T &dst, T const& v, float)
+	{ dst = v; }
+};
+
+#endif
@@ -106,7 +106,7 @@ typedef struct SimParams {
 	 * \label{NEIB_FREQ}
 	 * TLT_NEIB_FREQ
 	 */
-	uint			buildneibsfreq;			///< Frequency (in iterations) of neighbor list rebuilding
+	uint			buildneibsfreq;			///< Frequency (in iterations) of neighbor list rebuilding; 0 to rebuild when needed, which requires nlexpansionfactor > 1 (see needs_new_neibs())
 	/*!
 	 * \inpsection{neighbours}
 	 * \default{256}
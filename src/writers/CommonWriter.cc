@@ -40,7 +40,8 @@
 using namespace std;
 
 CommonWriter::CommonWriter(const GlobalData *_gdata)
-	: Writer(_gdata)
+	: Writer(_gdata),
+	m_binary(_gdata->clOptions->binary_series)
 {
 	m_fname_sfx = ".txt";
 
@@ -50,6 +51,11 @@ CommonWriter::CommonWriter(const GlobalData *_gdata)
 
 	write_summary();
 
+	if (m_binary) {
+		open_series();
+		return;
+	}
+
 	// TODO only do this if energy writing is enabled
 	string energy_fn = open_data_file(m_energyfile, "energy");
 	if (m_energyfile) {
@@ -162,6 +168,94 @@ CommonWriter::CommonWriter(const GlobalData *_gdata)
 	}
 }
 
+void
+CommonWriter::open_series_file(TimeSeriesWriter &series, const char *base)
+{
+	open_data_file(series.stream(), base, string(), ".series");
+	series.write_header();
+}
+
+void
+CommonWriter::open_series()
+{
+	// same columns as the text files
+	const uint numFluids = m_problem->physparams()->numFluids();
+	m_energyseries.add_column("time", SERIES_FLOAT64);
+	for (uint fluid = 0; fluid < numFluids; ++fluid) {
+		m_energyseries.add_column("kinetic" + to_string(fluid), SERIES_FLOAT64);
+		m_energyseries.add_column("potential" + to_string(fluid), SERIES_FLOAT64);
+		m_energyseries.add_column("internal" + to_string(fluid), SERIES_FLOAT64);
+	}
+	m_energyseries.add_column("kineticNF", SERIES_FLOAT64);
+	m_energyseries.add_column("potentialNF", SERIES_FLOAT64);
+	m_energyseries.add_column("internalNF", SERIES_FLOAT64);
+	m_energyseries.add_column("total", SERIES_FLOAT64);
+	open_series_file(m_energyseries, "energy");
+
+	const size_t ngages = m_problem->simparams()->gage.size();
+	if (ngages > 0) {
+		m_WaveGageseries.add_column("time", SERIES_FLOAT64);
+		for (size_t gage = 0; gage < ngages; ++gage)
+			m_WaveGageseries.add_column("zgage" + to_string(gage), SERIES_FLOAT32);
+		open_series_file(m_WaveGageseries, "WaveGage");
+	}
+
+	static const char *xyz[] = { "_X", "_Y", "_Z" };
+
+	size_t nbodies = m_problem->simparams()->numbodies;
+	if (nbodies > 0) {
+		static const char *q[] = { "_1", "_I", "_J", "_K" };
+		m_objectseries.add_column("time", SERIES_FLOAT64);
+		for (size_t obj = 0; obj < nbodies; ++obj) {
+			const string sobj = to_string(obj);
+			m_objectseries.add_column("index" + sobj, SERIES_UINT32);
+			for (int c = 0; c < 3; ++c)
+				m_objectseries.add_column("CM" + sobj + xyz[c], SERIES_FLOAT64);
+			for (int c = 0; c < 4; ++c)
+				m_objectseries.add_column("Q" + sobj + q[c], SERIES_FLOAT64);
+		}
+		open_series_file(m_objectseries, "rbdata");
+	}
+
+	nbodies = m_problem->simparams()->numforcesbodies;
+	if (nbodies) {
+		static const char *kind[] = { "Computed_F", "Computed_M", "Applied_F", "Applied_M" };
+		m_objectforcesseries.add_column("time", SERIES_FLOAT64);
+		for (size_t obj = 0; obj < nbodies; ++obj) {
+			const string sobj = to_string(obj);
+			m_objectforcesseries.add_column("index" + sobj, SERIES_UINT32);
+			for (int k = 0; k < 4; ++k)
+				for (int c = 0; c < 3; ++c)
+					m_objectforcesseries.add_column(kind[k] + sobj + xyz[c], SERIES_FLOAT32);
+		}
+		open_series_file(m_objectforcesseries, "objectforces");
+	}
+
+	PostProcessEngineSet const& enabledPostProcess = gdata->simframework->getPostProcEngines();
+	const uint numOB = m_problem->simparams()->numOpenBoundaries;
+	if (numOB && enabledPostProcess.find(FLUX_COMPUTATION) != enabledPostProcess.end()) {
+		m_fluxseries.add_column("time", SERIES_FLOAT64);
+		for (uint i = 0; i < numOB; i++)
+			m_fluxseries.add_column("Flux_" + to_string(i), SERIES_FLOAT32);
+		open_series_file(m_fluxseries, "IOflux");
+	}
+
+	// the testpoints series is only opened on the first testpoints write
+	m_testpointsseries.add_column("T", SERIES_FLOAT64);
+	m_testpointsseries.add_column("ID", SERIES_UINT32);
+	m_testpointsseries.add_column("Pressure", SERIES_FLOAT32);
+	m_testpointsseries.add_column("Object", SERIES_UINT32);
+	m_testpointsseries.add_column("CellIndex", SERIES_UINT32);
+	m_testpointsseries.add_column("PosX", SERIES_FLOAT64);
+	m_testpointsseries.add_column("PosY", SERIES_FLOAT64);
+	m_testpointsseries.add_column("PosZ", SERIES_FLOAT64);
+	m_testpointsseries.add_column("VelX", SERIES_FLOAT32);
+	m_testpointsseries.add_column("VelY", SERIES_FLOAT32);
+	m_testpointsseries.add_column("VelZ", SERIES_FLOAT32);
+	m_testpointsseries.add_column("Tke", SERIES_FLOAT32);
+	m_testpointsseries.add_column("Eps", SERIES_FLOAT32);
+}
+
 CommonWriter::~CommonWriter()
 {
 	if (m_energyfile)
@@ -172,9 +266,11 @@ CommonWriter::~CommonWriter()
 		m_objectfile.close();
 	if (m_objectforcesfile)
 		m_objectforcesfile.close();
+	if (m_fluxfile)
+		m_fluxfile.close();
 }
 
-/// Write testpoints to CSV file
+/// Write testpoints to CSV file, or append them to the testpoints series
 void
 CommonWriter::write(uint numParts, BufferList const& buffers, uint node_offset, double t, const bool testpoints)
 {
@@ -191,6 +287,28 @@ CommonWriter::write(uint numParts, BufferList const& buffers, uint node_offset,
 	if (!info)
 		return; // this shouldn't happen, but whatever
 
+	if (m_binary) {
+		if (!m_testpointsseries)
+			open_series_file(m_testpointsseries, "testpoints");
+
+		for (uint i=node_offset; i < node_offset + numParts; i++) {
+			if (!TESTPOINT(info[i]))
+				continue;
+
+			m_testpointsseries << t
+				<< id(info[i])
+				<< vel[i].w
+				<< object(info[i])
+				<< cellHashFromParticleHash( particleHash[i] )
+				<< pos[i].x << pos[i].y << pos[i].z
+				<< vel[i].x << vel[i].y << vel[i].z
+				<< (tke ? tke[i] : 0.0f)
+				<< (eps ? eps[i] : 0.0f);
+			m_testpointsseries.end_record();
+		}
+		return;
+	}
+
 	ofstream testpoints_file;
 	string testpoints_fname = open_data_file(testpoints_file, "testpoints/testpoints", current_filenum(), ".csv");
 
@@ -226,6 +344,18 @@ void
 CommonWriter::write_energy(double t, double4 *energy)
 {
 	double total = 0;
+	if (m_energyseries) {
+		m_energyseries << t;
+		for (uint fluid = 0; fluid < m_problem->physparams()->numFluids(); ++fluid) {
+			m_energyseries << energy[fluid].x << energy[fluid].y << energy[fluid].z;
+			total += energy[fluid].x + energy[fluid].y + energy[fluid].z;
+		}
+		const double4 &nf = energy[MAX_FLUID_TYPES];
+		m_energyseries << nf.x << nf.y << nf.z;
+		total += nf.x + nf.y + nf.z;
+		m_energyseries << total;
+		m_energyseries.end_record();
+	}
 	if (m_energyfile) {
 		m_energyfile << t;
 		uint fluid = 0;
@@ -243,6 +373,12 @@ CommonWriter::write_energy(double t, double4 *energy)
 void
 CommonWriter::write_WaveGage(double t, GageList const& gage)
 {
+	if (m_WaveGageseries) {
+		m_WaveGageseries << t;
+		for (size_t i=0; i < gage.size(); i++)
+			m_WaveGageseries << gage[i].z;
+		m_WaveGageseries.end_record();
+	}
 	if (m_WaveGagefile) {
 		m_WaveGagefile << t;
 		for (size_t i=0; i < gage.size(); i++) {
@@ -255,6 +391,19 @@ CommonWriter::write_WaveGage(double t, GageList const& gage)
 void
 CommonWriter::write_objects(double t)
 {
+	if (m_objectseries) {
+		m_objectseries << t;
+		const MovingBodiesVect & mbvect = m_problem->get_mbvect();
+		for (vector<MovingBodyData *>::const_iterator it = mbvect.begin(); it != mbvect.end(); ++it) {
+			const MovingBodyData *mbdata = *it;
+			const double3 &crot = mbdata->kdata.crot;
+			const double4 q = mbdata->kdata.orientation.params();
+			m_objectseries << mbdata->index
+				<< crot.x << crot.y << crot.z
+				<< q.x << q.y << q.z << q.w;
+		}
+		m_objectseries.end_record();
+	}
 	if (m_objectfile) {
 		m_objectfile << t;
 		const MovingBodiesVect & mbvect = m_problem->get_mbvect();
@@ -273,6 +422,18 @@ CommonWriter::write_objectforces(double t, uint numobjects,
 		const float3* computedforces, const float3* computedtorques,
 		const float3* appliedforces, const float3* appliedtorques)
 {
+	if (m_objectforcesseries) {
+		const MovingBodiesVect & mbvect = m_problem->get_mbvect();
+		m_objectforcesseries << t;
+		for (uint i=0; i < numobjects; i++) {
+			m_objectforcesseries << mbvect[i]->index;
+			const float3 *vecs[] = { computedforces + i, computedtorques + i,
+				appliedforces + i, appliedtorques + i };
+			for (const float3 *v : vecs)
+				m_objectforcesseries << v->x << v->y << v->z;
+		}
+		m_objectforcesseries.end_record();
+	}
 	if (m_objectforcesfile) {
 		const MovingBodiesVect & mbvect = m_problem->get_mbvect();
 		m_objectforcesfile << t;
@@ -291,6 +452,12 @@ void
 CommonWriter::write_flux(double t, float *fluxes)
 {
 	uint numOB = m_problem->simparams()->numOpenBoundaries;
+	if (m_fluxseries) {
+		m_fluxseries << t;
+		for (uint i=0; i<numOB; i++)
+			m_fluxseries << fluxes[i];
+		m_fluxseries.end_record();
+	}
 	if (m_fluxfile) {
 		m_fluxfile << t;
 		for (uint i=0; i<numOB; i++)
@@ -351,7 +518,10 @@ CommonWriter::write_simparams(ostream &out)
 
 	out << " initial dt = " << SP->dt << endl;
 	out << " simulation end time = " << SP->tend << endl;
-	out << " neib list construction every " << SP->buildneibsfreq << " iterations" << endl;
+	if (SP->buildneibsfreq)
+		out << " neib list construction every " << SP->buildneibsfreq << " iterations" << endl;
+	else
+		out << " neib list construction when the particle displacement exceeds half the list skin" << endl;
 
 	/* Iterate over enabled filters, showing their name and frequency */
 	FilterFreqList const& enabledFilters = gdata->simframework->getFilterFreqList();
@@ -45,9 +45,18 @@
  *
  * This makes it easy to import these files into common tools, and trivial
  * to plot them with e.g. gnuplot
+ *
+ * With the --binary-series option, the same data is written instead
+ * as columnar binary time series (see TimeSeries.h), with the same
+ * column names, in .series files. The testpoints are then all appended
+ * to a single testpoints.series file, with one record per testpoint per
+ * write, rather than one CSV file per write.
+ * Binary series are much faster to load and to slice by time window
+ * for long simulations with frequent output.
  */
 
 #include "Writer.h"
+#include "TimeSeries.h"
 
 class CommonWriter : public Writer
 {
@@ -74,12 +83,26 @@ private:
 	void write_options(std::ostream &out);
 	void write_summary();
 
+	/* Set up the binary time series, instead of the text files */
+	void open_series();
+	/* Open the given time series file and write its header */
+	void open_series_file(TimeSeriesWriter &series, const char *base);
+
 	std::ofstream		m_energyfile;
 	std::ofstream		m_WaveGagefile;
 	std::ofstream		m_objectfile;
 	std::ofstream		m_objectforcesfile;
 	std::ofstream		m_fluxfile;
 
+	/* Binary time series, used instead of the text files with --binary-series */
+	bool				m_binary;
+	TimeSeriesWriter	m_energyseries;
+	TimeSeriesWriter	m_WaveGageseries;
+	TimeSeriesWriter	m_objectseries;
+	TimeSeriesWriter	m_objectforcesseries;
+	TimeSeriesWriter	m_fluxseries;
+	TimeSeriesWriter	m_testpointsseries;
+
 };
 #endif
 
@@ -30,6 +30,7 @@
 
 #include "CustomTextWriter.h"
 #include "GlobalData.h"
+#include "buffer_precision.h"
 
 using namespace std;
 
@@ -55,7 +56,9 @@ CustomTextWriter::write(uint numParts, BufferList const& buffers, uint node_offs
 	const double4 *pos = buffers.getData<BUFFER_POS_GLOBAL>();
 	const float4 *vel = buffers.getData<BUFFER_VEL>();
 	const particleinfo *info = buffers.getData<BUFFER_INFO>();
-	const float3 *vort = buffers.getData<BUFFER_VORTICITY>();
+	const DecodedBuffer<BUFFER_VORTICITY> vort_data(buffers.getData<BUFFER_VORTICITY>(),
+		node_offset + numParts);
+	const float3 *vort = vort_data;
 
 	ofstream fid;
 	string filename = open_data_file(fid, "PART", current_filenum());
@@ -28,6 +28,7 @@
 #include "DisplayWriter.h"
 
 #include "GlobalData.h"
+#include "buffer_precision.h"
 
 #include "VTKCPAdaptor.h"
 
@@ -78,8 +79,12 @@ DisplayWriter::buildGrid(uint numParts, BufferList const& buffers, uint node_off
 	const float4 *vol = buffers.getData<BUFFER_VOLUME>();
 	const float *sigma = buffers.getData<BUFFER_SIGMA>();
 	const particleinfo *info = buffers.getData<BUFFER_INFO>();
-	const float3 *vort = buffers.getData<BUFFER_VORTICITY>();
-	const float4 *normals = buffers.getData<BUFFER_NORMALS>();
+	const DecodedBuffer<BUFFER_VORTICITY> vort_data(buffers.getData<BUFFER_VORTICITY>(),
+		node_offset + numParts);
+	const float3 *vort = vort_data;
+	const DecodedBuffer<BUFFER_NORMALS> normals_data(buffers.getData<BUFFER_NORMALS>(),
+		node_offset + numParts);
+	const float4 *normals = normals_data;
 	const float4 *gradGamma = buffers.getData<BUFFER_GRADGAMMA>();
 	const float *tke = buffers.getData<BUFFER_TKE>();
 	const float *eps = buffers.getData<BUFFER_EPSILON>();
@@ -29,11 +29,38 @@ HotFile represents a hot-start file used to restart simulations.
 The file represents particle and other state.
 */
 
+#include <cerrno>
 #include <stdexcept>
+#include <cstring>
+
 #include "HotFile.h"
+#include "crc32c.h"
+#include "hash64.h"
+#include "float_codec.h"
+#include "mapped_file.h"
+#include "parallel_jobs.h"
 
 using namespace std;
 
+//! Alignment of the data blocks in v2 HotFiles
+#define HOTFILE_DATA_ALIGNMENT 4096
+
+//! Name of the TOC entry holding the moving bodies data
+#define HOTFILE_BODIES_ENTRY "__bodies"
+
+//! Size of the blocks delta HotFiles are made of
+#define HOTFILE_DELTA_BLOCK_SIZE (64*1024)
+
+//! Size of the chunks encoded data blocks are split into
+#define HOTFILE_CODEC_CHUNK_SIZE (1024*1024)
+
+//! Header of an encoded data block
+typedef struct {
+	ulong	raw_size;
+	uint	chunk_size;
+	uint	chunk_count;
+} encoded_block_t;
+
 /**
 HotFile buffer encoding.
 */
@@ -72,6 +99,112 @@ typedef struct {
 	float	reserved[10];
 } encoded_body_t;
 
+// encode the data of a moving body for storage
+static encoded_body_t
+encode_body(const GlobalData *gdata, const MovingBodyData *mbdata, uint numparts)
+{
+	encoded_body_t eb;
+	memset(&eb, 0, sizeof(eb));
+
+	eb.index = mbdata->index;
+	eb.id = mbdata->id;
+
+	eb.type = mbdata->type;
+	eb.numparts = numparts;
+
+	if (eb.type == MB_FLOATING || eb.type == MB_FORCES_MOVING) {
+		eb.firstindex = gdata->s_hRbFirstIndex[eb.id];
+		eb.lastindex = gdata->s_hRbLastIndex[eb.id];
+	}
+	else {
+		eb.firstindex = 0;
+		eb.lastindex = 0;
+	}
+
+	eb.crot[0] = mbdata->kdata.crot.x;
+	eb.crot[1] = mbdata->kdata.crot.y;
+	eb.crot[2] = mbdata->kdata.crot.z;
+
+	eb.lvel[0] = mbdata->kdata.lvel.x;
+	eb.lvel[1] = mbdata->kdata.lvel.y;
+	eb.lvel[2] = mbdata->kdata.lvel.z;
+
+	eb.avel[0] = mbdata->kdata.avel.x;
+	eb.avel[1] = mbdata->kdata.avel.y;
+	eb.avel[2] = mbdata->kdata.avel.z;
+
+	eb.orientation[0] = mbdata->kdata.orientation(0);
+	eb.orientation[1] = mbdata->kdata.orientation(1);
+	eb.orientation[2] = mbdata->kdata.orientation(2);
+	eb.orientation[3] = mbdata->kdata.orientation(3);
+
+	eb.initial_crot[0] = mbdata->initial_kdata.crot.x;
+	eb.initial_crot[1] = mbdata->initial_kdata.crot.y;
+	eb.initial_crot[2] = mbdata->initial_kdata.crot.z;
+
+	eb.initial_lvel[0] = mbdata->initial_kdata.lvel.x;
+	eb.initial_lvel[1] = mbdata->initial_kdata.lvel.y;
+	eb.initial_lvel[2] = mbdata->initial_kdata.lvel.z;
+
+	eb.initial_avel[0] = mbdata->initial_kdata.avel.x;
+	eb.initial_avel[1] = mbdata->initial_kdata.avel.y;
+	eb.initial_avel[2] = mbdata->initial_kdata.avel.z;
+
+	eb.initial_orientation[0] = mbdata->initial_kdata.orientation(0);
+	eb.initial_orientation[1] = mbdata->initial_kdata.orientation(1);
+	eb.initial_orientation[2] = mbdata->initial_kdata.orientation(2);
+	eb.initial_orientation[3] = mbdata->initial_kdata.orientation(3);
+
+	return eb;
+}
+
+// restore a moving body from its stored data
+static void
+restore_body(const GlobalData *gdata, encoded_body_t const& eb)
+{
+	MovingBodyData mbdata;
+
+	mbdata.index = eb.index;
+	mbdata.id = eb.id;
+	mbdata.type = eb.type;
+
+	mbdata.kdata.crot.x = eb.crot[0];
+	mbdata.kdata.crot.y = eb.crot[1];
+	mbdata.kdata.crot.z = eb.crot[2];
+
+	mbdata.kdata.lvel.x = eb.lvel[0];
+	mbdata.kdata.lvel.y = eb.lvel[1];
+	mbdata.kdata.lvel.z = eb.lvel[2];
+
+	mbdata.kdata.avel.x = eb.avel[0];
+	mbdata.kdata.avel.y = eb.avel[1];
+	mbdata.kdata.avel.z = eb.avel[2];
+
+	mbdata.kdata.orientation(0) = eb.orientation[0];
+	mbdata.kdata.orientation(1) = eb.orientation[1];
+	mbdata.kdata.orientation(2) = eb.orientation[2];
+	mbdata.kdata.orientation(3) = eb.orientation[3];
+
+	mbdata.initial_kdata.crot.x = eb.initial_crot[0];
+	mbdata.initial_kdata.crot.y = eb.initial_crot[1];
+	mbdata.initial_kdata.crot.z = eb.initial_crot[2];
+
+	mbdata.initial_kdata.lvel.x = eb.initial_lvel[0];
+	mbdata.initial_kdata.lvel.y = eb.initial_lvel[1];
+	mbdata.initial_kdata.lvel.z = eb.initial_lvel[2];
+
+	mbdata.initial_kdata.avel.x = eb.initial_avel[0];
+	mbdata.initial_kdata.avel.y = eb.initial_avel[1];
+	mbdata.initial_kdata.avel.z = eb.initial_avel[2];
+
+	mbdata.initial_kdata.orientation(0) = eb.orientation[0];
+	mbdata.initial_kdata.orientation(1) = eb.orientation[1];
+	mbdata.initial_kdata.orientation(2) = eb.orientation[2];
+	mbdata.initial_kdata.orientation(3) = eb.orientation[3];
+
+	gdata->problem->restore_moving_body(mbdata, eb.numparts, eb.firstindex, eb.lastindex);
+}
+
 HotFile::HotFile(ofstream &fp, const GlobalData *gdata, uint numParts,
 	uint node_offset, double t, const bool testpoints) {
 	_fp.out = &fp;
@@ -80,14 +213,29 @@ HotFile::HotFile(ofstream &fp, const GlobalData *gdata, uint numParts,
 	_node_offset = node_offset;
 	_t = t;
 	_testpoints = testpoints;
+	_codec = HOTFILE_RAW;
 }
 
-HotFile::HotFile(ifstream &fp, const GlobalData *gdata) {
+HotFile::HotFile(ifstream &fp, const GlobalData *gdata, string const& filename) {
 	_fp.in = &fp;
 	_gdata = gdata;
+	_filename = filename;
+	_codec = HOTFILE_RAW;
+}
+
+// round offset up to the next multiple of the v2 data alignment
+static ulong
+align_offset(ulong offset)
+{
+	return (offset + HOTFILE_DATA_ALIGNMENT - 1)/HOTFILE_DATA_ALIGNMENT*HOTFILE_DATA_ALIGNMENT;
 }
 
-void HotFile::save() {
+void HotFile::save(version_t version) {
+	if (version == VERSION_2) {
+		save_v2();
+		return;
+	}
+
 	// write a header
 	writeHeader(_fp.out, VERSION_1);
 
@@ -132,7 +280,604 @@ check_counts_match(const char* what, size_t hf_count, size_t sim_count)
 }
 
 
+void HotFile::prepare_v2(vector<const void*> &data) {
+	const flag_t skip_bufs = EPHEMERAL_BUFFERS;
+	const uint body_count = _gdata->problem->simparams()->numbodies;
+
+	data.clear();
+	_toc.clear();
+
+	uint buffer_count = 0;
+	for (auto& iter : _gdata->s_hBuffers) {
+		if (iter.first & skip_bufs)
+			continue;
+
+		const AbstractBuffer *buffer = iter.second.get();
+		const uint array_count = buffer->get_array_count();
+		for (uint i = 0; i < array_count; ++i) {
+			toc_entry_t entry;
+			memset(&entry, 0, sizeof(entry));
+			strncpy(entry.name, buffer->get_buffer_name(), sizeof(entry.name) - 1);
+			entry.element_size = buffer->get_element_size();
+			entry.array_count = array_count;
+			entry.array_index = i;
+			entry.size = ulong(entry.element_size)*_particle_count;
+			_toc.push_back(entry);
+			data.push_back(buffer->get_offset_buffer(i, _node_offset));
+		}
+		++buffer_count;
+	}
+
+	_bodies.resize(body_count*sizeof(encoded_body_t));
+	for (uint id = 0; id < body_count; ++id) {
+		MovingBodyData *mbdata = _gdata->problem->m_bodies[id];
+		const uint numparts = mbdata->object->GetNumParts();
+		const encoded_body_t eb = encode_body(_gdata, mbdata, numparts);
+		memcpy(&_bodies[id*sizeof(encoded_body_t)], &eb, sizeof(eb));
+	}
+	if (body_count > 0) {
+		toc_entry_t entry;
+		memset(&entry, 0, sizeof(entry));
+		strcpy(entry.name, HOTFILE_BODIES_ENTRY);
+		entry.element_size = sizeof(encoded_body_t);
+		entry.array_count = 1;
+		entry.size = _bodies.size();
+		_toc.push_back(entry);
+		data.push_back(_bodies.data());
+	}
+
+	memset(&_header, 0, sizeof(_header));
+	_header.version = 2;
+	_header.buffer_count = buffer_count;
+	_header.particle_count = _particle_count;
+	_header.body_count = body_count;
+	_header.numOpenBoundaries = _gdata->problem->simparams()->numOpenBoundaries;
+	_header.toc_count = _toc.size();
+	_header.data_alignment = HOTFILE_DATA_ALIGNMENT;
+	_header.iterations = _gdata->iterations;
+	_header.dt = _gdata->dt;
+	_header.t = _gdata->t;
+
+	layout_v2();
+}
+
+void HotFile::layout_v2() {
+	// lay out the data blocks after the header and TOC
+	ulong offset = sizeof(header_t) + _toc.size()*sizeof(toc_entry_t);
+	for (auto& entry : _toc) {
+		entry.offset = align_offset(offset);
+		offset = entry.offset + entry.size;
+	}
+	_header.toc_count = _toc.size();
+}
+
+// is the given entry one of the buffer arrays (or deltas thereof)?
+static bool
+is_buffer_entry(toc_entry_t const& entry)
+{
+	return strcmp(entry.name, HOTFILE_BODIES_ENTRY) && strcmp(entry.name, HOTFILE_PARENT_ENTRY);
+}
+
+void HotFile::encode_v2(vector<const void*> &data, vector<vector<char>> &storage) {
+	// a chunk to be encoded
+	struct chunk_job {
+		size_t entry;
+		ulong begin;
+		ulong size;
+		vector<char> encoded;
+	};
+
+	vector<chunk_job> jobs;
+	vector<size_t> first_job(_toc.size() + 1);
+	for (size_t e = 0; e < _toc.size(); ++e) {
+		first_job[e] = jobs.size();
+		toc_entry_t const& entry = _toc[e];
+		if (!data[e] || !is_buffer_entry(entry))
+			continue;
+		const ulong es = max(entry.element_size, 1U);
+		const ulong chunk_size = max(es, HOTFILE_CODEC_CHUNK_SIZE/es*es);
+		for (ulong begin = 0; begin < entry.size; begin += chunk_size)
+			jobs.push_back(chunk_job{e, begin, min(chunk_size, entry.size - begin), vector<char>()});
+	}
+	first_job[_toc.size()] = jobs.size();
+
+	parallel_jobs(jobs.size(), [&](size_t j) {
+		chunk_job& job = jobs[j];
+		const char *src = (const char*)data[job.entry] + job.begin;
+		if (!float_codec_encode(src, job.size, _toc[job.entry].element_size, job.encoded))
+			job.encoded.assign(src, src + job.size);
+	});
+
+	// checksum of the decoded data, to verify the decoding on load
+	parallel_jobs(_toc.size(), [&](size_t e) {
+		if (first_job[e] < first_job[e+1])
+			_toc[e].raw_checksum = crc32c(data[e], _toc[e].size);
+	});
+
+	storage.resize(_toc.size());
+	for (size_t e = 0; e < _toc.size(); ++e) {
+		const size_t count = first_job[e+1] - first_job[e];
+		if (count == 0)
+			continue;
+
+		ulong encoded_size = 0;
+		for (size_t j = first_job[e]; j < first_job[e+1]; ++j)
+			encoded_size += jobs[j].encoded.size();
+		const ulong index_size = sizeof(encoded_block_t) + count*sizeof(ulong);
+		// not worth it
+		if (index_size + encoded_size >= _toc[e].size)
+			continue;
+
+		encoded_block_t header;
+		memset(&header, 0, sizeof(header));
+		header.raw_size = _toc[e].size;
+		header.chunk_size = jobs[first_job[e]].size;
+		header.chunk_count = count;
+
+		vector<char>& block = storage[e];
+		block.resize(index_size);
+		memcpy(block.data(), &header, sizeof(header));
+		ulong *chunk_end = (ulong*)(block.data() + sizeof(header));
+		ulong end = 0;
+		for (size_t j = first_job[e]; j < first_job[e+1]; ++j) {
+			end += jobs[j].encoded.size();
+			chunk_end[j - first_job[e]] = end;
+		}
+		for (size_t j = first_job[e]; j < first_job[e+1]; ++j) {
+			block.insert(block.end(), jobs[j].encoded.begin(), jobs[j].encoded.end());
+			vector<char>().swap(jobs[j].encoded);
+		}
+
+		_toc[e].codec = _codec;
+		_toc[e].size = block.size();
+		data[e] = block.data();
+	}
+
+	layout_v2();
+}
+
+void HotFile::write_v2(vector<const void*> const& raw_data) {
+	// a missing block would make the file impossible to load
+	for (size_t e = 0; e < _toc.size(); ++e)
+		if (raw_data[e] == NULL && _toc[e].size > 0)
+			throw runtime_error("NULL buffer " + to_string(_toc[e].array_index) +
+				" for " + _toc[e].name + " in HotWriter");
+
+	vector<const void*> data(raw_data);
+	vector<vector<char>> encoded;
+	if (_codec != HOTFILE_RAW)
+		encode_v2(data, encoded);
+
+	// checksum the data blocks
+	parallel_jobs(_toc.size(), [&](size_t e) {
+		_toc[e].checksum = data[e] ? crc32c(data[e], _toc[e].size) : 0;
+	});
+	_header.toc_checksum = crc32c(_toc.data(), _toc.size()*sizeof(toc_entry_t));
+
+	ofstream *fp = _fp.out;
+	fp->write((const char*)&_header, sizeof(_header));
+	fp->write((const char*)_toc.data(), _toc.size()*sizeof(toc_entry_t));
+
+	static const char padding[HOTFILE_DATA_ALIGNMENT] = {0};
+	ulong offset = sizeof(header_t) + _toc.size()*sizeof(toc_entry_t);
+	for (size_t e = 0; e < _toc.size(); ++e) {
+		fp->write(padding, _toc[e].offset - offset);
+		fp->write((const char*)data[e], _toc[e].size);
+		offset = _toc[e].offset + _toc[e].size;
+	}
+
+	// a short write (e.g. a full disk) must not go unnoticed
+	fp->flush();
+	if (fp->fail())
+		throw runtime_error("failed to write the HotFile data: " + string(strerror(errno)));
+}
+
+void HotFile::collect_v2(vector<const void*> &data) {
+	if (!_snapshot) {
+		prepare_v2(data);
+		return;
+	}
+
+	// blocks are stored in the snapshot at their file offset,
+	// relative to the first one
+	data.clear();
+	const ulong base = _toc.empty() ? 0 : _toc.front().offset;
+	for (auto const& entry : _toc)
+		data.push_back(_snapshot.get() + (entry.offset - base));
+}
+
+void HotFile::save_v2() {
+	vector<const void*> data;
+	collect_v2(data);
+	write_v2(data);
+}
+
+bool HotFile::save_incremental(HotFileBlockHashes &hashes, string const& parent) {
+	vector<const void*> data;
+	collect_v2(data);
+
+	const ulong block_size = HOTFILE_DELTA_BLOCK_SIZE;
+	const size_t num_entries = _toc.size();
+
+	vector<pair<string, uint>> keys;
+	for (auto const& entry : _toc)
+		keys.push_back(make_pair(string(entry.name), entry.array_index));
+
+	// hash the blocks of all the buffer arrays; the bodies data is small,
+	// and always saved in full
+	vector<vector<uint64_t>> entry_hashes(num_entries);
+	parallel_jobs(num_entries, [&](size_t e) {
+		const toc_entry_t& entry = _toc[e];
+		if (!data[e] || !strcmp(entry.name, HOTFILE_BODIES_ENTRY))
+			return;
+		const char *src = (const char*)data[e];
+		const ulong num_blocks = (entry.size + block_size - 1)/block_size;
+		entry_hashes[e].resize(num_blocks);
+		for (ulong b = 0; b < num_blocks; ++b)
+			entry_hashes[e][b] = hash64(src + b*block_size, min(block_size, entry.size - b*block_size));
+	});
+
+	// we can only save a delta if the parent has the same layout
+	bool delta = !parent.empty() &&
+		hashes.particle_count == _particle_count &&
+		hashes.block_size == block_size;
+	for (size_t e = 0; delta && e < num_entries; ++e) {
+		if (!strcmp(_toc[e].name, HOTFILE_BODIES_ENTRY))
+			continue;
+		auto found = hashes.blocks.find(keys[e]);
+		delta = data[e] && found != hashes.blocks.end() &&
+			found->second.size() == entry_hashes[e].size();
+	}
+
+	_header.block_size = block_size;
+
+	if (!delta) {
+		write_v2(data);
+	} else {
+		// replace each entry with its changed blocks, dropping the ones
+		// that did not change at all
+		vector<toc_entry_t> delta_toc;
+		vector<vector<char>> regions;
+		for (size_t e = 0; e < num_entries; ++e) {
+			toc_entry_t entry = _toc[e];
+			const char *src = (const char*)data[e];
+			if (!strcmp(entry.name, HOTFILE_BODIES_ENTRY)) {
+				regions.push_back(vector<char>(src, src + entry.size));
+				delta_toc.push_back(entry);
+				continue;
+			}
+
+			vector<uint64_t> const& old_hashes = hashes.blocks.at(keys[e]);
+			vector<uint> changed;
+			for (size_t b = 0; b < old_hashes.size(); ++b)
+				if (old_hashes[b] != entry_hashes[e][b])
+					changed.push_back(b);
+			if (changed.empty())
+				continue;
+
+			ulong changed_bytes = 0;
+			for (uint b : changed)
+				changed_bytes += min(block_size, entry.size - b*block_size);
+
+			const ulong index_bytes = (changed.size() + 1)*sizeof(uint);
+			vector<char> region(index_bytes + changed_bytes);
+			const uint count = changed.size();
+			memcpy(region.data(), &count, sizeof(count));
+			memcpy(region.data() + sizeof(count), changed.data(), count*sizeof(uint));
+			char *dst = region.data() + index_bytes;
+			for (uint b : changed) {
+				const ulong bytes = min(block_size, entry.size - b*block_size);
+				memcpy(dst, src + b*block_size, bytes);
+				dst += bytes;
+			}
+
+			entry.size = region.size();
+			regions.push_back(move(region));
+			delta_toc.push_back(entry);
+		}
+
+		// name the parent; it is always in the same directory
+		const string parent_name = parent.substr(parent.find_last_of('/') + 1);
+		toc_entry_t entry;
+		memset(&entry, 0, sizeof(entry));
+		strcpy(entry.name, HOTFILE_PARENT_ENTRY);
+		entry.element_size = 1;
+		entry.array_count = 1;
+		entry.size = parent_name.size();
+		delta_toc.push_back(entry);
+		regions.push_back(vector<char>(parent_name.begin(), parent_name.end()));
+
+		// the snapshot is not needed anymore
+		_snapshot.reset();
+
+		_toc.swap(delta_toc);
+		_header.flags |= HOTFILE_DELTA;
+		layout_v2();
+
+		vector<const void*> delta_data;
+		for (auto const& region : regions)
+			delta_data.push_back(region.data());
+		write_v2(delta_data);
+	}
+
+	hashes.particle_count = _particle_count;
+	hashes.block_size = block_size;
+	hashes.blocks.clear();
+	for (size_t e = 0; e < num_entries; ++e)
+		if (!entry_hashes[e].empty())
+			hashes.blocks[keys[e]].swap(entry_hashes[e]);
+
+	return delta;
+}
+
+void HotFile::snapshot() {
+	vector<const void*> data;
+	prepare_v2(data);
+
+	const ulong base = _toc.empty() ? 0 : _toc.front().offset;
+	const ulong end = _toc.empty() ? 0 : _toc.back().offset + _toc.back().size;
+	// not value-initialized: the gaps between the blocks are never read
+	_snapshot.reset(new char[end - base]);
+
+	parallel_jobs(_toc.size(), [&](size_t e) {
+		char *dst = _snapshot.get() + (_toc[e].offset - base);
+		if (data[e])
+			memcpy(dst, data[e], _toc[e].size);
+		else
+			memset(dst, 0, _toc[e].size);
+	});
+}
+
+const toc_entry_t *HotFile::find_entry(const char *name, uint array_index) const
+{
+	for (auto const& entry : _toc)
+		if (entry.array_index == array_index && !strncmp(entry.name, name, sizeof(entry.name)))
+			return &entry;
+	return NULL;
+}
+
+// auxiliary method that throws an exception about a corrupted block
+static void
+checksum_mismatch(toc_entry_t const& entry)
+{
+	ostringstream os;
+	os << "HotFile checksum mismatch for " << entry.name << "[" << entry.array_index << "]";
+	throw runtime_error(os.str());
+}
+
+vector<char> HotFile::read_entry(toc_entry_t const& entry) {
+	vector<char> data(entry.size);
+	_fp.in->seekg(entry.offset);
+	_fp.in->read(data.data(), entry.size);
+	if (crc32c(data.data(), entry.size) != entry.checksum)
+		checksum_mismatch(entry);
+	return data;
+}
+
+// size of the decoded data of the given entry
+static ulong
+decoded_size(toc_entry_t const& entry, const char *src)
+{
+	if (entry.codec == HOTFILE_RAW)
+		return entry.size;
+	if (entry.size < sizeof(encoded_block_t))
+		checksum_mismatch(entry);
+	encoded_block_t header;
+	memcpy(&header, src, sizeof(header));
+	return header.raw_size;
+}
+
+// decode the data block of the given entry into dst, that must hold
+// decoded_size() bytes
+static void
+decode_entry(toc_entry_t const& entry, const char *src, char *dst)
+{
+	if (entry.codec == HOTFILE_RAW) {
+		memcpy(dst, src, entry.size);
+		return;
+	}
+	if (entry.codec != HOTFILE_XOR_SHUFFLE) {
+		ostringstream os;
+		os << "unsupported HotFile encoding " << entry.codec << " for "
+			<< entry.name << "[" << entry.array_index << "]";
+		throw runtime_error(os.str());
+	}
+
+	encoded_block_t header;
+	memcpy(&header, src, sizeof(header));
+	const ulong index_size = sizeof(header) + ulong(header.chunk_count)*sizeof(ulong);
+	if (entry.size < index_size || header.chunk_size == 0 ||
+		(header.raw_size + header.chunk_size - 1)/header.chunk_size != header.chunk_count)
+		checksum_mismatch(entry);
+	const ulong *chunk_end = (const ulong*)(src + sizeof(header));
+	const char *chunks = src + index_size;
+	const ulong chunks_size = entry.size - index_size;
+
+	try {
+		ulong begin = 0;
+		for (uint c = 0; c < header.chunk_count; ++c) {
+			const ulong end = chunk_end[c];
+			if (end < begin || end > chunks_size)
+				checksum_mismatch(entry);
+			const ulong raw_begin = ulong(c)*header.chunk_size;
+			const ulong raw_size = min(ulong(header.chunk_size), header.raw_size - raw_begin);
+			if (end - begin == raw_size)
+				memcpy(dst + raw_begin, chunks + begin, raw_size);
+			else
+				float_codec_decode(chunks + begin, end - begin, dst + raw_begin,
+					raw_size, entry.element_size);
+			begin = end;
+		}
+	} catch (runtime_error const&) {
+		checksum_mismatch(entry);
+	}
+
+	if (crc32c(dst, header.raw_size) != entry.raw_checksum)
+		checksum_mismatch(entry);
+}
+
+// apply the changed blocks stored in (the decoded data of) a delta entry
+// to the full array
+static void
+apply_delta(toc_entry_t const& entry, const char *src, ulong src_size,
+	char *dst, ulong full_size, ulong block_size)
+{
+	const ulong num_blocks = (full_size + block_size - 1)/block_size;
+	uint count = 0;
+	if (src_size >= sizeof(count))
+		memcpy(&count, src, sizeof(count));
+	const ulong index_bytes = (ulong(count) + 1)*sizeof(uint);
+	if (src_size < index_bytes)
+		checksum_mismatch(entry);
+
+	const uint *indices = (const uint*)(src + sizeof(count));
+	src += index_bytes;
+	const char *end = src + (src_size - index_bytes);
+	for (uint c = 0; c < count; ++c) {
+		const ulong b = indices[c];
+		if (b >= num_blocks)
+			checksum_mismatch(entry);
+		const ulong bytes = min(block_size, full_size - b*block_size);
+		if (src + bytes > end)
+			checksum_mismatch(entry);
+		memcpy(dst + b*block_size, src, bytes);
+		src += bytes;
+	}
+}
+
+void HotFile::load_buffers_v2(vector<char> *bodies) {
+	const bool delta = _header.flags & HOTFILE_DELTA;
+
+	if (delta) {
+		// load the parent first, then apply our blocks on top of it
+		const toc_entry_t *parent_entry = find_entry(HOTFILE_PARENT_ENTRY, 0);
+		if (!parent_entry || _filename.empty())
+			throw runtime_error("cannot find the parent of delta HotFile " + _filename);
+		const vector<char> parent_name = read_entry(*parent_entry);
+		const size_t dir_end = _filename.find_last_of('/');
+		const string parent_fname = (dir_end == string::npos ? string() : _filename.substr(0, dir_end + 1)) +
+			string(parent_name.begin(), parent_name.end());
+
+		ifstream parent_fp(parent_fname.c_str(), ios::binary);
+		if (!parent_fp)
+			throw runtime_error("cannot open " + parent_fname + ", needed by delta HotFile " + _filename);
+		parent_fp.exceptions(ifstream::failbit | ifstream::badbit | ifstream::eofbit);
+		HotFile parent(parent_fp, _gdata, parent_fname);
+		uint part_count = _node_offset, numOpenBoundaries = 0;
+		parent.readHeader(part_count, numOpenBoundaries);
+		check_counts_match("parent particle", parent._particle_count, _particle_count);
+		cout << "Replaying " << parent_fname << " ..." << endl;
+		parent.load_buffers_v2(NULL);
+	}
+
+	const flag_t skip_bufs = EPHEMERAL_BUFFERS;
+
+	// the copies to be done: destination and TOC entry
+	vector<pair<void*, const toc_entry_t*>> copies;
+
+	for (auto& iter : _gdata->s_hBuffers) {
+		if (iter.first & skip_bufs)
+			continue;
+
+		AbstractBuffer *buffer = iter.second.get();
+		const uint array_count = buffer->get_array_count();
+		for (uint i = 0; i < array_count; ++i) {
+			const toc_entry_t *entry = find_entry(buffer->get_buffer_name(), i);
+			if (!entry) {
+				// the first array is mandatory, the others may be missing
+				// if the buffer had fewer components when the file was saved;
+				// delta files only hold the arrays that changed
+				if (i == 0 && !delta)
+					throw runtime_error(string("HotFile has no data for buffer ") +
+						buffer->get_buffer_name());
+				continue;
+			}
+			check_counts_match("element size", entry->element_size, buffer->get_element_size());
+			copies.push_back(make_pair(buffer->get_offset_buffer(i, _node_offset), entry));
+		}
+	}
+
+	const toc_entry_t *bodies_entry = NULL;
+	if (bodies && _header.body_count > 0) {
+		bodies_entry = find_entry(HOTFILE_BODIES_ENTRY, 0);
+		if (!bodies_entry)
+			throw runtime_error("HotFile has no data for the moving bodies");
+		check_counts_match("bodies data size", bodies_entry->size,
+			sizeof(encoded_body_t)*_header.body_count);
+		bodies->resize(bodies_entry->size);
+		copies.push_back(make_pair((void*)bodies->data(), bodies_entry));
+	}
+
+	// decode the data of the given entry into its destination
+	auto decode_copy = [&](toc_entry_t const& entry, const char *src, char *dst) {
+		const ulong full_size = ulong(entry.element_size)*_particle_count;
+		const ulong size = decoded_size(entry, src);
+		if (delta && &entry != bodies_entry) {
+			vector<char> decoded;
+			if (entry.codec != HOTFILE_RAW) {
+				decoded.resize(size);
+				decode_entry(entry, src, decoded.data());
+				src = decoded.data();
+			}
+			apply_delta(entry, src, size, dst, full_size, _header.block_size);
+		} else {
+			if (&entry != bodies_entry)
+				check_counts_match("data size", size, full_size);
+			decode_entry(entry, src, dst);
+		}
+	};
+
+	if (!_filename.empty()) {
+		// copy the blocks from the mapped file, in parallel
+		MappedFile mapped(_filename);
+		for (auto const& copy : copies)
+			if (copy.second->offset + copy.second->size > mapped.size())
+				throw runtime_error("truncated HotFile " + _filename);
+
+		parallel_jobs(copies.size(), [&](size_t c) {
+			const toc_entry_t& entry = *copies[c].second;
+			const char *src = mapped.data() + entry.offset;
+			if (crc32c(src, entry.size) != entry.checksum)
+				checksum_mismatch(entry);
+			decode_copy(entry, src, (char*)copies[c].first);
+		});
+	} else {
+		// delta files always have a filename (see above)
+		for (auto const& copy : copies) {
+			const vector<char> data = read_entry(*copy.second);
+			decode_copy(*copy.second, data.data(), (char*)copy.first);
+		}
+	}
+}
+
+void HotFile::load_v2() {
+	check_counts_match("body", _header.body_count, _gdata->problem->simparams()->numbodies);
+
+	vector<char> bodies;
+	load_buffers_v2(&bodies);
+
+	const flag_t skip_bufs = EPHEMERAL_BUFFERS;
+	for (auto& iter : _gdata->s_hBuffers) {
+		if (iter.first & skip_bufs)
+			continue;
+		const auto& buf = iter.second;
+		buf->set_state("resumed");
+		buf->mark_valid();
+	}
+
+	const encoded_body_t *eb = (const encoded_body_t*)bodies.data();
+	for (uint b = 0; b < _header.body_count; ++b) {
+		cout << "Restoring body #" << b << " ..." << endl;
+		restore_body(_gdata, eb[b]);
+	}
+}
+
 void HotFile::load() {
+	if (_header.version == 2) {
+		load_v2();
+		return;
+	}
+
 	// read header
 
 	//// TODO FIXME multinode should take into account per-rank particles
@@ -206,11 +951,19 @@ void HotFile::readHeader(uint &part_count, uint &numOpenBoundaries) {
 	// read and check version
 	uint v;
 	_fp.in->read((char*)&v, sizeof(v));
-	if (v != 1)
+	if (v != 1 && v != 2)
 		unsupported_version(v);
 
 	_fp.in->seekg(0); // rewind
 	_fp.in->read((char*)&_header, sizeof(_header));
+
+	if (v == 2) {
+		_toc.resize(_header.toc_count);
+		_fp.in->read((char*)_toc.data(), _toc.size()*sizeof(toc_entry_t));
+		if (crc32c(_toc.data(), _toc.size()*sizeof(toc_entry_t)) != _header.toc_checksum)
+			throw runtime_error("HotFile table of contents checksum mismatch");
+	}
+
 	_particle_count = _header.particle_count;
 	numOpenBoundaries = _header.numOpenBoundaries;
 	_node_offset = part_count;
@@ -286,59 +1039,10 @@ void HotFile::writeBody(ofstream *fp, const MovingBodyData *mbdata, uint numpart
 {
 	switch (version) {
 	case VERSION_1:
-		encoded_body_t eb;
-		memset(&eb, 0, sizeof(eb));
-
-		eb.index = mbdata->index;
-		eb.id = mbdata->id;
-
-		eb.type = mbdata->type;
-		eb.numparts = numparts;
-
-		if (eb.type == MB_FLOATING || eb.type == MB_FORCES_MOVING) {
-			eb.firstindex = _gdata->s_hRbFirstIndex[eb.id];
-			eb.lastindex = _gdata->s_hRbLastIndex[eb.id];
-		}
-		else {
-			eb.firstindex = 0;
-			eb.lastindex = 0;
-		}
-
-		eb.crot[0] = mbdata->kdata.crot.x;
-		eb.crot[1] = mbdata->kdata.crot.y;
-		eb.crot[2] = mbdata->kdata.crot.z;
-
-		eb.lvel[0] = mbdata->kdata.lvel.x;
-		eb.lvel[1] = mbdata->kdata.lvel.y;
-		eb.lvel[2] = mbdata->kdata.lvel.z;
-
-		eb.avel[0] = mbdata->kdata.avel.x;
-		eb.avel[1] = mbdata->kdata.avel.y;
-		eb.avel[2] = mbdata->kdata.avel.z;
-
-		eb.orientation[0] = mbdata->kdata.orientation(0);
-		eb.orientation[1] = mbdata->kdata.orientation(1);
-		eb.orientation[2] = mbdata->kdata.orientation(2);
-		eb.orientation[3] = mbdata->kdata.orientation(3);
-
-		eb.initial_crot[0] = mbdata->initial_kdata.crot.x;
-		eb.initial_crot[1] = mbdata->initial_kdata.crot.y;
-		eb.initial_crot[2] = mbdata->initial_kdata.crot.z;
-
-		eb.initial_lvel[0] = mbdata->initial_kdata.lvel.x;
-		eb.initial_lvel[1] = mbdata->initial_kdata.lvel.y;
-		eb.initial_lvel[2] = mbdata->initial_kdata.lvel.z;
-
-		eb.initial_avel[0] = mbdata->initial_kdata.avel.x;
-		eb.initial_avel[1] = mbdata->initial_kdata.avel.y;
-		eb.initial_avel[2] = mbdata->initial_kdata.avel.z;
-
-		eb.initial_orientation[0] = mbdata->initial_kdata.orientation(0);
-		eb.initial_orientation[1] = mbdata->initial_kdata.orientation(1);
-		eb.initial_orientation[2] = mbdata->initial_kdata.orientation(2);
-		eb.initial_orientation[3] = mbdata->initial_kdata.orientation(3);
-
+		{
+		const encoded_body_t eb = encode_body(_gdata, mbdata, numparts);
 		fp->write((const char *)&eb, sizeof(eb));
+		}
 		break;
 	default:
 		unsupported_version(version);
@@ -355,47 +1059,7 @@ void HotFile::readBody(ifstream *fp, version_t version)
 
 			fp->read((char *)&eb, sizeof(eb));
 
-			MovingBodyData mbdata;
-
-			mbdata.index = eb.index;
-			mbdata.id = eb.id;
-			mbdata.type = eb.type;
-
-			mbdata.kdata.crot.x = eb.crot[0];
-			mbdata.kdata.crot.y = eb.crot[1];
-			mbdata.kdata.crot.z = eb.crot[2];
-
-			mbdata.kdata.lvel.x = eb.lvel[0];
-			mbdata.kdata.lvel.y = eb.lvel[1];
-			mbdata.kdata.lvel.z = eb.lvel[2];
-
-			mbdata.kdata.avel.x = eb.avel[0];
-			mbdata.kdata.avel.y = eb.avel[1];
-			mbdata.kdata.avel.z = eb.avel[2];
-
-			mbdata.kdata.orientation(0) = eb.orientation[0];
-			mbdata.kdata.orientation(1) = eb.orientation[1];
-			mbdata.kdata.orientation(2) = eb.orientation[2];
-			mbdata.kdata.orientation(3) = eb.orientation[3];
-
-			mbdata.initial_kdata.crot.x = eb.initial_crot[0];
-			mbdata.initial_kdata.crot.y = eb.initial_crot[1];
-			mbdata.initial_kdata.crot.z = eb.initial_crot[2];
-
-			mbdata.initial_kdata.lvel.x = eb.initial_lvel[0];
-			mbdata.initial_kdata.lvel.y = eb.initial_lvel[1];
-			mbdata.initial_kdata.lvel.z = eb.initial_lvel[2];
-
-			mbdata.initial_kdata.avel.x = eb.initial_avel[0];
-			mbdata.initial_kdata.avel.y = eb.initial_avel[1];
-			mbdata.initial_kdata.avel.z = eb.initial_avel[2];
-
-			mbdata.initial_kdata.orientation(0) = eb.orientation[0];
-			mbdata.initial_kdata.orientation(1) = eb.orientation[1];
-			mbdata.initial_kdata.orientation(2) = eb.orientation[2];
-			mbdata.initial_kdata.orientation(3) = eb.orientation[3];
-
-			_gdata->problem->restore_moving_body(mbdata, eb.numparts, eb.firstindex, eb.lastindex);
+			restore_body(_gdata, eb);
 			}
 		break;
 	default:
@@ -403,7 +1067,6 @@ void HotFile::readBody(ifstream *fp, version_t version)
 	}
 }
 
-
 ostream& operator<<(ostream &strm, const HotFile &h) {
 	return strm << "HotFile( version=" << h._header.version << ", pc=" <<
 		h._header.particle_count << ", bc=" << h._header.body_count << ")" << endl;
@@ -30,9 +30,13 @@ The file represents particle and other state.
 */
 
 #ifndef H_HOTFILE_H
+#define H_HOTFILE_H
 
 #include <string>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include "GlobalData.h"
 #include "MovingBody.h"
@@ -45,32 +49,123 @@ HotFile header encoding.
 */
 typedef struct {
 	uint	version;
-	uint	buffer_count;
+	uint	buffer_count; ///< v1: number of buffers in the simulation, v2: number of buffers stored
 	uint	particle_count;
 	uint	body_count;
 	uint	numOpenBoundaries;
-	uint	reserved[12];
+	uint	toc_count; ///< v2: number of entries in the table of contents
+	uint	toc_checksum; ///< v2: CRC32C of the table of contents
+	uint	data_alignment; ///< v2: alignment of the data blocks in the file
+	uint	flags; ///< v2: HOTFILE_DELTA for delta files
+	uint	block_size; ///< v2: size of the blocks delta files are made of
+	uint	reserved[7];
 	ulong	iterations;
 	double	t;
 	float	dt;
 	uint	_reserved[3];
 } header_t;
 
+/**
+HotFile table of contents entry (v2).
+
+Version 2 HotFiles are laid out as the header, followed by the table of
+contents, followed by the data blocks, each starting at a multiple of
+data_alignment (the page size) from the beginning of the file, so that
+they can be accessed directly from a memory mapping of the file.
+There is an entry for each array of each stored buffer, and one for the
+moving bodies data.
+
+The data block of an encoded entry starts with a ulong holding the size
+of the decoded data, a uint chunk size and a uint chunk count, followed by
+the (ulong) end offset of each encoded chunk, relative to the end of this
+index, followed by the chunks. Each chunk holds chunk size bytes of the
+decoded data (except for the last one), encoded independently; chunks that
+would not shrink are stored as-is.
+*/
+typedef struct {
+	char	name[64]; ///< buffer name
+	uint	element_size;
+	uint	array_count; ///< number of arrays of the buffer
+	uint	array_index; ///< array of the buffer this entry refers to
+	uint	checksum; ///< CRC32C of the data block
+	uint	codec; ///< encoding of the data block (see codec_t)
+	uint	raw_checksum; ///< CRC32C of the decoded data, for encoded blocks
+	ulong	offset; ///< offset of the data block from the beginning of the file
+	ulong	size; ///< size of the data block
+} toc_entry_t;
+
+/**
+Delta HotFiles (v2).
+
+A delta HotFile only holds the fixed-size blocks of the buffer arrays that
+changed since its parent, which is the (full or delta) HotFile saved right
+before it, and is named in the HOTFILE_PARENT_ENTRY entry. The data block
+of each entry of a delta file is a uint block count, followed by the
+indices of the stored blocks (as uint), followed by the blocks themselves
+(the last block of an array may be shorter than the block size). Arrays that did not change
+at all have no entry. The moving bodies data is always stored in full.
+Loading a delta file loads its parent first, recursively, and then applies
+the stored blocks.
+*/
+#define HOTFILE_DELTA 1
+
+//! Name of the TOC entry holding the name of the parent of a delta HotFile
+#define HOTFILE_PARENT_ENTRY "__parent"
+
+//! Block hashes of the last saved HotFile, used to decide what goes in the next delta
+struct HotFileBlockHashes {
+	uint	particle_count;
+	uint	block_size;
+	//! hashes of the blocks of each array, indexed by buffer name and array index
+	std::map<std::pair<std::string, uint>, std::vector<uint64_t>> blocks;
+
+	HotFileBlockHashes() : particle_count(0), block_size(0), blocks() {}
+};
+
+/** Encoding of the HotFile data blocks (v2) */
+typedef enum {
+	HOTFILE_RAW, ///< stored as-is
+	HOTFILE_XOR_SHUFFLE, ///< compressed with the lossless float codec
+} codec_t;
+
 /** HotFile version. */
 typedef enum {
 	VERSION_1,
+	VERSION_2,
 } version_t;
 
 class HotFile {
 public:
-	HotFile(std::ifstream &fp, const GlobalData *gdata);
+	//! Open a HotFile for reading
+	/*! If the filename is given, version 2 files are memory-mapped on load,
+	 * otherwise they are read through the stream
+	 */
+	HotFile(std::ifstream &fp, const GlobalData *gdata,
+		std::string const& filename = std::string());
 	HotFile(std::ofstream &fp, const GlobalData *gdata, uint numParts,
 		uint node_offset, double t, const bool testpoints);
 	~HotFile();
 	ulong get_iterations() { return _header.iterations; }
 	float get_dt() { return _header.dt; }
 	double get_t() { return _header.t; }
-	void save();
+	//! Save the simulation state, in the given HotFile version
+	void save(version_t version = VERSION_2);
+	//! Take a copy of the data to be saved
+	/*! After this, save() writes the copy instead of the live simulation data,
+	 * so it can be called from another thread while the simulation goes on.
+	 * Only supported for version 2.
+	 */
+	void snapshot();
+	//! Save the simulation state as a delta against the given parent (v2)
+	/*! Only the blocks whose hash differs from the ones in hashes are saved.
+	 * If parent is empty, or the data layout changed since the parent was saved,
+	 * a full HotFile is saved instead.
+	 * On return, hashes holds the block hashes of the saved data.
+	 * \return true if a delta file was saved, false if a full one was
+	 */
+	bool save_incremental(HotFileBlockHashes &hashes, std::string const& parent);
+	//! Set the encoding of the buffer data saved from now on (v2)
+	void set_codec(codec_t codec) { _codec = codec; }
 	void load();
 	void readHeader(uint &part_count, uint &numOpenBoundaries);
 private:
@@ -84,6 +179,11 @@ private:
 	bool				_testpoints;
 	const GlobalData	*_gdata;
 	header_t			_header;
+	std::string			_filename;
+	std::vector<toc_entry_t>	_toc;
+	codec_t				_codec;
+	std::vector<char>	_bodies; ///< encoded moving bodies (v2 save)
+	std::unique_ptr<char[]>	_snapshot; ///< copy of the data blocks (v2 save)
 
 	void writeBuffer(std::ofstream *fp, const AbstractBuffer *buffer, version_t version);
 	void writeBody(std::ofstream *fp, const MovingBodyData *mbdata, const uint numparts, version_t version);
@@ -91,6 +191,25 @@ private:
 	void readBuffer(std::ifstream *fp, AbstractBuffer *buffer, version_t version);
 	void readBody(std::ifstream *fp, version_t version);
 
+	//! Version 2 save and load
+	void prepare_v2(std::vector<const void*> &data);
+	void write_v2(std::vector<const void*> const& data);
+	void save_v2();
+	void load_v2();
+	//! Collect the data to be saved (from the snapshot, if present)
+	void collect_v2(std::vector<const void*> &data);
+	//! Assign the offsets of the data blocks
+	void layout_v2();
+	//! Encode the buffer data blocks with the current codec, chunks in parallel
+	void encode_v2(std::vector<const void*> &data, std::vector<std::vector<char>> &storage);
+	//! Load the buffer arrays (and the bodies data, if bodies is not NULL),
+	//! replaying the parent chain for delta files
+	void load_buffers_v2(std::vector<char> *bodies);
+	//! Read the data block of the given entry, from the stream
+	std::vector<char> read_entry(toc_entry_t const& entry);
+	//! Find the TOC entry for the given array of the given buffer, NULL if not found
+	const toc_entry_t *find_entry(const char *name, uint array_index) const;
+
 	friend std::ostream& operator<<(std::ostream&, const HotFile&);
 };
 
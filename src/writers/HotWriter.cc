@@ -31,6 +31,8 @@
 #include <stdexcept>
 #include <fcntl.h>
 #include <errno.h>
+#include <cstring>
+#include <cstdio>
 
 #include "HotWriter.h"
 #include "GlobalData.h"
@@ -43,37 +45,95 @@ HotWriter::HotWriter(const GlobalData *_gdata): Writer(_gdata) {
 
 	_num_files_to_save = DEFAULT_NUM_FILES_TO_SAVE;
 	_particle_count = 0;
+
+	_codec = HOTFILE_RAW;
+	_full_every = 1;
+	_since_full = 0;
+	_num_full = 0;
 }
 
+struct HotWriter::PendingCheckpoint
+{
+	std::ofstream out;
+	std::unique_ptr<HotFile> hf;
+	string tmp_name; ///< name of the file while being written
+	string name; ///< final name of the file
+	string parent; ///< file this is a delta of, empty for full checkpoints
+	bool incremental; ///< compute the block hashes for the following deltas
+};
+
 HotWriter::~HotWriter() {
+	if (_flush_thread.joinable())
+		_flush_thread.join();
+	if (!_flush_error.empty())
+		cerr << "Writing the last hot file failed: " << _flush_error << endl;
 }
 
-void HotWriter::write(uint numParts, const BufferList &buffers,
-	uint node_offset, double t, const bool testpoints) {
-
-	// generate filename with iterative integer
-	ofstream out;
-	string filename;
-	if (gdata->run_mode == REPACK) {
-		filename = open_data_file(out, "repack", current_filenum());
-		gdata->clOptions->resume_fname = m_dirname + "/" + filename;
+// sync the given file or directory to disk, throwing on failure
+static void
+sync_path(string const& path, int flags)
+{
+	int fd = open(path.c_str(), flags);
+	if (fd < 0)
+		throw runtime_error("failed to open " + path + ": " + strerror(errno));
+	if (fsync(fd)) {
+		const int err = errno;
+		close(fd);
+		throw runtime_error("failed to sync " + path + ": " + strerror(err));
 	}
-	else
-		filename = open_data_file(out, "hot", current_filenum());
+	if (close(fd))
+		throw runtime_error("failed to close " + path + ": " + strerror(errno));
+}
 
-	// save the filename in order to manage removing unwanted files
-	_current_filenames.push_back(m_dirname + "/" + filename);
+void HotWriter::flush(shared_ptr<PendingCheckpoint> checkpoint)
+{
+	bool delta = false;
+	try {
+		if (checkpoint->incremental)
+			delta = checkpoint->hf->save_incremental(_block_hashes, checkpoint->parent);
+		else
+			checkpoint->hf->save();
+		// release the snapshot as soon as possible
+		checkpoint->hf.reset();
+		if (checkpoint->out.fail())
+			throw runtime_error("failed to write " + checkpoint->tmp_name);
+		checkpoint->out.close();
+		if (checkpoint->out.fail())
+			throw runtime_error("failed to close " + checkpoint->tmp_name);
+
+		// make sure the data is on disk before the file replaces any older one
+		sync_path(checkpoint->tmp_name, O_RDONLY);
+		if (rename(checkpoint->tmp_name.c_str(), checkpoint->name.c_str()))
+			throw runtime_error("failed to rename " + checkpoint->tmp_name
+				+ ": " + strerror(errno));
+		sync_path(m_dirname, O_RDONLY | O_DIRECTORY);
+	} catch (exception const& e) {
+		_flush_error = e.what();
+		unlink(checkpoint->tmp_name.c_str());
+		// the next checkpoint must not be a delta against this one
+		_since_full = 0;
+		return;
+	}
 
-	// create and save the hot file
-	HotFile *hf = new HotFile(out, gdata, numParts, node_offset, t, testpoints);
-	hf->save();
-	delete hf;
+	if (delta) {
+		++_since_full;
+	} else {
+		_since_full = 1;
+		++_num_full;
+	}
 
-	out.close();
+	// save the filename in order to manage removing unwanted files
+	_current_filenames.push_back(checkpoint->name);
+	_current_groups.push_back(_num_full);
 
-	// remove unwanted files, we only keep the last _num_files_to_save ones
+	// remove unwanted files, we only keep the last _num_files_to_save ones,
+	// plus the older ones they depend on (i.e. those of the same group
+	// as the oldest kept file)
 	if(_num_files_to_save > 0 && _current_filenames.size() > _num_files_to_save) {
-		int num_to_remove = _current_filenames.size() - _num_files_to_save;
+		const int oldest_kept = _current_filenames.size() - _num_files_to_save;
+		int num_to_remove = 0;
+		while (_current_groups[num_to_remove] < _current_groups[oldest_kept])
+			++num_to_remove;
 		for(int i = 0; i < num_to_remove; i++) {
 			string to_remove = _current_filenames.at(i);
 			if(unlink(to_remove.c_str())) {
@@ -82,7 +142,57 @@ void HotWriter::write(uint numParts, const BufferList &buffers,
 		}
 		_current_filenames.erase (_current_filenames.begin(),
 			_current_filenames.begin() + num_to_remove);
+		_current_groups.erase (_current_groups.begin(),
+			_current_groups.begin() + num_to_remove);
 	}
+}
 
+void HotWriter::wait_flush()
+{
+	if (_flush_thread.joinable())
+		_flush_thread.join();
+	if (!_flush_error.empty()) {
+		const string error = _flush_error;
+		_flush_error.clear();
+		throw runtime_error("writing hot file failed: " + error);
+	}
 }
 
+void HotWriter::write(uint numParts, const BufferList &buffers,
+	uint node_offset, double t, const bool testpoints) {
+
+	// the previous checkpoint must be complete before we start the next one;
+	// this also limits the memory used by snapshots to a single one
+	wait_flush();
+
+	const bool repack = (gdata->run_mode == REPACK);
+
+	// generate filename with iterative integer; the file is written
+	// under a temporary name, and renamed when complete
+	shared_ptr<PendingCheckpoint> checkpoint = make_shared<PendingCheckpoint>();
+	const string filename = open_data_file(checkpoint->out, repack ? "repack" : "hot",
+		current_filenum(), m_fname_sfx + ".tmp");
+	checkpoint->tmp_name = m_dirname + "/" + filename;
+	checkpoint->name = checkpoint->tmp_name.substr(0, checkpoint->tmp_name.size() - 4);
+
+	checkpoint->hf.reset(new HotFile(checkpoint->out, gdata, numParts, node_offset, t, testpoints));
+	checkpoint->hf->set_codec(_codec);
+
+	// the repack file must be self-contained
+	checkpoint->incremental = !repack && _full_every > 1;
+	if (checkpoint->incremental && _since_full > 0 && _since_full < _full_every &&
+		!_current_filenames.empty())
+		checkpoint->parent = _current_filenames.back();
+
+	if (repack) {
+		// the repack file is used to start the simulation right after,
+		// so write it synchronously
+		gdata->clOptions->resume_fname = checkpoint->name;
+		flush(checkpoint);
+		wait_flush();
+		return;
+	}
+
+	checkpoint->hf->snapshot();
+	_flush_thread = thread(&HotWriter::flush, this, checkpoint);
+}
@@ -27,6 +27,9 @@
 #ifndef H_HOTWRITER_H
 #define H_HOTWRITER_H
 
+#include <memory>
+#include <thread>
+
 #include "Writer.h"
 #include "HotFile.h"
 
@@ -57,6 +60,23 @@ e.g. 'hot_00063.bin' and invoke GPUSPH with the --resume command line option:
 
 If the hotstart file is found and valid, the simulation will start from that
 point. GPUSPH will abort otherwise.
+
+Checkpoints are taken as an in-memory snapshot of the data to be saved, and
+written to disk by a background thread, so that the simulation can go on
+in the meantime. Each file is written under a temporary name and renamed
+into place once it is complete and synced to disk, so that a crash never
+leaves a truncated hot file around. Only one checkpoint is written at a time:
+if a new one is requested while the previous one is still being written,
+the simulation waits for it.
+
+Checkpoints can also be incremental (see set_full_checkpoint_every()):
+a full hot file is written every K checkpoints, and the ones in between are
+delta files, holding only the blocks of data that changed since the previous
+checkpoint. Resuming from a delta file replays the full file and the deltas
+leading to it, so old files are only removed when no kept file depends on them.
+
+The buffer data can also be compressed (see set_codec()), with a lossless
+codec, so that resuming is still bit-exact.
 */
 class HotWriter : public Writer {
 public:
@@ -74,10 +94,54 @@ public:
 		return _num_files_to_save;
 	}
 
+	//! Write a full hot file every num_checkpoints, and deltas in between
+	/*! A value of 1 or less disables delta files */
+	void set_full_checkpoint_every(int num_checkpoints) {
+		_full_every = num_checkpoints;
+	}
+
+	int get_full_checkpoint_every() const {
+		return _full_every;
+	}
+
+	//! Encoding of the buffer data in the hot files
+	void set_codec(codec_t codec) {
+		_codec = codec;
+	}
+
+	codec_t get_codec() const {
+		return _codec;
+	}
+
 private:
 	int					_num_files_to_save;
 	std::vector<std::string>	_current_filenames;
 	uint				_particle_count;
+
+	codec_t				_codec;
+	int					_full_every;
+	//! Number of checkpoints written since the last full one
+	int					_since_full;
+	//! Full checkpoints written so far; each file is tagged with the
+	//! count at the time it was written, to know which files it depends on
+	int					_num_full;
+	std::vector<int>	_current_groups;
+	//! Block hashes of the last checkpoint
+	HotFileBlockHashes	_block_hashes;
+
+	//! A checkpoint being written
+	struct PendingCheckpoint;
+
+	//! Thread writing the last checkpoint
+	std::thread			_flush_thread;
+	//! Error message from the last background write, if it failed
+	std::string			_flush_error;
+
+	//! Write a checkpoint to disk, rename it into place and remove the old ones
+	void flush(std::shared_ptr<PendingCheckpoint> checkpoint);
+
+	//! Wait for the background write to complete, throwing if it failed
+	void wait_flush();
 };
 
 /** Determines how far back in simulation time we can restart a simulation */
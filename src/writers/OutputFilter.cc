@@ -0,0 +1,213 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Per-writer particle output filters implementation
+ */
+
+#include <cstring>
+#include <stdexcept>
+
+#include "OutputFilter.h"
+#include "define_buffers.h"
+#include "parallel_jobs.h"
+
+using namespace std;
+
+//! Number of particles processed by each job of the stream compaction
+#define OUTPUT_FILTER_CHUNK (64*1024)
+
+//! Buffers that are not indexed by particle, and are thus not gathered
+#define OUTPUT_FILTER_SKIP_BUFFERS \
+	(BUFFER_CELLSTART | BUFFER_CELLEND | BUFFER_COMPACT_DEV_MAP | BUFFER_NEIBSLIST)
+
+/* A buffer holding the elements of another buffer, for the selected particles
+ * only. The element type is only known by size, which is all the writers need
+ * since they access the data through BufferList::getData().
+ */
+class GatheredBuffer : public AbstractBuffer
+{
+	// more than any buffer has (see define_buffers.h)
+	enum { max_arrays = 4 };
+
+	void *m_bufs[max_arrays];
+	vector<vector<char>> m_storage;
+	const char *m_name;
+	size_t m_element_size;
+	uint m_array_count;
+
+public:
+	GatheredBuffer(AbstractBuffer const& source) :
+		AbstractBuffer(m_bufs),
+		m_storage(source.get_array_count()),
+		m_name(source.get_buffer_name()),
+		m_element_size(source.get_element_size()),
+		m_array_count(source.get_array_count())
+	{
+		if (m_array_count > max_arrays)
+			throw runtime_error(string("too many arrays to gather buffer ") + m_name);
+		for (uint i = 0; i < max_arrays; ++i)
+			m_bufs[i] = NULL;
+		copy_state(&source);
+	}
+
+	virtual void clobber()
+	{
+		for (auto& array : m_storage)
+			memset(array.data(), 0, array.size());
+	}
+
+	virtual size_t get_element_size() const
+	{ return m_element_size; }
+
+	virtual uint get_array_count() const
+	{ return m_array_count; }
+
+	virtual const char* get_buffer_name() const
+	{ return m_name; }
+
+	virtual const char* get_buffer_class() const
+	{ return "GatheredBuffer"; }
+
+	virtual size_t alloc(size_t elems)
+	{
+		set_allocated_elements(elems);
+		for (uint i = 0; i < m_array_count; ++i) {
+			m_storage[i].resize(elems*m_element_size);
+			m_bufs[i] = m_storage[i].data();
+		}
+		return elems*m_element_size*m_array_count;
+	}
+
+	virtual void *get_offset_buffer(uint idx, size_t offset)
+	{ return (char*)m_bufs[idx] + offset*m_element_size; }
+
+	virtual const void *get_offset_buffer(uint idx, size_t offset) const
+	{ return (const char*)m_bufs[idx] + offset*m_element_size; }
+
+	virtual void swap_elements(uint idx1, uint idx2, uint _buf=0)
+	{
+		char *buf = (char*)m_bufs[_buf];
+		for (size_t b = 0; b < m_element_size; ++b)
+			swap(buf[idx1*m_element_size + b], buf[idx2*m_element_size + b]);
+	}
+};
+
+OutputFilter&
+OutputFilter::add_box(double3 const& min, double3 const& max)
+{
+	OutputRegion region;
+	region.shape = OutputRegion::BOX;
+	region.min = min;
+	region.max = max;
+	region.radius = 0;
+	m_regions.push_back(region);
+	return *this;
+}
+
+OutputFilter&
+OutputFilter::add_sphere(double3 const& center, double radius)
+{
+	OutputRegion region;
+	region.shape = OutputRegion::SPHERE;
+	region.min = center;
+	region.max = center;
+	region.radius = radius;
+	m_regions.push_back(region);
+	return *this;
+}
+
+uint
+OutputFilter::apply(uint numParts, BufferList const& buffers, uint node_offset,
+	FilteredBufferList &filtered) const
+{
+	const double4 *pos = buffers.getData<BUFFER_POS_GLOBAL>();
+	const particleinfo *info = buffers.getData<BUFFER_INFO>();
+	if (!pos || !info)
+		throw runtime_error("output filters need the global positions and the particle info");
+
+	// stream compaction: count the selected particles in each chunk,
+	// find where each chunk goes, and collect the selected indices
+	const size_t nchunks = (numParts + OUTPUT_FILTER_CHUNK - 1)/OUTPUT_FILTER_CHUNK;
+	vector<uint> chunk_start(nchunks + 1, 0);
+
+	parallel_jobs(nchunks, [&](size_t c) {
+		const uint begin = node_offset + c*OUTPUT_FILTER_CHUNK;
+		const uint end = node_offset + min<size_t>((c + 1)*OUTPUT_FILTER_CHUNK, numParts);
+		uint count = 0;
+		for (uint i = begin; i < end; ++i)
+			count += selects(pos[i], info[i]);
+		chunk_start[c + 1] = count;
+	});
+
+	for (size_t c = 0; c < nchunks; ++c)
+		chunk_start[c + 1] += chunk_start[c];
+	const uint selected = chunk_start[nchunks];
+
+	vector<uint> index(selected);
+	parallel_jobs(nchunks, [&](size_t c) {
+		const uint begin = node_offset + c*OUTPUT_FILTER_CHUNK;
+		const uint end = node_offset + min<size_t>((c + 1)*OUTPUT_FILTER_CHUNK, numParts);
+		uint *dst = index.data() + chunk_start[c];
+		for (uint i = begin; i < end; ++i)
+			if (selects(pos[i], info[i]))
+				*dst++ = i;
+	});
+
+	// gather the per-particle buffers
+	const size_t ngather = (selected + OUTPUT_FILTER_CHUNK - 1)/OUTPUT_FILTER_CHUNK;
+	for (auto const& kb : buffers) {
+		const flag_t key = kb.first;
+		AbstractBuffer const& source = *kb.second;
+		if ((key & OUTPUT_FILTER_SKIP_BUFFERS) ||
+			source.get_allocated_elements() < node_offset + numParts)
+			continue;
+
+		shared_ptr<GatheredBuffer> gathered = make_shared<GatheredBuffer>(source);
+		gathered->alloc(selected);
+
+		const size_t elsize = source.get_element_size();
+		for (uint a = 0; a < source.get_array_count(); ++a) {
+			const char *src = (const char*)source.get_buffer(a);
+			char *dst = (char*)gathered->get_buffer(a);
+			if (!src)
+				continue;
+			parallel_jobs(ngather, [&](size_t c) {
+				const size_t begin = c*OUTPUT_FILTER_CHUNK;
+				const size_t end = min<size_t>(begin + OUTPUT_FILTER_CHUNK, selected);
+				for (size_t i = begin; i < end; ++i)
+					memcpy(dst + i*elsize, src + index[i]*elsize, elsize);
+			});
+		}
+
+		gathered->mark_valid();
+		filtered.add(key, gathered);
+	}
+
+	return selected;
+}
@@ -0,0 +1,154 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Per-writer particle output filters
+ *
+ * An OutputFilter selects which particles are passed to a writer:
+ * all the particles of the enabled types inside the regions of interest
+ * (boxes and spheres) are written, while outside of them only one particle
+ * every `stride` (by particle id, so that the same particles are written
+ * at every output) is kept. Filters are set up by the problem, e.g.
+ *
+ *     add_writer(VTKWRITER, 1e-3);
+ *     output_filter(VTKWRITER)
+ *         .add_box(make_double3(0, 0, 0), make_double3(0.1, 0.1, 0.05))
+ *         .drop_type(PT_BOUNDARY)
+ *         .set_stride(16);
+ *
+ * The selected particles are gathered (with a parallel stream compaction)
+ * into temporary buffers, so the writers themselves are unaware of the
+ * filtering. Only per-particle buffers are gathered: cell-indexed buffers
+ * and the neighbors list are not passed to filtered writers, and
+ * information derived from the particle position in the (unfiltered) arrays,
+ * such as the VTKWriter device index, is not meaningful.
+ */
+
+#ifndef _OUTPUTFILTER_H
+#define _OUTPUTFILTER_H
+
+#include <vector>
+
+#include "particledefine.h"
+#include "particleinfo.h"
+#include "buffer.h"
+
+//! A region of interest for the output
+struct OutputRegion
+{
+	enum Shape {
+		BOX,
+		SPHERE
+	} shape;
+	double3 min; ///< BOX: lower corner, SPHERE: center
+	double3 max; ///< BOX: upper corner
+	double radius; ///< SPHERE: radius
+
+	bool contains(double4 const& pos) const
+	{
+		if (shape == SPHERE) {
+			const double dx = pos.x - min.x;
+			const double dy = pos.y - min.y;
+			const double dz = pos.z - min.z;
+			return dx*dx + dy*dy + dz*dz <= radius*radius;
+		}
+		return	pos.x >= min.x && pos.x <= max.x &&
+				pos.y >= min.y && pos.y <= max.y &&
+				pos.z >= min.z && pos.z <= max.z;
+	}
+};
+
+//! A BufferList holding the particles selected by an OutputFilter
+class FilteredBufferList : public BufferList
+{
+public:
+	void add(flag_t key, ptr_type buf)
+	{ addExistingBuffer(key, buf); }
+};
+
+class OutputFilter
+{
+	std::vector<OutputRegion> m_regions;
+	uint m_type_mask; ///< bit (1 << PT_xxx) is set if particles of type PT_xxx are written
+	uint m_stride; ///< decimation outside of the regions of interest
+
+public:
+	OutputFilter() :
+		m_regions(),
+		m_type_mask((1U << PT_NONE) - 1),
+		m_stride(1)
+	{}
+
+	//! Add a box region of interest, with the given corners
+	OutputFilter& add_box(double3 const& min, double3 const& max);
+
+	//! Add a sphere region of interest
+	OutputFilter& add_sphere(double3 const& center, double radius);
+
+	//! Do not write particles of the given type
+	OutputFilter& drop_type(ParticleType type)
+	{
+		m_type_mask &= ~(1U << type);
+		return *this;
+	}
+
+	//! Write one particle every stride outside of the regions of interest
+	/*! With no regions of interest, this decimates the whole output.
+	 * A stride of 0 drops all the particles outside of the regions of interest.
+	 */
+	OutputFilter& set_stride(uint stride)
+	{
+		m_stride = stride;
+		return *this;
+	}
+
+	//! Does the filter discard any particle?
+	bool active() const
+	{
+		return m_type_mask != (1U << PT_NONE) - 1 ||
+			m_stride != 1;
+	}
+
+	//! Is the particle with the given position and info selected?
+	bool selects(double4 const& pos, particleinfo const& info) const
+	{
+		if (!(m_type_mask & (1U << PART_TYPE(info))))
+			return false;
+		for (OutputRegion const& region : m_regions)
+			if (region.contains(pos))
+				return true;
+		return m_stride && (id(info) % m_stride == 0);
+	}
+
+	//! Gather the selected particles of [node_offset, node_offset + numParts)
+	//! into filtered, returning their number
+	uint apply(uint numParts, BufferList const& buffers, uint node_offset,
+		FilteredBufferList &filtered) const;
+};
+
+#endif
@@ -29,6 +29,7 @@
 
 #include "TextWriter.h"
 #include "GlobalData.h"
+#include "buffer_precision.h"
 
 using namespace std;
 
@@ -54,7 +55,9 @@ TextWriter::write(uint numParts, BufferList const& buffers, uint node_offset, do
 	const double4 *pos = buffers.getData<BUFFER_POS_GLOBAL>();
 	const float4 *vel = buffers.getData<BUFFER_VEL>();
 	const particleinfo *info = buffers.getData<BUFFER_INFO>();
-	const float3 *vort = buffers.getData<BUFFER_VORTICITY>();
+	const DecodedBuffer<BUFFER_VORTICITY> vort_data(buffers.getData<BUFFER_VORTICITY>(),
+		node_offset + numParts);
+	const float3 *vort = vort_data;
 
 	ofstream fid;
 	const string filenum = current_filenum();
@@ -0,0 +1,243 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Columnar binary time series writer and reader
+ */
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "TimeSeries.h"
+#include "mapped_file.h"
+
+using namespace std;
+
+// size of the values of the given type
+static uint32_t
+series_type_size(uint32_t type)
+{
+	switch (type) {
+	case SERIES_FLOAT64: return sizeof(double);
+	case SERIES_FLOAT32: return sizeof(float);
+	case SERIES_INT32: return sizeof(int32_t);
+	case SERIES_UINT32: return sizeof(uint32_t);
+	case SERIES_UINT64: return sizeof(uint64_t);
+	}
+	throw invalid_argument("unknown time series type");
+}
+
+// store a value of type T in dst, as the given series type
+template<typename T>
+static void
+store_value(char *dst, uint32_t type, T value)
+{
+	switch (type) {
+	case SERIES_FLOAT64: { double v = value; memcpy(dst, &v, sizeof(v)); break; }
+	case SERIES_FLOAT32: { float v = value; memcpy(dst, &v, sizeof(v)); break; }
+	case SERIES_INT32: { int32_t v = value; memcpy(dst, &v, sizeof(v)); break; }
+	case SERIES_UINT32: { uint32_t v = value; memcpy(dst, &v, sizeof(v)); break; }
+	case SERIES_UINT64: { uint64_t v = value; memcpy(dst, &v, sizeof(v)); break; }
+	}
+}
+
+TimeSeriesWriter::TimeSeriesWriter() :
+	m_out(), m_columns(), m_record_size(0), m_record(), m_next(0)
+{}
+
+void
+TimeSeriesWriter::add_column(string const& name, SeriesType type)
+{
+	series_column_t col;
+	memset(&col, 0, sizeof(col));
+	strncpy(col.name, name.c_str(), sizeof(col.name) - 1);
+	col.type = type;
+	col.offset = m_record_size;
+	m_columns.push_back(col);
+	m_record_size += series_type_size(type);
+}
+
+void
+TimeSeriesWriter::write_header()
+{
+	series_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TIMESERIES_MAGIC, sizeof(header.magic));
+	header.version = TIMESERIES_VERSION;
+	header.column_count = m_columns.size();
+	header.record_size = m_record_size;
+	// start the records at a multiple of 64 bytes
+	const size_t header_size = sizeof(header) + m_columns.size()*sizeof(series_column_t);
+	header.data_offset = (header_size + 63)/64*64;
+
+	m_out.write((const char*)&header, sizeof(header));
+	m_out.write((const char*)m_columns.data(), m_columns.size()*sizeof(series_column_t));
+	static const char padding[64] = {0};
+	m_out.write(padding, header.data_offset - header_size);
+	m_out.flush();
+
+	m_record.assign(m_record_size, 0);
+	m_next = 0;
+}
+
+template<typename T>
+TimeSeriesWriter&
+TimeSeriesWriter::put(T value)
+{
+	if (m_next >= m_columns.size())
+		throw out_of_range("too many values in time series record");
+	series_column_t const& col = m_columns[m_next];
+	store_value(m_record.data() + col.offset, col.type, value);
+	++m_next;
+	return *this;
+}
+
+TimeSeriesWriter& TimeSeriesWriter::operator<<(double value) { return put(value); }
+TimeSeriesWriter& TimeSeriesWriter::operator<<(float value) { return put(value); }
+TimeSeriesWriter& TimeSeriesWriter::operator<<(int value) { return put(value); }
+TimeSeriesWriter& TimeSeriesWriter::operator<<(unsigned int value) { return put(value); }
+TimeSeriesWriter& TimeSeriesWriter::operator<<(unsigned long value) { return put(value); }
+
+void
+TimeSeriesWriter::end_record()
+{
+	if (m_next != m_columns.size())
+		throw out_of_range("incomplete time series record");
+	m_out.write(m_record.data(), m_record.size());
+	// keep the file consistent for readers while the simulation runs,
+	// like the text files
+	m_out.flush();
+	m_next = 0;
+}
+
+TimeSeriesReader::TimeSeriesReader(string const& fname) :
+	m_file(new MappedFile(fname)),
+	m_header(),
+	m_columns(),
+	m_num_records(0)
+{
+	const char *data = m_file->data();
+	const size_t size = m_file->size();
+
+	if (size < sizeof(m_header))
+		throw runtime_error(fname + " is not a time series file");
+	memcpy(&m_header, data, sizeof(m_header));
+	if (memcmp(m_header.magic, TIMESERIES_MAGIC, sizeof(m_header.magic)))
+		throw runtime_error(fname + " is not a time series file");
+	if (m_header.version != TIMESERIES_VERSION)
+		throw runtime_error(fname + " has an unsupported time series version");
+
+	const size_t columns_size = m_header.column_count*sizeof(series_column_t);
+	if (size < sizeof(m_header) + columns_size || m_header.data_offset > size ||
+		m_header.column_count == 0 || m_header.record_size == 0)
+		throw runtime_error(fname + " has a corrupted time series header");
+
+	m_columns.resize(m_header.column_count);
+	memcpy(m_columns.data(), data + sizeof(m_header), columns_size);
+	for (auto const& col : m_columns)
+		if (col.offset + series_type_size(col.type) > m_header.record_size)
+			throw runtime_error(fname + " has a corrupted time series header");
+
+	// a partially written last record is ignored
+	m_num_records = (size - m_header.data_offset)/m_header.record_size;
+}
+
+TimeSeriesReader::~TimeSeriesReader()
+{}
+
+string
+TimeSeriesReader::column_name(size_t col) const
+{
+	const series_column_t& c = m_columns[col];
+	return string(c.name, strnlen(c.name, sizeof(c.name)));
+}
+
+int
+TimeSeriesReader::find_column(string const& name) const
+{
+	for (size_t c = 0; c < m_columns.size(); ++c)
+		if (column_name(c) == name)
+			return c;
+	return -1;
+}
+
+const char *
+TimeSeriesReader::record(size_t rec) const
+{
+	return m_file->data() + m_header.data_offset + rec*m_header.record_size;
+}
+
+double
+TimeSeriesReader::value(size_t rec, size_t col) const
+{
+	const series_column_t& c = m_columns[col];
+	const char *src = record(rec) + c.offset;
+	switch (c.type) {
+	case SERIES_FLOAT64: { double v; memcpy(&v, src, sizeof(v)); return v; }
+	case SERIES_FLOAT32: { float v; memcpy(&v, src, sizeof(v)); return v; }
+	case SERIES_INT32: { int32_t v; memcpy(&v, src, sizeof(v)); return v; }
+	case SERIES_UINT32: { uint32_t v; memcpy(&v, src, sizeof(v)); return v; }
+	case SERIES_UINT64: { uint64_t v; memcpy(&v, src, sizeof(v)); return v; }
+	}
+	return NAN;
+}
+
+pair<size_t, size_t>
+TimeSeriesReader::time_window(double t0, double t1) const
+{
+	// first record with time >= t0
+	size_t lo = 0, hi = m_num_records;
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo)/2;
+		if (time(mid) < t0) lo = mid + 1;
+		else hi = mid;
+	}
+	const size_t first = lo;
+
+	// first record with time > t1
+	hi = m_num_records;
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo)/2;
+		if (time(mid) <= t1) lo = mid + 1;
+		else hi = mid;
+	}
+	return make_pair(first, max(first, lo));
+}
+
+vector<double>
+TimeSeriesReader::column(size_t col, size_t first, size_t last) const
+{
+	vector<double> values;
+	last = min(last, m_num_records);
+	if (first < last)
+		values.reserve(last - first);
+	for (size_t rec = first; rec < last; ++rec)
+		values.push_back(value(rec, col));
+	return values;
+}
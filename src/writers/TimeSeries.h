@@ -0,0 +1,189 @@
+/*  Copyright (c) 2011-2019 INGV, EDF, UniCT, JHU
+
+    Istituto Nazionale di Geofisica e Vulcanologia, Sezione di Catania, Italy
+    Électricité de France, Paris, France
+    Università di Catania, Catania, Italy
+    Johns Hopkins University, Baltimore (MD), USA
+
+    This file is part of GPUSPH. Project founders:
+        Alexis Hérault, Giuseppe Bilotta, Robert A. Dalrymple,
+        Eugenio Rustico, Ciro Del Negro
+    For a full list of authors and project partners, consult the logs
+    and the project website <https://www.gpusph.org>
+
+    GPUSPH is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    GPUSPH is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with GPUSPH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/*! \file
+ * Columnar binary time series
+ *
+ * A binary alternative to the tab-separated text files written by the
+ * CommonWriter. A time series file holds a self-describing header
+ * (see series_header_t), followed by the column descriptors
+ * (see series_column_t), followed by fixed-size records, one per row,
+ * starting at data_offset. There is no footer, so records can simply be
+ * appended, and the number of records is given by the file size.
+ * Values are stored in the native byte order of the writing machine
+ * (little-endian on all supported platforms).
+ *
+ * The first column is always the simulation time, and is non-decreasing,
+ * so that time windows can be found by binary search.
+ */
+
+#ifndef H_TIMESERIES_H
+#define H_TIMESERIES_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class MappedFile;
+
+//! Type of the values of a time series column
+enum SeriesType {
+	SERIES_FLOAT64,
+	SERIES_FLOAT32,
+	SERIES_INT32,
+	SERIES_UINT32,
+	SERIES_UINT64,
+};
+
+//! Time series file header
+struct series_header_t {
+	char		magic[8]; ///< TIMESERIES_MAGIC
+	uint32_t	version;
+	uint32_t	column_count;
+	uint32_t	record_size; ///< size of each record, in bytes
+	uint32_t	data_offset; ///< offset of the first record from the beginning of the file
+};
+
+//! Time series column descriptor
+struct series_column_t {
+	char		name[56];
+	uint32_t	type; ///< SeriesType
+	uint32_t	offset; ///< offset of the value within the record
+};
+
+#define TIMESERIES_MAGIC "GPUSPHTS"
+#define TIMESERIES_VERSION 1
+
+//! Writer for columnar binary time series
+/*! Usage:
+ *
+ *     TimeSeriesWriter series;
+ *     series.add_column("time", SERIES_FLOAT64);
+ *     series.add_column("total", SERIES_FLOAT64);
+ *     // open series.stream(), then
+ *     series.write_header();
+ *     series << t << total;
+ *     series.end_record();
+ *
+ * Values are converted to the type of the column they go in.
+ */
+class TimeSeriesWriter
+{
+	std::ofstream m_out;
+	std::vector<series_column_t> m_columns;
+	uint32_t m_record_size;
+	std::vector<char> m_record; ///< record being built
+	size_t m_next; ///< next column to be set in the record
+
+	// store value in the next column of the record
+	template<typename T>
+	TimeSeriesWriter& put(T value);
+
+public:
+	TimeSeriesWriter();
+
+	//! Add a column; columns must be added before the header is written
+	void add_column(std::string const& name, SeriesType type);
+
+	//! The stream the time series is written to
+	std::ofstream& stream()
+	{ return m_out; }
+
+	//! Is the series stream open?
+	explicit operator bool() const
+	{ return bool(m_out) && m_out.is_open(); }
+
+	//! Write the header; the stream must be open
+	void write_header();
+
+	//! Set the next column of the current record
+	TimeSeriesWriter& operator<<(double value);
+	TimeSeriesWriter& operator<<(float value);
+	TimeSeriesWriter& operator<<(int value);
+	TimeSeriesWriter& operator<<(unsigned int value);
+	TimeSeriesWriter& operator<<(unsigned long value);
+
+	//! Write the current record; all the columns must have been set
+	void end_record();
+
+	void close()
+	{ m_out.close(); }
+};
+
+//! Reader for columnar binary time series
+/*! The file is memory-mapped, so only the records that are accessed
+ * are actually read from disk. Records appended after the reader
+ * was constructed are not seen.
+ */
+class TimeSeriesReader
+{
+	std::unique_ptr<MappedFile> m_file;
+	series_header_t m_header;
+	std::vector<series_column_t> m_columns;
+	size_t m_num_records;
+
+public:
+	//! Open the given time series file
+	TimeSeriesReader(std::string const& fname);
+	~TimeSeriesReader();
+
+	size_t num_columns() const
+	{ return m_columns.size(); }
+
+	std::string column_name(size_t col) const;
+
+	SeriesType column_type(size_t col) const
+	{ return SeriesType(m_columns[col].type); }
+
+	//! Index of the column with the given name, or -1 if not found
+	int find_column(std::string const& name) const;
+
+	size_t num_records() const
+	{ return m_num_records; }
+
+	//! Raw data of the given record
+	const char *record(size_t rec) const;
+
+	//! Value of the given column in the given record, converted to double
+	double value(size_t rec, size_t col) const;
+
+	//! Time of the given record
+	double time(size_t rec) const
+	{ return value(rec, 0); }
+
+	//! Range [first, last) of the records with time in [t0, t1]
+	std::pair<size_t, size_t> time_window(double t0, double t1) const;
+
+	//! Values of the given column for the records in [first, last)
+	std::vector<double> column(size_t col, size_t first, size_t last) const;
+};
+
+#endif
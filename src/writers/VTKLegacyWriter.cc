@@ -26,22 +26,47 @@
  */
 #include <sstream>
 #include <stdexcept>
+#include <cstring>
+#include <functional>
+#include <vector>
 
 #include "VTKLegacyWriter.h"
 #include "GlobalData.h"
+#include "buffer_precision.h"
+#include "parallel_jobs.h"
 
 using namespace std;
 
-static inline void print_lookup(ofstream &fid)
+//! Number of particles encoded by each job
+#define LEGACY_ENCODE_CHUNK (64*1024)
+
+//! A data array of the legacy VTK file
+struct VTKLegacyWriter::LegacyArray
 {
-	fid << "LOOKUP_TABLE default" << endl;
-}
+	enum ValueType { INT, FLOAT, DOUBLE };
+
+	string header; ///< header of the array section, without trailing newline
+	ValueType type;
+	uint components;
+	//! get the values of the given particle, as components ints/floats/doubles
+	function<void(uint, void*)> get;
+	//! optional: text to write in ASCII format for the given particle
+	//! instead of its values, or NULL to write the values
+	function<const char*(uint)> ascii_text;
+
+	size_t value_size() const
+	{
+		return type == DOUBLE ? sizeof(double) : type == FLOAT ? sizeof(float) : sizeof(int);
+	}
+};
 
 VTKLegacyWriter::VTKLegacyWriter(const GlobalData *_gdata)
   : Writer(_gdata)
 {
 	m_fname_sfx = ".vtk";
 
+	m_binary = (gdata->clOptions->get("vtk-legacy-format", string("binary")) != "ascii");
+
 	string time_fname = open_data_file(m_timefile, "VTUinp", "", ".pvd");
 
 	// Writing header of VTUinp.pvd file
@@ -59,63 +84,168 @@ VTKLegacyWriter::~VTKLegacyWriter()
 	m_timefile.close();
 }
 
+// store count values of size bytes from src to dst, in big-endian order
+static void
+store_big_endian(char *dst, const char *src, size_t count, size_t size)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	memcpy(dst, src, count*size);
+#else
+	switch (size) {
+	case 4:
+		for (size_t v = 0; v < count; ++v) {
+			uint32_t x;
+			memcpy(&x, src + 4*v, 4);
+			x = __builtin_bswap32(x);
+			memcpy(dst + 4*v, &x, 4);
+		}
+		break;
+	case 8:
+		for (size_t v = 0; v < count; ++v) {
+			uint64_t x;
+			memcpy(&x, src + 8*v, 8);
+			x = __builtin_bswap64(x);
+			memcpy(dst + 8*v, &x, 8);
+		}
+		break;
+	default:
+		throw invalid_argument("unsupported value size");
+	}
+#endif
+}
+
+void
+VTKLegacyWriter::write_array(ofstream &fid, LegacyArray const& array, uint numParts)
+{
+	fid << array.header << "\n";
+
+	const size_t value_size = array.value_size();
+	const size_t particle_size = value_size*array.components;
+	const size_t num_chunks = (numParts + LEGACY_ENCODE_CHUNK - 1)/LEGACY_ENCODE_CHUNK;
+
+	if (m_binary) {
+		// encode the chunks in parallel, then write the whole array at once
+		vector<char> data(particle_size*numParts);
+		parallel_jobs(num_chunks, [&](size_t c) {
+			const uint begin = c*LEGACY_ENCODE_CHUNK;
+			const uint end = min(numParts, uint(begin + LEGACY_ENCODE_CHUNK));
+			char values[4*sizeof(double)];
+			for (uint i = begin; i < end; ++i) {
+				array.get(i, values);
+				store_big_endian(data.data() + i*particle_size, values, array.components, value_size);
+			}
+		});
+		fid.write(data.data(), data.size());
+		fid << "\n";
+		return;
+	}
+
+	// format the chunks in parallel, then write them in order
+	vector<string> text(num_chunks);
+	parallel_jobs(num_chunks, [&](size_t c) {
+		const uint begin = c*LEGACY_ENCODE_CHUNK;
+		const uint end = min(numParts, uint(begin + LEGACY_ENCODE_CHUNK));
+		ostringstream out;
+		union {
+			int i[4];
+			float f[4];
+			double d[4];
+		} values;
+		for (uint i = begin; i < end; ++i) {
+			const char *fixed = array.ascii_text ? array.ascii_text(i) : NULL;
+			if (fixed) {
+				out << fixed << "\n";
+				continue;
+			}
+			array.get(i, &values);
+			for (uint k = 0; k < array.components; ++k) {
+				if (k > 0)
+					out << " ";
+				switch (array.type) {
+				case LegacyArray::INT: out << values.i[k]; break;
+				case LegacyArray::FLOAT: out << values.f[k]; break;
+				case LegacyArray::DOUBLE: out << values.d[k]; break;
+				}
+			}
+			out << "\n";
+		}
+		text[c] = out.str();
+	});
+	for (auto const& chunk : text)
+		fid << chunk;
+	fid << "\n";
+}
+
 void
 VTKLegacyWriter::write(uint numParts, BufferList const& buffers, uint node_offset, double t, const bool testpoints)
 {
 	const double4 *pos = buffers.getData<BUFFER_POS_GLOBAL>();
 	const float4 *vel = buffers.getData<BUFFER_VEL>();
 	const particleinfo *info = buffers.getData<BUFFER_INFO>();
-	const float3 *vort = buffers.getData<BUFFER_VORTICITY>();
+	const DecodedBuffer<BUFFER_VORTICITY> vort_data(buffers.getData<BUFFER_VORTICITY>(),
+		node_offset + numParts);
+	const float3 *vort = vort_data;
 
 	ofstream fid;
 	string filename = open_data_file(fid, "PART", current_filenum());
 
 	// Header
-	fid << "# vtk DataFile Version 2.0\n" << m_dirname << endl;
-	fid << "ASCII\nDATASET POLYDATA" << endl;
-
-	fid << "POINTS " << numParts << "double" << endl;
+	fid << "# vtk DataFile Version 2.0\n" << m_dirname << "\n";
+	fid << (m_binary ? "BINARY" : "ASCII") << "\nDATASET POLYDATA\n";
+
+	typedef LegacyArray::ValueType ValueType;
+	auto make_array = [](string const& header, ValueType type, uint components,
+		function<void(uint, void*)> get) -> LegacyArray
+	{
+		LegacyArray array;
+		array.header = header;
+		array.type = type;
+		array.components = components;
+		array.get = get;
+		return array;
+	};
+	auto lookup = [](string const& header) -> string {
+		return header + "\nLOOKUP_TABLE default";
+	};
+
+	ostringstream header;
 
 	// Start with particle positions
-	for (uint i=0; i < numParts; ++i)
-		fid << pos[i].x << " " << pos[i].y << " " << pos[i].z << endl;
-	fid << endl;
+	header << "POINTS " << numParts << " double";
+	write_array(fid, make_array(header.str(), LegacyArray::DOUBLE, 3, [&](uint i, void *v) {
+		double *d = (double*)v;
+		d[0] = pos[i].x; d[1] = pos[i].y; d[2] = pos[i].z;
+	}), numParts);
 
 	// All “cells” are vertices
-	fid << "VERTICES " << numParts << " " << (2*numParts) << endl;
-
-	for (uint i=0; i < numParts; ++i)
-		fid << "1 " << i << endl;
-	fid << endl;
-
+	header.str("");
+	header << "VERTICES " << numParts << " " << (2*numParts);
+	write_array(fid, make_array(header.str(), LegacyArray::INT, 2, [](uint i, void *v) {
+		int *d = (int*)v;
+		d[0] = 1; d[1] = i;
+	}), numParts);
 
 	// Now, the data
-	fid << "POINT_DATA " << numParts << endl;
+	fid << "POINT_DATA " << numParts << "\n";
 
 	// Velocity
-	fid << "VECTORS Velocity float" << endl;
-	for (uint i=0; i < numParts; ++i)
-		fid << vel[i].x << " " << vel[i].y << " " << vel[i].z << endl;
-	fid << endl;
+	write_array(fid, make_array("VECTORS Velocity float", LegacyArray::FLOAT, 3, [&](uint i, void *v) {
+		float *d = (float*)v;
+		d[0] = vel[i].x; d[1] = vel[i].y; d[2] = vel[i].z;
+	}), numParts);
 
 	// Pressure
-	fid << "SCALARS Pressure float" << endl;
-	print_lookup(fid);
-	for (uint i=0; i < numParts; ++i) {
+	write_array(fid, make_array(lookup("SCALARS Pressure float"), LegacyArray::FLOAT, 1, [&](uint i, void *v) {
 		float value = 0.0;
 		if (TESTPOINT(info[i]))
 			value = vel[i].w;
 		else
 			value = m_problem->pressure(vel[i].w, fluid_num(info[i]));
-
-		fid << value << endl;
-	}
-	fid << endl;
+		*(float*)v = value;
+	}), numParts);
 
 	// Density
-	fid << "SCALARS Density float" << endl;
-	print_lookup(fid);
-	for (uint i=0; i < numParts; ++i) {
+	write_array(fid, make_array(lookup("SCALARS Density float"), LegacyArray::FLOAT, 1, [&](uint i, void *v) {
 		float value = 0.0;
 		if (!TESTPOINT(info[i]))
 			value = m_problem->physical_density(vel[i].w, fluid_num(info[i]));
@@ -124,27 +254,29 @@ VTKLegacyWriter::write(uint numParts, BufferList const& buffers, uint node_offse
 		// but this needs to be done correctly for multifluids
 		// In the mean time, the value should be NAN, but that breaks Paraview,
 		// so we use the 0.0 as default.
-		fid << value << endl;
-	}
-	fid << endl;
+		*(float*)v = value;
+	}), numParts);
 
 	// Mass
-	fid << "SCALARS Mass float" << endl;
-	print_lookup(fid);
-	for (uint i=0; i < numParts; ++i)
-		fid << pos[i].w << endl;
-	fid << endl;
+	write_array(fid, make_array(lookup("SCALARS Mass float"), LegacyArray::FLOAT, 1, [&](uint i, void *v) {
+		*(float*)v = pos[i].w;
+	}), numParts);
 
 	// Vorticity
 	if (vort) {
-		fid << "VECTORS Vorticity float" << endl;
-		for (uint i=0; i < numParts; ++i) {
-			if (FLUID(info[i]))
-				fid << vort[i].x << " " << vort[i].y << " " << vort[i].z << endl;
-			else
-				fid << "0.0 0.0 0.0" << endl;
-		}
-		fid << endl;
+		LegacyArray array = make_array("VECTORS Vorticity float", LegacyArray::FLOAT, 3, [&](uint i, void *v) {
+			float *d = (float*)v;
+			if (FLUID(info[i])) {
+				d[0] = vort[i].x; d[1] = vort[i].y; d[2] = vort[i].z;
+			} else {
+				d[0] = d[1] = d[2] = 0.0f;
+			}
+		});
+		// the ASCII output has always spelled out the zeros of non-fluid particles
+		array.ascii_text = [&](uint i) -> const char* {
+			return FLUID(info[i]) ? NULL : "0.0 0.0 0.0";
+		};
+		write_array(fid, array, numParts);
 	}
 
 	// Info
@@ -157,29 +289,20 @@ VTKLegacyWriter::write(uint numParts, BufferList const& buffers, uint node_offse
 	// could check that
 	bool write_part_obj = (gdata->problem->simparams()->numbodies > 0);
 	if (info) {
-		fid << "SCALARS Type+flags int" << endl;
-		print_lookup(fid);
-		for (uint i=0; i < numParts; ++i)
-			fid << type(info[i]) << endl;
-		fid << endl;
+		write_array(fid, make_array(lookup("SCALARS Type+flags int"), LegacyArray::INT, 1, [&](uint i, void *v) {
+			*(int*)v = type(info[i]);
+		}), numParts);
 
 		if (write_fluid_num || write_part_obj) {
-			if (write_fluid_num)
-				fid << "SCALARS Fluid int" << endl;
-			else
-				fid << "SCALARS Object int" << endl;
-			print_lookup(fid);
-			for (uint i=0; i < numParts; ++i)
-				fid << object(info[i]) << endl;
-			fid << endl;
+			write_array(fid, make_array(lookup(write_fluid_num ? "SCALARS Fluid int" : "SCALARS Object int"),
+				LegacyArray::INT, 1, [&](uint i, void *v) {
+				*(int*)v = object(info[i]);
+			}), numParts);
 		}
 
-		fid << "SCALARS ParticleId int" << endl;
-		print_lookup(fid);
-		for (uint i=0; i < numParts; ++i)
-			fid << id(info[i]) << endl;
-		fid << endl;
-
+		write_array(fid, make_array(lookup("SCALARS ParticleId int"), LegacyArray::INT, 1, [&](uint i, void *v) {
+			*(int*)v = id(info[i]);
+		}), numParts);
 	}
 
 	fid.close();
@@ -30,8 +30,23 @@
 
 #include "Writer.h"
 
+/*! Writer for legacy VTK (.vtk) files
+ *
+ * Files are written in BINARY (big-endian) format by default; ASCII output
+ * can be selected with --vtk-legacy-format ascii. In both cases each data
+ * array is encoded in parallel chunks on the host, and then written at once.
+ */
 class VTKLegacyWriter : public Writer
 {
+	//! A data array of the legacy VTK file
+	struct LegacyArray;
+
+	//! Write BINARY (rather than ASCII) files
+	bool m_binary;
+
+	//! Encode the given array for all particles, and write it
+	void write_array(std::ofstream &fid, LegacyArray const& array, uint numParts);
+
 public:
 	VTKLegacyWriter(const GlobalData *_gdata);
 	~VTKLegacyWriter();
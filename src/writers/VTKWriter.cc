@@ -34,6 +34,7 @@
 // GlobalData is required for writing the device index. With some order
 // of inclusions, a forward declaration might be required
 #include "GlobalData.h"
+#include "buffer_precision.h"
 
 #include "vector_print.h"
 
@@ -486,8 +487,12 @@ VTKWriter::write(uint numParts, BufferList const& buffers, uint node_offset, dou
 	const float4 *vol = buffers.getData<BUFFER_VOLUME>();
 	const float *sigma = buffers.getData<BUFFER_SIGMA>();
 	const particleinfo *info = buffers.getData<BUFFER_INFO>();
-	const float3 *vort = buffers.getData<BUFFER_VORTICITY>();
-	const float4 *normals = buffers.getData<BUFFER_NORMALS>();
+	const DecodedBuffer<BUFFER_VORTICITY> vort_data(buffers.getData<BUFFER_VORTICITY>(),
+		node_offset + numParts);
+	const float3 *vort = vort_data;
+	const DecodedBuffer<BUFFER_NORMALS> normals_data(buffers.getData<BUFFER_NORMALS>(),
+		node_offset + numParts);
+	const float4 *normals = normals_data;
 	const float4 *gradGamma = buffers.getData<BUFFER_GRADGAMMA>();
 	const float *tke = buffers.getData<BUFFER_TKE>();
 	const float *eps = buffers.getData<BUFFER_EPSILON>();
@@ -827,6 +832,15 @@ VTKWriter::write(uint numParts, BufferList const& buffers, uint node_offset, dou
 
 	add_block("Particles", filename);
 
+	// fields with their own write frequency: reference the last file
+	// that has them, if they were not written this time
+	if (!m_problem->get_field_write_freqs().empty()) {
+		if (!Writer::CurrentSkippedFields())
+			m_fields_fname = filename;
+		else if (!m_fields_fname.empty())
+			add_block("Fields", m_fields_fname);
+	}
+
 	delete[] neibsnum;
 }
 
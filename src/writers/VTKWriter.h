@@ -37,6 +37,9 @@ class VTKWriter : public Writer
 	std::string m_planes_fname;
 	// name of the saved DEM file. again, only one, for all timesteps
 	std::string m_dem_fname;
+	// name of the last particle file holding all the fields; when fields with their
+	// own write frequency are not written, it is referenced at each timestep instead
+	std::string m_fields_fname;
 
 	// string representation of the current time of writing;
 	// this includes an (optional) indication of the current integration